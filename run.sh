@@ -10,8 +10,10 @@ NC='\033[0m' # No Color
 # Configuration
 BUILD_DIR="build"
 EXECUTABLE="fanorona"
+TARGET="fanorona"
 DEBUG_MODE=false
 CLEAN_BUILD=false
+NATIVE_BUILD=false
 
 # Parse command line arguments
 while [[ $# -gt 0 ]]; do
@@ -24,11 +26,24 @@ while [[ $# -gt 0 ]]; do
             CLEAN_BUILD=true
             shift
             ;;
+        -n|--native)
+            NATIVE_BUILD=true
+            shift
+            ;;
+        -t|--target)
+            TARGET="$2"
+            shift 2
+            ;;
         -h|--help)
             echo "Usage: $0 [OPTIONS]"
             echo "Options:"
             echo "  -d, --debug    Build in debug mode"
             echo "  -c, --clean    Clean build directory before building"
+            echo "  -n, --native   Optimize for this CPU (enables the AVX2 evaluator kernels)"
+            echo "  -t, --target   Target to build: fanorona (default), fanorona-perft,"
+            echo "                 fanorona-evalbench, fanorona-selfplay, fanorona-book,"
+            echo "                 fanorona-tbgen, fanorona-netcheck, fanorona-server,"
+            echo "                 fanorona-bots, fanorona-analyze"
             echo "  -h, --help     Show this help message"
             exit 0
             ;;
@@ -56,8 +71,17 @@ print_error() {
     echo -e "${RED}[ERROR]${NC} $1"
 }
 
+# Only the game itself opens windows; tools run headless
+needs_sdl() {
+    [[ "$TARGET" == "$EXECUTABLE" ]]
+}
+
 # Check if required libraries are installed
 check_dependencies() {
+    if ! needs_sdl; then
+        return
+    fi
+    
     print_status "Checking dependencies..."
     
     # Check for SDL2
@@ -101,7 +125,7 @@ setup_build_dir() {
 
 # Build the project
 build_project() {
-    print_status "Building Fanorona game..."
+    print_status "Building $TARGET..."
     
     # Compiler and flags
     CC="gcc"
@@ -118,53 +142,160 @@ build_project() {
         print_status "Building in RELEASE mode"
     fi
     
-    # SDL2 flags
-    SDL_CFLAGS=$(pkg-config --cflags sdl2 SDL2_ttf SDL2_image)
-    SDL_LIBS=$(pkg-config --libs sdl2 SDL2_ttf SDL2_image)
+    if [[ "$NATIVE_BUILD" == true ]]; then
+        CFLAGS="$CFLAGS -march=native"
+    fi
     
-    # Add SDL2_mixer if available
-    if pkg-config --exists SDL2_mixer; then
-        SDL_CFLAGS="$SDL_CFLAGS $(pkg-config --cflags SDL2_mixer)"
-        SDL_LIBS="$SDL_LIBS $(pkg-config --libs SDL2_mixer)"
-        CFLAGS="$CFLAGS -DHAVE_SDL_MIXER"
+    # SDL2 flags (headless tools link without SDL)
+    SDL_CFLAGS=""
+    SDL_LIBS=""
+    if needs_sdl; then
+        SDL_CFLAGS=$(pkg-config --cflags sdl2 SDL2_ttf SDL2_image)
+        SDL_LIBS=$(pkg-config --libs sdl2 SDL2_ttf SDL2_image)
+        
+        # Add SDL2_mixer if available
+        if pkg-config --exists SDL2_mixer; then
+            SDL_CFLAGS="$SDL_CFLAGS $(pkg-config --cflags SDL2_mixer)"
+            SDL_LIBS="$SDL_LIBS $(pkg-config --libs SDL2_mixer)"
+            CFLAGS="$CFLAGS -DHAVE_SDL_MIXER"
+        fi
     fi
     
-    # Math library
-    LIBS="-lm $SDL_LIBS"
+    # Math and thread libraries
+    LIBS="-lm -pthread $SDL_LIBS"
     
     # Include directories
     INCLUDES="-Isrc"
     
-    # Source files
-    SOURCES=(
-        "src/main.c"
-        "src/core/sdl_init.c"
-        "src/core/timer.c"
-        "src/core/config.c"
-        "src/window/window_manager.c"  # Add this line
-        "src/layer/layer.c"
-        "src/layer/layer_manager.c"
-        "src/layer/dirty_rect.c"
-        "src/layer/render_target.c"
-        "src/ui/widget.c"
-        "src/ui/button.c"
-        "src/ui/pieces_widget.c"
-        "src/ui/animation.c"
-        "src/scenes/scene.c"
-        "src/scenes/game_scene.c"
-        "src/scenes/menu_scene.c"
+    # Rules engine, shared by every target
+    ENGINE_SOURCES=(
         "src/engine/fanorona.c"
         "src/engine/game_state.c"
-        "src/event/event_dispatcher.c"
-        "src/event/coordinate_utils.c"
-        "src/event/hitbox.c"
-        "src/net/p2p.c"
-        "src/audio/audio.c"
-        "src/ai/minimax.c"
-        "src/ai/gnn_inference.c"
-        "src/analyzer/postgame.c"
+        "src/engine/chain.c"
+        "src/engine/zobrist.c"
+        "src/engine/notation.c"
+        "src/engine/record.c"
     )
     
+    # Source files
+    case "$TARGET" in
+        fanorona)
+            SOURCES=(
+                "src/main.c"
+                "src/core/sdl_init.c"
+                "src/core/timer.c"
+                "src/core/config.c"
+                "src/core/clock.c"
+                "src/window/window_manager.c"  # Add this line
+                "src/layer/layer.c"
+                "src/layer/layer_manager.c"
+                "src/layer/dirty_rect.c"
+                "src/layer/render_target.c"
+                "src/ui/widget.c"
+                "src/ui/button.c"
+                "src/ui/pieces_widget.c"
+                "src/ui/animation.c"
+                "src/scenes/scene.c"
+                "src/scenes/game_scene.c"
+                "src/scenes/menu_scene.c"
+                "${ENGINE_SOURCES[@]}"
+                "src/event/event_dispatcher.c"
+                "src/event/coordinate_utils.c"
+                "src/event/hitbox.c"
+                "src/net/p2p.c"
+                "src/net/protocol.c"
+                "src/audio/audio.c"
+                "src/ai/minimax.c"
+                "src/ai/tt.c"
+                "src/ai/ai_service.c"
+                "src/ai/mcts.c"
+                "src/ai/book.c"
+                "src/ai/tablebase.c"
+                "src/ai/gnn_inference.c"
+                "src/analyzer/postgame.c"
+            )
+            ;;
+        fanorona-perft)
+            SOURCES=(
+                "src/tools/perft.c"
+                "${ENGINE_SOURCES[@]}"
+            )
+            ;;
+        fanorona-selfplay)
+            SOURCES=(
+                "src/tools/selfplay.c"
+                "src/core/clock.c"
+                "src/ai/minimax.c"
+                "src/ai/tt.c"
+                "src/ai/mcts.c"
+                "src/ai/tablebase.c"
+                "src/ai/gnn_inference.c"
+                "${ENGINE_SOURCES[@]}"
+            )
+            ;;
+        fanorona-analyze)
+            SOURCES=(
+                "src/tools/analyze.c"
+                "src/core/clock.c"
+                "src/analyzer/postgame.c"
+                "src/ai/minimax.c"
+                "src/ai/tt.c"
+                "src/ai/tablebase.c"
+                "${ENGINE_SOURCES[@]}"
+            )
+            ;;
+        fanorona-tbgen)
+            SOURCES=(
+                "src/tools/tbgen.c"
+                "src/core/clock.c"
+                "src/ai/tablebase.c"
+                "${ENGINE_SOURCES[@]}"
+            )
+            ;;
+        fanorona-netcheck)
+            SOURCES=(
+                "src/tools/netcheck.c"
+                "src/core/clock.c"
+                "src/net/p2p.c"
+                "src/net/protocol.c"
+                "${ENGINE_SOURCES[@]}"
+            )
+            ;;
+        fanorona-server)
+            SOURCES=(
+                "src/tools/server.c"
+                "src/core/clock.c"
+                "src/net/server.c"
+                "src/net/protocol.c"
+                "${ENGINE_SOURCES[@]}"
+            )
+            ;;
+        fanorona-bots)
+            SOURCES=(
+                "src/tools/bots.c"
+                "src/core/clock.c"
+                "src/net/protocol.c"
+                "${ENGINE_SOURCES[@]}"
+            )
+            ;;
+        fanorona-book)
+            SOURCES=(
+                "src/tools/book_build.c"
+                "src/core/clock.c"
+                "src/ai/book.c"
+                "${ENGINE_SOURCES[@]}"
+            )
+            ;;
+        fanorona-evalbench)
+            SOURCES=(
+                "src/tools/evalbench.c"
+                "src/core/clock.c"
+                "src/ai/gnn_inference.c"
+                "${ENGINE_SOURCES[@]}"
+            )
+            ;;
+    esac
+    
     # Filter existing source files
     EXISTING_SOURCES=()
     for src in "${SOURCES[@]}"; do
@@ -176,7 +307,7 @@ build_project() {
     done
     
     # Build command
-    BUILD_CMD="$CC $CFLAGS $INCLUDES $SDL_CFLAGS ${EXISTING_SOURCES[*]} -o $BUILD_DIR/$EXECUTABLE $LIBS"
+    BUILD_CMD="$CC $CFLAGS $INCLUDES $SDL_CFLAGS ${EXISTING_SOURCES[*]} -o $BUILD_DIR/$TARGET $LIBS"
     
     print_status "Executing: $BUILD_CMD"
     
@@ -223,12 +354,25 @@ main() {
     print_status "Fanorona Game Build Script"
     echo "=========================="
     
+    case "$TARGET" in
+        fanorona|fanorona-perft|fanorona-evalbench|fanorona-selfplay|fanorona-book|fanorona-tbgen|fanorona-netcheck|fanorona-server|fanorona-bots|fanorona-analyze) ;;
+        *)
+            print_error "Unknown target: $TARGET"
+            exit 1
+            ;;
+    esac
+    
     check_dependencies
     setup_build_dir
     build_project
     
     print_success "Build process completed!"
     
+    if ! needs_sdl; then
+        print_status "Tool is ready at: $BUILD_DIR/$TARGET"
+        return
+    fi
+    
     # Ask if user wants to run the game
     read -p "Do you want to run the game now? [y/N]: " -n 1 -r
     echo
@@ -0,0 +1,206 @@
+#define _POSIX_C_SOURCE 200112L
+#include "ai_service.h"
+#include "book.h"
+#include "gnn_inference.h"
+#include "mcts.h"
+#include "tablebase.h"
+#include "../core/clock.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct AIService {
+    pthread_t       thread;
+    pthread_mutex_t lock;
+    pthread_cond_t  wake;
+    TransTable     *tt;          // alpha-beta only
+    Mcts           *mcts;        // MCTS only; its tree carries over between moves
+    MctsEval        mcts_eval;
+    Book           *book;        // optional, answers known openings at once
+    uint64_t        rng;         // for weighted book choices, request thread only
+    int             max_threads; // Config.ai_threads, 0 = one per core
+
+    // Guarded by lock
+    bool            pending, quit;
+    AIStatus        status;
+    GameState       position;
+    uint64_t        position_hash;
+    SearchLimits    limits;
+    SearchResult    result;
+    unsigned        generation;  // bumped by every request and cancel
+
+    int             cancel;      // read by the search without the lock
+};
+
+typedef struct {
+    AIService *ai;
+    unsigned   generation;
+} IterationContext;
+
+// Runs on the worker: publish each completed iteration as a hint
+static void on_iteration(const SearchResult *partial, void *userdata) {
+    IterationContext *ctx = userdata;
+    AIService *ai = ctx->ai;
+    pthread_mutex_lock(&ai->lock);
+    if (ai->generation == ctx->generation && ai->status == AI_THINKING) {
+        ai->result = *partial;
+    }
+    pthread_mutex_unlock(&ai->lock);
+}
+
+static void *worker_main(void *arg) {
+    AIService *ai = arg;
+    pthread_mutex_lock(&ai->lock);
+    for (;;) {
+        while (!ai->pending && !ai->quit) pthread_cond_wait(&ai->wake, &ai->lock);
+        if (ai->quit) break;
+
+        GameState position = ai->position;
+        SearchLimits limits = ai->limits;
+        IterationContext ctx = { ai, ai->generation };
+        ai->pending = false;
+        __atomic_store_n(&ai->cancel, 0, __ATOMIC_RELAXED);
+        pthread_mutex_unlock(&ai->lock);
+
+        limits.cancel = &ai->cancel;
+        limits.on_iteration = on_iteration;
+        limits.userdata = &ctx;
+        SearchResult result;
+        bool ok = ai->mcts ? mcts_search(ai->mcts, &position, &limits, ai->mcts_eval, &result)
+                           : minimax_search(&position, &limits, &result);
+
+        pthread_mutex_lock(&ai->lock);
+        if (ai->generation == ctx.generation && ai->status == AI_THINKING) {
+            if (ok) ai->result = result;
+            ai->status = ok ? AI_DONE : AI_CANCELLED;
+        }
+    }
+    pthread_mutex_unlock(&ai->lock);
+    return NULL;
+}
+
+AIService *ai_service_create(const Config *cfg) {
+    AIService *ai = malloc(sizeof(AIService));
+    if (!ai) return NULL;
+    memset(ai, 0, sizeof(AIService));
+
+    size_t mb = cfg && cfg->ai_hash_mb > 0 ? (size_t)cfg->ai_hash_mb : 64;
+    if (cfg && cfg->ai_engine == AI_ENGINE_MCTS) {
+        ai->mcts = mcts_create(mb);
+        ai->mcts_eval = MCTS_EVAL_PLAYOUT;
+        if (cfg->ai_weights[0] && (gnn_ready() || gnn_load(cfg->ai_weights))) {
+            ai->mcts_eval = MCTS_EVAL_NETWORK;
+        }
+    } else {
+        ai->tt = tt_create(mb);
+    }
+    ai->max_threads = cfg ? cfg->ai_threads : 0;
+    ai->book = cfg ? book_open(cfg->ai_book) : NULL;
+    // Tables are shared by every search and stay mapped until exit
+    if (cfg && cfg->ai_tablebases[0] && tb_max_pieces() == 0) tb_init(cfg->ai_tablebases);
+    ai->rng = (uint64_t)(clock_now() * 1e9) | 1;
+    ai->status = AI_IDLE;
+    pthread_mutex_init(&ai->lock, NULL);
+    pthread_cond_init(&ai->wake, NULL);
+
+    if (pthread_create(&ai->thread, NULL, worker_main, ai) != 0) {
+        pthread_cond_destroy(&ai->wake);
+        pthread_mutex_destroy(&ai->lock);
+        tt_destroy(ai->tt);
+        mcts_destroy(ai->mcts);
+        book_close(ai->book);
+        free(ai);
+        return NULL;
+    }
+    return ai;
+}
+
+void ai_service_destroy(AIService *ai) {
+    if (!ai) return;
+
+    pthread_mutex_lock(&ai->lock);
+    ai->quit = true;
+    __atomic_store_n(&ai->cancel, 1, __ATOMIC_RELAXED);
+    pthread_cond_signal(&ai->wake);
+    pthread_mutex_unlock(&ai->lock);
+
+    pthread_join(ai->thread, NULL);
+    pthread_cond_destroy(&ai->wake);
+    pthread_mutex_destroy(&ai->lock);
+    tt_destroy(ai->tt);
+    mcts_destroy(ai->mcts);
+    book_close(ai->book);
+    free(ai);
+}
+
+bool ai_service_request(AIService *ai, const GameManager *gm, int difficulty) {
+    if (!ai || !gm || gm->game_over || gm->pending.length) return false;
+
+    // A book move is ready at once; the worker is not involved
+    SearchResult book_move;
+    memset(&book_move, 0, sizeof(book_move));
+    ai->rng ^= ai->rng << 13;
+    ai->rng ^= ai->rng >> 7;
+    ai->rng ^= ai->rng << 17;
+    book_move.has_move = book_pick(ai->book, &gm->state, ai->rng, &book_move.best);
+
+    SearchLimits limits;
+    minimax_limits(&limits, difficulty, gm);
+    limits.tt = ai->tt;
+    if (ai->max_threads > 0 && (limits.threads == 0 || limits.threads > ai->max_threads)) {
+        limits.threads = ai->max_threads;
+    }
+
+    pthread_mutex_lock(&ai->lock);
+    ai->generation++;
+    ai->position = gm->state;
+    ai->position_hash = gm->state.hash;
+    ai->limits = limits;
+    ai->result = book_move;
+    ai->status = book_move.has_move ? AI_DONE : AI_THINKING;
+    ai->pending = !book_move.has_move;
+    // Stop a search still running for an older request
+    __atomic_store_n(&ai->cancel, 1, __ATOMIC_RELAXED);
+    if (ai->pending) pthread_cond_signal(&ai->wake);
+    pthread_mutex_unlock(&ai->lock);
+    return true;
+}
+
+AIStatus ai_service_poll(AIService *ai, SearchResult *out) {
+    if (!ai) return AI_IDLE;
+
+    pthread_mutex_lock(&ai->lock);
+    AIStatus status = ai->status;
+    if (out) *out = ai->result;
+    // A finished result is handed out once
+    if (status == AI_DONE || status == AI_CANCELLED) ai->status = AI_IDLE;
+    pthread_mutex_unlock(&ai->lock);
+    return status;
+}
+
+void ai_service_cancel(AIService *ai) {
+    if (!ai) return;
+
+    pthread_mutex_lock(&ai->lock);
+    if (ai->status == AI_THINKING) {
+        ai->generation++;
+        ai->pending = false;
+        ai->status = AI_CANCELLED;
+        __atomic_store_n(&ai->cancel, 1, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&ai->lock);
+}
+
+void ai_service_sync(AIService *ai, const GameManager *gm) {
+    if (!ai || !gm) return;
+
+    pthread_mutex_lock(&ai->lock);
+    bool stale = gm->game_over || gm->state.hash != ai->position_hash;
+    if (stale && (ai->status == AI_THINKING || ai->status == AI_DONE)) {
+        ai->generation++;
+        ai->pending = false;
+        ai->status = AI_CANCELLED;
+        __atomic_store_n(&ai->cancel, 1, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&ai->lock);
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include "minimax.h"
+#include "../core/config.h"
+#include "../engine/game_state.h"
+
+// Runs the search on a worker thread so the render loop never blocks.
+// request -> poll every frame -> play the result; cancel at any time.
+
+typedef enum {
+    AI_IDLE,      // nothing requested
+    AI_THINKING,  // poll() returns the best move found so far
+    AI_DONE,      // poll() returns the final result
+    AI_CANCELLED
+} AIStatus;
+
+typedef struct AIService AIService;
+
+AIService *ai_service_create(const Config *cfg);
+void       ai_service_destroy(AIService *ai);
+
+// Starts thinking about the position in gm, cancelling any earlier request
+bool     ai_service_request(AIService *ai, const GameManager *gm, int difficulty);
+AIStatus ai_service_poll(AIService *ai, SearchResult *out);
+void     ai_service_cancel(AIService *ai);
+
+// Call once per frame: cancels a request whose position is gone (undo,
+// move played elsewhere) or whose game has ended (flag fall)
+void ai_service_sync(AIService *ai, const GameManager *gm);
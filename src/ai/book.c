@@ -0,0 +1,150 @@
+#define _POSIX_C_SOURCE 200112L
+#include "book.h"
+#include "../engine/chain.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct Book {
+    void            *map;
+    size_t           size;
+    const BookEntry *entries;
+    int              count;
+};
+
+Book *book_open(const char *path) {
+    if (!path || !path[0]) return NULL;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(BookHeader)) {
+        close(fd);
+        return NULL;
+    }
+    size_t size = (size_t)st.st_size;
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return NULL;
+
+    const BookHeader *h = map;
+    if (memcmp(h->magic, BOOK_MAGIC, 4) != 0 || h->version != BOOK_VERSION ||
+        size != sizeof(BookHeader) + (size_t)h->entry_count * sizeof(BookEntry)) {
+        munmap(map, size);
+        return NULL;
+    }
+
+    Book *b = malloc(sizeof(Book));
+    if (!b) {
+        munmap(map, size);
+        return NULL;
+    }
+    b->map = map;
+    b->size = size;
+    b->entries = (const BookEntry *)((const char *)map + sizeof(BookHeader));
+    b->count = (int)h->entry_count;
+    return b;
+}
+
+void book_close(Book *b) {
+    if (!b) return;
+    munmap(b->map, b->size);
+    free(b);
+}
+
+int book_size(const Book *b) {
+    return b ? b->count : 0;
+}
+
+int book_find(const Book *b, uint64_t key, const BookEntry **first) {
+    if (!b) return 0;
+
+    // Lower bound of key
+    int lo = 0, hi = b->count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (b->entries[mid].key < key) lo = mid + 1;
+        else hi = mid;
+    }
+    int n = 0;
+    while (lo + n < b->count && b->entries[lo + n].key == key) n++;
+    if (first) *first = n ? &b->entries[lo] : NULL;
+    return n;
+}
+
+bool book_pick(const Book *b, const GameState *g, uint64_t random, Turn *out) {
+    const BookEntry *e;
+    int n = book_find(b, g->hash, &e);
+    if (n == 0) return false;
+    if (n > MAX_TURNS) n = MAX_TURNS;
+
+    // Only entries that match a legal turn here take part, so a hash
+    // collision or a stale book can never produce an illegal move
+    Turn buf[MAX_TURNS];
+    int legal[MAX_TURNS], count;
+    Turn *turns = chain_generate_all(g, buf, MAX_TURNS, &count);
+    if (!turns) return false;
+    uint64_t total = 0;
+    for (int i = 0; i < n; i++) {
+        legal[i] = -1;
+        for (int k = 0; k < count; k++) {
+            GameState next = *g;
+            game_apply_turn(&next, &turns[k]);
+            if (next.hash == e[i].child) {
+                legal[i] = k;
+                total += e[i].weight;
+                break;
+            }
+        }
+    }
+    bool found = false;
+    uint64_t r = total ? random % total : 0;
+    for (int i = 0; i < n && total && !found; i++) {
+        if (legal[i] < 0) continue;
+        if (r < e[i].weight) {
+            *out = turns[legal[i]];
+            found = true;
+        }
+        r -= e[i].weight;
+    }
+    if (turns != buf) free(turns);
+    return found;
+}
+
+static int entry_cmp(const void *pa, const void *pb) {
+    const BookEntry *a = pa, *b = pb;
+    if (a->key != b->key) return a->key < b->key ? -1 : 1;
+    if (a->child != b->child) return a->child < b->child ? -1 : 1;
+    return 0;
+}
+
+bool book_write(const char *path, BookEntry *entries, int count, uint32_t min_games) {
+    if (count < 0) return false;
+    if (count > 0) qsort(entries, (size_t)count, sizeof(BookEntry), entry_cmp);
+
+    int merged = 0;
+    for (int i = 0; i < count;) {
+        BookEntry e = entries[i++];
+        while (i < count && entry_cmp(&e, &entries[i]) == 0) {
+            e.weight += entries[i].weight;
+            e.games += entries[i].games;
+            i++;
+        }
+        if (e.games >= min_games && e.weight > 0) entries[merged++] = e;
+    }
+
+    FILE *f = fopen(path, "wb");
+    if (!f) return false;
+    BookHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, BOOK_MAGIC, 4);
+    h.version = BOOK_VERSION;
+    h.entry_count = (uint32_t)merged;
+    bool ok = fwrite(&h, sizeof(h), 1, f) == 1 &&
+              fwrite(entries, sizeof(BookEntry), (size_t)merged, f) == (size_t)merged;
+    return fclose(f) == 0 && ok;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include "../engine/fanorona.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Opening book file: a BookHeader, then BookEntry records sorted by key
+// and child. Moves are stored as the hash of the position they lead to,
+// so transpositions share entries and the file does not depend on how
+// turns are encoded. Little-endian, used in place through mmap.
+#define BOOK_MAGIC   "FNBK"
+#define BOOK_VERSION 1
+
+typedef struct {
+    char     magic[4];
+    uint32_t version;
+    uint32_t entry_count;
+    uint32_t reserved;
+} BookHeader;
+
+typedef struct {
+    uint64_t key;    // Zobrist hash of the position
+    uint64_t child;  // hash after the book move
+    uint32_t weight; // relative chance of being played
+    uint32_t games;  // games the move was seen in when the book was built
+} BookEntry;
+
+typedef struct Book Book;
+
+Book *book_open(const char *path); // NULL if missing or invalid
+void  book_close(Book *b);
+int   book_size(const Book *b);
+
+// Entries for `key`, sorted by child; returns how many
+int   book_find(const Book *b, uint64_t key, const BookEntry **first);
+
+// Picks a book move for g with probability proportional to its weight.
+// `random` is any uniformly distributed value. False when out of book.
+bool  book_pick(const Book *b, const GameState *g, uint64_t random, Turn *out);
+
+// Builder side: sorts entries, merges those with the same key and child,
+// drops moves seen in fewer than min_games games or with no weight, and
+// writes the file. Reorders `entries`.
+bool  book_write(const char *path, BookEntry *entries, int count, uint32_t min_games);
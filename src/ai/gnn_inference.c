@@ -1,13 +1,525 @@
+#define _POSIX_C_SOURCE 200112L
 #include "gnn_inference.h"
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define W1_SIZE (INPUT_SIZE * GNN_HIDDEN1)
+#define W2_SIZE (GNN_HIDDEN2 * GNN_HIDDEN1)
+#define PARAM_COUNT (W1_SIZE + GNN_HIDDEN1 + W2_SIZE + GNN_HIDDEN2 + GNN_HIDDEN2 + 1)
+#define FILE_SIZE   (sizeof(GnnHeader) + PARAM_COUNT * sizeof(float))
+
+typedef struct {
+    const float *w1, *b1, *w2, *b2, *w3;
+    float  b3;
+    void  *mem;    // header + weights, mapped from a file or on the heap
+    bool   mapped;
+} GnnModel;
+
+static GnnModel model;
+
+// ---------------------------------------------------------------------------
+// Kernels. Vector lengths are multiples of 8 (GNN_HIDDEN1, GNN_HIDDEN2),
+// and of 32 for vec_add_rows(), which keeps its sums in registers.
+// ---------------------------------------------------------------------------
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define KERNEL_NAME "avx2"
+
+static inline __m256 madd8(__m256 a, __m256 b, __m256 c) {
+#ifdef __FMA__
+    return _mm256_fmadd_ps(a, b, c);
+#else
+    return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+#endif
+}
+
+static void vec_add_scaled(float *restrict y, const float *restrict x, float a, int n) {
+    __m256 va = _mm256_set1_ps(a);
+    for (int i = 0; i < n; i += 8) {
+        _mm256_storeu_ps(y + i, madd8(va, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i)));
+    }
+}
+
+// y += sign * (sum of rows[k * n] for every bit k of set)
+static void vec_add_rows(float *restrict y, const float *restrict rows, Bitboard set, float sign, int n) {
+    __m256 vs = _mm256_set1_ps(sign);
+    for (int i = 0; i < n; i += 32) {
+        __m256 a0 = _mm256_loadu_ps(y + i), a1 = _mm256_loadu_ps(y + i + 8);
+        __m256 a2 = _mm256_loadu_ps(y + i + 16), a3 = _mm256_loadu_ps(y + i + 24);
+        for (Bitboard b = set; b; b &= b - 1) {
+            const float *r = rows + bb_lsb(b) * n + i;
+            a0 = madd8(vs, _mm256_loadu_ps(r), a0);
+            a1 = madd8(vs, _mm256_loadu_ps(r + 8), a1);
+            a2 = madd8(vs, _mm256_loadu_ps(r + 16), a2);
+            a3 = madd8(vs, _mm256_loadu_ps(r + 24), a3);
+        }
+        _mm256_storeu_ps(y + i, a0);
+        _mm256_storeu_ps(y + i + 8, a1);
+        _mm256_storeu_ps(y + i + 16, a2);
+        _mm256_storeu_ps(y + i + 24, a3);
+    }
+}
+
+// out[k] = dot(w + k * n, x) for k < 4, with independent sums
+static void vec_dot4(const float *w, const float *x, int n, float *out) {
+    __m256 s0 = _mm256_setzero_ps(), s1 = s0, s2 = s0, s3 = s0;
+    for (int i = 0; i < n; i += 8) {
+        __m256 xv = _mm256_loadu_ps(x + i);
+        s0 = madd8(_mm256_loadu_ps(w + i), xv, s0);
+        s1 = madd8(_mm256_loadu_ps(w + n + i), xv, s1);
+        s2 = madd8(_mm256_loadu_ps(w + 2 * n + i), xv, s2);
+        s3 = madd8(_mm256_loadu_ps(w + 3 * n + i), xv, s3);
+    }
+    __m256 t = _mm256_hadd_ps(_mm256_hadd_ps(s0, s1), _mm256_hadd_ps(s2, s3));
+    _mm_storeu_ps(out, _mm_add_ps(_mm256_castps256_ps128(t), _mm256_extractf128_ps(t, 1)));
+}
+
+static float vec_dot(const float *a, const float *b, int n) {
+    __m256 acc = _mm256_setzero_ps();
+    for (int i = 0; i < n; i += 8) {
+        acc = madd8(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc);
+    }
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+}
+
+static void vec_clamp01(float *y, const float *x, int n) {
+    __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f);
+    for (int i = 0; i < n; i += 8) {
+        _mm256_storeu_ps(y + i, _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(x + i), zero), one));
+    }
+}
+
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define KERNEL_NAME "sse2"
+
+static void vec_add_scaled(float *restrict y, const float *restrict x, float a, int n) {
+    __m128 va = _mm_set1_ps(a);
+    for (int i = 0; i < n; i += 4) {
+        _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(va, _mm_loadu_ps(x + i))));
+    }
+}
+
+static void vec_add_rows(float *restrict y, const float *restrict rows, Bitboard set, float sign, int n) {
+    __m128 vs = _mm_set1_ps(sign);
+    for (int i = 0; i < n; i += 16) {
+        __m128 a0 = _mm_loadu_ps(y + i), a1 = _mm_loadu_ps(y + i + 4);
+        __m128 a2 = _mm_loadu_ps(y + i + 8), a3 = _mm_loadu_ps(y + i + 12);
+        for (Bitboard b = set; b; b &= b - 1) {
+            const float *r = rows + bb_lsb(b) * n + i;
+            a0 = _mm_add_ps(a0, _mm_mul_ps(vs, _mm_loadu_ps(r)));
+            a1 = _mm_add_ps(a1, _mm_mul_ps(vs, _mm_loadu_ps(r + 4)));
+            a2 = _mm_add_ps(a2, _mm_mul_ps(vs, _mm_loadu_ps(r + 8)));
+            a3 = _mm_add_ps(a3, _mm_mul_ps(vs, _mm_loadu_ps(r + 12)));
+        }
+        _mm_storeu_ps(y + i, a0);
+        _mm_storeu_ps(y + i + 4, a1);
+        _mm_storeu_ps(y + i + 8, a2);
+        _mm_storeu_ps(y + i + 12, a3);
+    }
+}
+
+static void vec_dot4(const float *w, const float *x, int n, float *out) {
+    __m128 s0 = _mm_setzero_ps(), s1 = s0, s2 = s0, s3 = s0;
+    for (int i = 0; i < n; i += 4) {
+        __m128 xv = _mm_loadu_ps(x + i);
+        s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(w + i), xv));
+        s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_loadu_ps(w + n + i), xv));
+        s2 = _mm_add_ps(s2, _mm_mul_ps(_mm_loadu_ps(w + 2 * n + i), xv));
+        s3 = _mm_add_ps(s3, _mm_mul_ps(_mm_loadu_ps(w + 3 * n + i), xv));
+    }
+    _MM_TRANSPOSE4_PS(s0, s1, s2, s3);
+    _mm_storeu_ps(out, _mm_add_ps(_mm_add_ps(s0, s1), _mm_add_ps(s2, s3)));
+}
+
+static float vec_dot(const float *a, const float *b, int n) {
+    __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+    for (int i = 0; i < n; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    __m128 s = _mm_add_ps(acc0, acc1);
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+}
+
+static void vec_clamp01(float *y, const float *x, int n) {
+    __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+    for (int i = 0; i < n; i += 4) {
+        _mm_storeu_ps(y + i, _mm_min_ps(_mm_max_ps(_mm_loadu_ps(x + i), zero), one));
+    }
+}
+
+#else
+#define KERNEL_NAME "scalar"
+
+static void vec_add_scaled(float *restrict y, const float *restrict x, float a, int n) {
+    for (int i = 0; i < n; i++) y[i] += a * x[i];
+}
+
+static void vec_add_rows(float *restrict y, const float *restrict rows, Bitboard set, float sign, int n) {
+    for (Bitboard b = set; b; b &= b - 1) {
+        vec_add_scaled(y, rows + bb_lsb(b) * n, sign, n);
+    }
+}
+
+static float vec_dot(const float *a, const float *b, int n) {
+    float s = 0.0f;
+    for (int i = 0; i < n; i++) s += a[i] * b[i];
+    return s;
+}
+
+static void vec_dot4(const float *w, const float *x, int n, float *out) {
+    for (int k = 0; k < 4; k++) out[k] = vec_dot(w + k * n, x, n);
+}
+
+static void vec_clamp01(float *y, const float *x, int n) {
+    for (int i = 0; i < n; i++) y[i] = x[i] < 0.0f ? 0.0f : (x[i] > 1.0f ? 1.0f : x[i]);
+}
+#endif
+
+const char *gnn_kernel_name(void) {
+    return KERNEL_NAME;
+}
+
+// ---------------------------------------------------------------------------
+// Weights
+// ---------------------------------------------------------------------------
+
+static void bind_weights(GnnModel *m, void *mem, bool mapped) {
+    const float *p = (const float *)((const char *)mem + sizeof(GnnHeader));
+    m->mem = mem;
+    m->mapped = mapped;
+    m->w1 = p;  p += W1_SIZE;
+    m->b1 = p;  p += GNN_HIDDEN1;
+    m->w2 = p;  p += W2_SIZE;
+    m->b2 = p;  p += GNN_HIDDEN2;
+    m->w3 = p;  p += GNN_HIDDEN2;
+    m->b3 = *p;
+}
+
+static void header_init(GnnHeader *h) {
+    memset(h, 0, sizeof(GnnHeader));
+    memcpy(h->magic, GNN_MAGIC, 4);
+    h->version = GNN_VERSION;
+    h->inputs = INPUT_SIZE;
+    h->hidden1 = GNN_HIDDEN1;
+    h->hidden2 = GNN_HIDDEN2;
+}
+
+static bool header_valid(const GnnHeader *h) {
+    GnnHeader want;
+    header_init(&want);
+    return memcmp(h->magic, want.magic, 4) == 0 && h->version == want.version &&
+           h->inputs == want.inputs && h->hidden1 == want.hidden1 &&
+           h->hidden2 == want.hidden2;
+}
+
+void gnn_unload(void) {
+    if (!model.mem) return;
+    if (model.mapped) munmap(model.mem, FILE_SIZE);
+    else free(model.mem);
+    memset(&model, 0, sizeof(model));
+}
+
+bool gnn_ready(void) {
+    return model.mem != NULL;
+}
+
+// The file is used in place, so it must have been written on a
+// little-endian machine like every target we build for
+bool gnn_load(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size != FILE_SIZE) {
+        close(fd);
+        return false;
+    }
+    void *mem = mmap(NULL, FILE_SIZE, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED) return false;
+
+    if (!header_valid((const GnnHeader *)mem)) {
+        munmap(mem, FILE_SIZE);
+        return false;
+    }
+    gnn_unload();
+    bind_weights(&model, mem, true);
+    return true;
+}
+
+bool gnn_save(const char *path) {
+    if (!model.mem) return false;
+    FILE *f = fopen(path, "wb");
+    if (!f) return false;
+    bool ok = fwrite(model.mem, 1, FILE_SIZE, f) == FILE_SIZE;
+    return fclose(f) == 0 && ok;
+}
+
+static uint64_t splitmix64(uint64_t *s) {
+    uint64_t z = (*s += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Uniform in [-limit, limit], Glorot style
+static void fill_uniform(float *w, int n, int fan_in, int fan_out, uint64_t *seed) {
+    float limit = sqrtf(6.0f / (float)(fan_in + fan_out));
+    for (int i = 0; i < n; i++) {
+        float u = (float)(splitmix64(seed) >> 40) / (float)(1 << 24);
+        w[i] = (2.0f * u - 1.0f) * limit;
+    }
+}
+
+void gnn_init_random(uint64_t seed) {
+    void *mem = NULL;
+    if (posix_memalign(&mem, 64, FILE_SIZE) != 0) return;
+    memset(mem, 0, FILE_SIZE);
+    header_init((GnnHeader *)mem);
+
+    float *p = (float *)((char *)mem + sizeof(GnnHeader));
+    fill_uniform(p, W1_SIZE, INPUT_SIZE, GNN_HIDDEN1, &seed);
+    p += W1_SIZE + GNN_HIDDEN1;
+    fill_uniform(p, W2_SIZE, GNN_HIDDEN1, GNN_HIDDEN2, &seed);
+    p += W2_SIZE + GNN_HIDDEN2;
+    fill_uniform(p, GNN_HIDDEN2, GNN_HIDDEN2, 1, &seed);
+
+    gnn_unload();
+    bind_weights(&model, mem, false);
+}
+
+// ---------------------------------------------------------------------------
+// Inference
+// ---------------------------------------------------------------------------
+
+// Second layer and output, from the activated first layer
+static float output(const float *h1) {
+    float pre2[GNN_HIDDEN2], h2[GNN_HIDDEN2];
+    for (int j = 0; j < GNN_HIDDEN2; j += 4) {
+        vec_dot4(model.w2 + j * GNN_HIDDEN1, h1, GNN_HIDDEN1, pre2 + j);
+    }
+    for (int j = 0; j < GNN_HIDDEN2; j++) pre2[j] += model.b2[j];
+    vec_clamp01(h2, pre2, GNN_HIDDEN2);
+    return tanhf(model.b3 + vec_dot(model.w3, h2, GNN_HIDDEN2));
+}
+
+// Everything after the first layer's pre-activations
+static float forward(const float *acc) {
+    float h1[GNN_HIDDEN1];
+    vec_clamp01(h1, acc, GNN_HIDDEN1);
+    return output(h1);
+}
+
+void gnn_encode(const GameState *g, float state_vec[INPUT_SIZE]) {
+    int side = g->current_player - 1;
+    memset(state_vec, 0, INPUT_SIZE * sizeof(float));
+    for (Bitboard b = g->pieces[side]; b; b &= b - 1) {
+        state_vec[bb_lsb(b)] = 1.0f;
+    }
+    for (Bitboard b = g->pieces[side ^ 1]; b; b &= b - 1) {
+        state_vec[BOARD_POINTS + bb_lsb(b)] = 1.0f;
+    }
+}
 
 float gnn_predict(const float state_vec[INPUT_SIZE]) {
-    if (!state_vec) return 0.0f;
-    
-    // Placeholder: simple sum for now
-    float sum = 0.0f;
+    if (!state_vec || !model.mem) return 0.0f;
+
+    float acc[GNN_HIDDEN1];
+    memcpy(acc, model.b1, sizeof(acc));
     for (int i = 0; i < INPUT_SIZE; i++) {
-        sum += state_vec[i];
+        if (state_vec[i] != 0.0f) {
+            vec_add_scaled(acc, model.w1 + i * GNN_HIDDEN1, state_vec[i], GNN_HIDDEN1);
+        }
+    }
+    return forward(acc);
+}
+
+// First-layer sums from scratch, seen from `side` to move
+static void accumulate(float *restrict acc, const GameState *g, int side) {
+    memcpy(acc, model.b1, GNN_HIDDEN1 * sizeof(float));
+    vec_add_rows(acc, model.w1, g->pieces[side], 1.0f, GNN_HIDDEN1);
+    vec_add_rows(acc, model.w1 + BOARD_POINTS * GNN_HIDDEN1, g->pieces[side ^ 1], 1.0f, GNN_HIDDEN1);
+}
+
+// Same as gnn_predict(gnn_encode(g)), reading the bitboards directly
+float gnn_evaluate(const GameState *g) {
+    if (!model.mem) return 0.0f;
+
+    float acc[GNN_HIDDEN1];
+    accumulate(acc, g, g->current_player - 1);
+    return forward(acc);
+}
+
+// ---------------------------------------------------------------------------
+// Incremental accumulator
+// ---------------------------------------------------------------------------
+
+static const float *feature_row(int perspective, int side, int point) {
+    int feature = (side == perspective ? 0 : BOARD_POINTS) + point;
+    return model.w1 + feature * GNN_HIDDEN1;
+}
+
+void gnn_acc_reset(GnnAccumulator *a, const GameState *g) {
+    a->top = 0;
+    if (!model.mem) return;
+    accumulate(a->v[0][0], g, 0);
+    accumulate(a->v[0][1], g, 1);
+}
+
+void gnn_acc_make(GnnAccumulator *a, const GameState *g, const Undo *u) {
+    if (!model.mem) return;
+    if (a->top + 1 >= GNN_ACC_DEPTH) {
+        // Out of room: start over from the current position
+        gnn_acc_reset(a, g);
+        return;
+    }
+    int mover = u->prev_player - 1;
+    a->top++;
+    for (int p = 0; p < 2; p++) {
+        float *acc = a->v[a->top][p];
+        memcpy(acc, a->v[a->top - 1][p], GNN_HIDDEN1 * sizeof(float));
+        vec_add_scaled(acc, feature_row(p, mover, u->from), -1.0f, GNN_HIDDEN1);
+        vec_add_scaled(acc, feature_row(p, mover, u->to), 1.0f, GNN_HIDDEN1);
+        vec_add_rows(acc, feature_row(p, mover ^ 1, 0), u->captured, -1.0f, GNN_HIDDEN1);
+    }
+}
+
+void gnn_acc_unmake(GnnAccumulator *a, const GameState *g) {
+    if (a->top > 0) a->top--;
+    else gnn_acc_reset(a, g);
+}
+
+float gnn_acc_evaluate(const GnnAccumulator *a, const GameState *g) {
+    if (!model.mem) return 0.0f;
+    return forward(a->v[a->top][g->current_player - 1]);
+}
+
+// ---------------------------------------------------------------------------
+// Batches
+// ---------------------------------------------------------------------------
+
+bool gnn_batch_init(GnnBatch *b, int capacity) {
+    memset(b, 0, sizeof(GnnBatch));
+    void *own = NULL, *opp = NULL;
+    if (capacity < 1) return false;
+    if (posix_memalign(&own, 64, (size_t)capacity * sizeof(Bitboard)) != 0) return false;
+    if (posix_memalign(&opp, 64, (size_t)capacity * sizeof(Bitboard)) != 0) {
+        free(own);
+        return false;
+    }
+    b->own = own;
+    b->opp = opp;
+    b->capacity = capacity;
+    return true;
+}
+
+void gnn_batch_free(GnnBatch *b) {
+    free(b->own);
+    free(b->opp);
+    memset(b, 0, sizeof(GnnBatch));
+}
+
+void gnn_batch_clear(GnnBatch *b) {
+    b->count = 0;
+}
+
+bool gnn_batch_add(GnnBatch *b, const GameState *g) {
+    if (b->count >= b->capacity) return false;
+    int side = g->current_player - 1;
+    b->own[b->count] = g->pieces[side];
+    b->opp[b->count] = g->pieces[side ^ 1];
+    b->count++;
+    return true;
+}
+
+// One tile: the first layer for every position, then each block of four
+// second-layer rows against every position while those rows are hot
+static void predict_tile(const Bitboard *own, const Bitboard *opp, int n, float *out) {
+    float h1[GNN_BATCH_TILE][GNN_HIDDEN1];
+    float pre2[GNN_BATCH_TILE][GNN_HIDDEN2];
+
+    for (int p = 0; p < n; p++) {
+        float acc[GNN_HIDDEN1];
+        memcpy(acc, model.b1, sizeof(acc));
+        vec_add_rows(acc, model.w1, own[p], 1.0f, GNN_HIDDEN1);
+        vec_add_rows(acc, model.w1 + BOARD_POINTS * GNN_HIDDEN1, opp[p], 1.0f, GNN_HIDDEN1);
+        vec_clamp01(h1[p], acc, GNN_HIDDEN1);
+    }
+    for (int j = 0; j < GNN_HIDDEN2; j += 4) {
+        const float *w = model.w2 + j * GNN_HIDDEN1;
+        for (int p = 0; p < n; p++) vec_dot4(w, h1[p], GNN_HIDDEN1, pre2[p] + j);
+    }
+    for (int p = 0; p < n; p++) {
+        float h2[GNN_HIDDEN2];
+        for (int j = 0; j < GNN_HIDDEN2; j++) pre2[p][j] += model.b2[j];
+        vec_clamp01(h2, pre2[p], GNN_HIDDEN2);
+        out[p] = tanhf(model.b3 + vec_dot(model.w3, h2, GNN_HIDDEN2));
+    }
+}
+
+typedef struct {
+    const GnnBatch *batch;
+    float          *out;
+    int             first, last;
+    pthread_t       thread;
+} BatchSlice;
+
+static void *predict_slice(void *arg) {
+    BatchSlice *s = arg;
+    for (int i = s->first; i < s->last; i += GNN_BATCH_TILE) {
+        int n = s->last - i < GNN_BATCH_TILE ? s->last - i : GNN_BATCH_TILE;
+        predict_tile(s->batch->own + i, s->batch->opp + i, n, s->out + i);
+    }
+    return NULL;
+}
+
+#define GNN_BATCH_MAX_THREADS 64
+
+void gnn_predict_batch(const GnnBatch *b, float *out, int threads) {
+    if (!b || !out || b->count <= 0) return;
+    if (!model.mem) {
+        memset(out, 0, (size_t)b->count * sizeof(float));
+        return;
+    }
+
+    if (threads <= 0) threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads > b->count / GNN_BATCH_MIN_PER_THREAD) threads = b->count / GNN_BATCH_MIN_PER_THREAD;
+    if (threads > GNN_BATCH_MAX_THREADS) threads = GNN_BATCH_MAX_THREADS;
+    if (threads < 1) threads = 1;
+
+    // Slices are whole tiles; the calling thread takes the first one
+    BatchSlice slices[GNN_BATCH_MAX_THREADS];
+    int tiles = (b->count + GNN_BATCH_TILE - 1) / GNN_BATCH_TILE;
+    for (int t = 0; t < threads; t++) {
+        BatchSlice *s = &slices[t];
+        s->batch = b;
+        s->out = out;
+        s->first = (int)((long)tiles * t / threads) * GNN_BATCH_TILE;
+        s->last = (int)((long)tiles * (t + 1) / threads) * GNN_BATCH_TILE;
+        if (s->last > b->count) s->last = b->count;
+    }
+    int started = 1;
+    while (started < threads &&
+           pthread_create(&slices[started].thread, NULL, predict_slice, &slices[started]) == 0) {
+        started++;
     }
-    
-    return sum / INPUT_SIZE;
+    // Slices whose thread could not be started run here too
+    predict_slice(&slices[0]);
+    for (int t = started; t < threads; t++) predict_slice(&slices[t]);
+    for (int t = 1; t < started; t++) pthread_join(slices[t].thread, NULL);
 }
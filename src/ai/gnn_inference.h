@@ -1,5 +1,77 @@
 #pragma once
+#include "../engine/fanorona.h"
+#include <stdbool.h>
+#include <stdint.h>
 
-#define INPUT_SIZE 81  // 9x9 board positions
+// Small fully connected evaluator:
+// INPUT_SIZE -> GNN_HIDDEN1 -> GNN_HIDDEN2 -> 1, clipped ReLU between layers.
+// Inputs are the stones of the side to move on points 0-44, then the
+// opponent's stones on points 45-89.
+#define INPUT_SIZE  (2 * BOARD_POINTS)
+#define GNN_HIDDEN1 64
+#define GNN_HIDDEN2 32
 
-float gnn_predict(const float state_vec[INPUT_SIZE]);
\ No newline at end of file
+// Weight file: a GnnHeader, then little-endian float32 arrays in this order:
+// w1[INPUT_SIZE][GNN_HIDDEN1] (one row per input), b1[GNN_HIDDEN1],
+// w2[GNN_HIDDEN2][GNN_HIDDEN1], b2[GNN_HIDDEN2], w3[GNN_HIDDEN2], b3
+#define GNN_MAGIC   "FNRN"
+#define GNN_VERSION 1
+
+typedef struct {
+    char     magic[4];
+    uint32_t version;
+    uint32_t inputs, hidden1, hidden2;
+    uint32_t reserved[3];
+} GnnHeader; // 32 bytes, keeps the arrays 32-byte aligned in the mapping
+
+// The network is global. Loading or replacing it must not overlap with
+// evaluations running on other threads.
+bool gnn_load(const char *path);    // mmaps the file; on failure the old net stays
+bool gnn_save(const char *path);
+void gnn_init_random(uint64_t seed); // untrained weights, for benchmarks
+void gnn_unload(void);
+bool gnn_ready(void);
+const char *gnn_kernel_name(void);  // "avx2", "sse2" or "scalar"
+
+// First-layer sums kept up to date move by move (NNUE style), one set per
+// perspective so that the side to move can be read off without a refresh.
+// Each make pushes a copy updated by the moved stone and the captures;
+// unmake pops it, so nothing drifts however long the game. Past
+// GNN_ACC_DEPTH plies the stack restarts from the current position and
+// an unmake below that point recomputes from the board.
+#define GNN_ACC_DEPTH 128
+
+typedef struct {
+    float v[GNN_ACC_DEPTH][2][GNN_HIDDEN1]; // [ply][0 = white to move, 1 = black]
+    int   top;
+} GnnAccumulator;
+
+void  gnn_acc_reset(GnnAccumulator *a, const GameState *g);
+void  gnn_acc_make(GnnAccumulator *a, const GameState *g, const Undo *u); // after game_make
+void  gnn_acc_unmake(GnnAccumulator *a, const GameState *g);             // after game_unmake
+float gnn_acc_evaluate(const GnnAccumulator *a, const GameState *g);
+
+void  gnn_encode(const GameState *g, float state_vec[INPUT_SIZE]);
+float gnn_predict(const float state_vec[INPUT_SIZE]); // -1..1 for the side to move
+float gnn_evaluate(const GameState *g);
+
+// Positions packed as two bitboards each, stored as separate arrays so that
+// a tile of positions is read from two contiguous runs
+#define GNN_BATCH_TILE 16         // positions per tile, sized for L1
+#define GNN_BATCH_MIN_PER_THREAD 256
+
+typedef struct {
+    Bitboard *own;   // stones of the side to move
+    Bitboard *opp;
+    int       count;
+    int       capacity;
+} GnnBatch;
+
+bool gnn_batch_init(GnnBatch *b, int capacity);
+void gnn_batch_free(GnnBatch *b);
+void gnn_batch_clear(GnnBatch *b);
+bool gnn_batch_add(GnnBatch *b, const GameState *g); // false when full
+
+// out[i] = gnn_evaluate() of position i. threads: 0 = one per core, 1 =
+// calling thread only; batches too small to share stay on one thread.
+void gnn_predict_batch(const GnnBatch *b, float *out, int threads);
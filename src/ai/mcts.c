@@ -0,0 +1,444 @@
+#define _POSIX_C_SOURCE 200112L
+#include "mcts.h"
+#include "gnn_inference.h"
+#include "tablebase.h"
+#include "../core/clock.h"
+#include "../engine/chain.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define NODE_NONE     UINT32_MAX
+#define VALUE_ONE     65536    // value sums are fixed point so threads can add atomically
+#define PRIOR_SHARPNESS 4.0f   // network priors: softmax of child values times this
+#define REPORT_INTERVAL 0.1
+
+enum { NODE_LEAF, NODE_EXPANDING, NODE_EXPANDED };
+
+typedef struct {
+    Turn     move;         // turn from the parent to here
+    int64_t  value_sum;    // VALUE_ONE units, for the player who made `move`
+    int32_t  visits;
+    int32_t  virtual_loss;
+    float    prior;
+    uint32_t first_child;  // children are one contiguous block of the arena
+    uint16_t child_count;
+    uint8_t  state;        // NODE_*; expanded with no children = side to move lost
+} Node;
+
+struct Mcts {
+    Node     *nodes;
+    uint32_t  capacity;
+    uint32_t  used;        // taken atomically by expansions
+    uint32_t  root;
+    GameState root_pos;
+    bool      has_root;
+    int       full;        // set when an expansion did not fit
+};
+
+typedef struct {
+    Mcts       *m;
+    MctsEval    eval;
+    int        *stop;
+    uint64_t    rng;
+    uint64_t    simulations;
+    int         max_depth;
+    GnnBatch    batch;
+    GnnAccumulator acc;    // first layer of the network along the current path
+    float       values[MAX_TURNS + 1];
+    Turn        turns[MAX_TURNS];
+    pthread_t   thread;
+} Worker;
+
+Mcts *mcts_create(size_t arena_mb) {
+    if (arena_mb == 0) arena_mb = 1;
+    size_t count = arena_mb * 1024 * 1024 / sizeof(Node);
+    if (count > UINT32_MAX - MAX_TURNS * SEARCH_MAX_THREADS) count = UINT32_MAX - MAX_TURNS * SEARCH_MAX_THREADS;
+
+    Mcts *m = malloc(sizeof(Mcts));
+    if (!m) return NULL;
+    memset(m, 0, sizeof(Mcts));
+    m->nodes = malloc(count * sizeof(Node));
+    if (!m->nodes) {
+        free(m);
+        return NULL;
+    }
+    m->capacity = (uint32_t)count;
+    return m;
+}
+
+void mcts_destroy(Mcts *m) {
+    if (!m) return;
+    free(m->nodes);
+    free(m);
+}
+
+void mcts_clear(Mcts *m) {
+    if (!m) return;
+    m->used = 0;
+    m->has_root = false;
+    m->full = 0;
+}
+
+static void node_init(Node *n, const Turn *move, float prior) {
+    memset(n, 0, sizeof(Node));
+    if (move) n->move = *move;
+    n->prior = prior;
+    n->first_child = NODE_NONE;
+}
+
+static uint32_t alloc_block(Mcts *m, int n) {
+    uint32_t first = __atomic_fetch_add(&m->used, (uint32_t)n, __ATOMIC_RELAXED);
+    if (first > m->capacity - n) {
+        __atomic_store_n(&m->full, 1, __ATOMIC_RELAXED);
+        return NODE_NONE;
+    }
+    return first;
+}
+
+static bool same_position(const GameState *a, const GameState *b) {
+    return a->hash == b->hash && a->pieces[0] == b->pieces[0] &&
+           a->pieces[1] == b->pieces[1] && a->current_player == b->current_player;
+}
+
+// Child of `parent` whose position is g, or NODE_NONE
+static uint32_t find_child(const Mcts *m, uint32_t parent, const GameState *from, const GameState *g,
+                           GameState *child_pos) {
+    const Node *p = &m->nodes[parent];
+    if (p->state != NODE_EXPANDED) return NODE_NONE;
+    for (int i = 0; i < p->child_count; i++) {
+        *child_pos = *from;
+        game_apply_turn(child_pos, &m->nodes[p->first_child + i].move);
+        if (same_position(child_pos, g)) return p->first_child + i;
+    }
+    return NODE_NONE;
+}
+
+// Keeps the subtree of g when it is the old root or one or two turns below
+// it. Nodes outside it stay allocated until the arena is half used, at
+// which point the tree starts over.
+static void set_root(Mcts *m, const GameState *g) {
+    if (m->has_root && m->used <= m->capacity / 2) {
+        if (same_position(&m->root_pos, g)) return;
+
+        GameState pos;
+        uint32_t found = find_child(m, m->root, &m->root_pos, g, &pos);
+        const Node *r = &m->nodes[m->root];
+        for (int i = 0; found == NODE_NONE && r->state == NODE_EXPANDED && i < r->child_count; i++) {
+            GameState mid = m->root_pos;
+            game_apply_turn(&mid, &m->nodes[r->first_child + i].move);
+            found = find_child(m, r->first_child + i, &mid, g, &pos);
+        }
+        if (found != NODE_NONE) {
+            m->root = found;
+            m->root_pos = *g;
+            return;
+        }
+    }
+    mcts_clear(m);
+    m->root = alloc_block(m, 1);
+    node_init(&m->nodes[m->root], NULL, 1.0f);
+    m->root_pos = *g;
+    m->has_root = true;
+}
+
+static uint64_t rng_next(uint64_t *s) {
+    *s ^= *s << 13;
+    *s ^= *s >> 7;
+    *s ^= *s << 17;
+    return *s;
+}
+
+// Exact value for the side to move when the endgame tables cover pos
+static bool table_value(const GameState *pos, float *value) {
+    int result, distance;
+    if (bb_count(pos->pieces[0] | pos->pieces[1]) > tb_max_pieces()) return false;
+    if (!tb_probe(pos, &result, &distance)) return false;
+    *value = (float)result;
+    return true;
+}
+
+// Value of pos for its side to move, -1..1
+static float playout(Worker *w, GameState pos) {
+    int side = pos.current_player - 1;
+    for (int ply = 0; ply < MCTS_PLAYOUT_PLIES; ply++) {
+        float exact;
+        if (table_value(&pos, &exact)) return pos.current_player - 1 == side ? exact : -exact;
+        int n = chain_generate(&pos, w->turns, MAX_TURNS);
+        if (n > MAX_TURNS) n = MAX_TURNS; // plays among the first MAX_TURNS
+        if (n == 0) return pos.current_player - 1 == side ? -1.0f : 1.0f;
+        game_apply_turn(&pos, &w->turns[rng_next(&w->rng) % (uint64_t)n]);
+    }
+    int own = bb_count(pos.pieces[side]), opp = bb_count(pos.pieces[side ^ 1]);
+    return (float)(own - opp) / (float)(own + opp);
+}
+
+static bool use_network(const Worker *w) {
+    return w->eval == MCTS_EVAL_NETWORK && gnn_ready();
+}
+
+// pos is where simulate() stands, so the accumulator holds it
+static float leaf_value(Worker *w, const GameState *pos) {
+    float exact;
+    if (use_network(w) && table_value(pos, &exact)) return exact;
+    return use_network(w) ? gnn_acc_evaluate(&w->acc, pos) : playout(w, *pos);
+}
+
+// Creates the children of a node this thread has claimed and returns the
+// node's value for its side to move
+static float expand(Worker *w, Node *node, const GameState *pos) {
+    Mcts *m = w->m;
+    int n = chain_generate(pos, w->turns, MAX_TURNS);
+    if (n > MAX_TURNS) n = MAX_TURNS; // the tree holds the first MAX_TURNS only
+    if (n == 0) {
+        node->child_count = 0;
+        __atomic_store_n(&node->state, NODE_EXPANDED, __ATOMIC_RELEASE);
+        return -1.0f;
+    }
+    uint32_t first = alloc_block(m, n);
+    if (first == NODE_NONE) {
+        __atomic_store_n(&node->state, NODE_LEAF, __ATOMIC_RELEASE);
+        return leaf_value(w, pos);
+    }
+
+    float value = 0.0f, total = 0.0f;
+    if (use_network(w)) {
+        // One batch for the children; the node itself is on the accumulator
+        gnn_batch_clear(&w->batch);
+        for (int i = 0; i < n; i++) {
+            GameState child = *pos;
+            game_apply_turn(&child, &w->turns[i]);
+            gnn_batch_add(&w->batch, &child);
+        }
+        gnn_predict_batch(&w->batch, w->values, 1);
+        if (!table_value(pos, &value)) value = gnn_acc_evaluate(&w->acc, pos);
+        float best = -w->values[0];
+        for (int i = 1; i < n; i++) if (-w->values[i] > best) best = -w->values[i];
+        for (int i = 0; i < n; i++) {
+            w->values[i] = expf((-w->values[i] - best) * PRIOR_SHARPNESS);
+            total += w->values[i];
+        }
+    } else {
+        // Bigger captures first, as in the alpha-beta move ordering
+        for (int i = 0; i < n; i++) {
+            w->values[i] = 1.0f + (float)bb_count(w->turns[i].captured);
+            total += w->values[i];
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        node_init(&m->nodes[first + i], &w->turns[i], w->values[i] / total);
+    }
+    // The playout reuses w->turns, so it comes last
+    if (!use_network(w)) value = playout(w, *pos);
+    node->first_child = first;
+    node->child_count = (uint16_t)n;
+    __atomic_store_n(&node->state, NODE_EXPANDED, __ATOMIC_RELEASE);
+    return value;
+}
+
+static uint32_t select_child(const Mcts *m, const Node *node) {
+    int parent = __atomic_load_n(&node->visits, __ATOMIC_RELAXED) +
+                 __atomic_load_n(&node->virtual_loss, __ATOMIC_RELAXED);
+    float explore = MCTS_C_PUCT * sqrtf((float)(parent > 0 ? parent : 1));
+    uint32_t best = node->first_child;
+    float best_score = -INFINITY;
+
+    for (int i = 0; i < node->child_count; i++) {
+        const Node *c = &m->nodes[node->first_child + i];
+        int visits = __atomic_load_n(&c->visits, __ATOMIC_RELAXED);
+        int vl = __atomic_load_n(&c->virtual_loss, __ATOMIC_RELAXED);
+        int64_t sum = __atomic_load_n(&c->value_sum, __ATOMIC_RELAXED);
+        int n = visits + vl;
+        // Every virtual loss counts as a lost visit
+        float q = n > 0 ? ((float)sum / VALUE_ONE - (float)vl) / (float)n : 0.0f;
+        float score = q + explore * c->prior / (float)(1 + n);
+        if (score > best_score) {
+            best_score = score;
+            best = node->first_child + i;
+        }
+    }
+    return best;
+}
+
+static void simulate(Worker *w) {
+    Mcts *m = w->m;
+    GameState pos = m->root_pos;
+    uint32_t path[MCTS_MAX_DEPTH + 1];
+    Undo undo[MCTS_MAX_DEPTH + 1];
+    bool network = use_network(w);
+    int depth = 0;
+    float value;
+
+    path[0] = m->root;
+    __atomic_add_fetch(&m->nodes[m->root].virtual_loss, MCTS_VIRTUAL_LOSS, __ATOMIC_RELAXED);
+    for (;;) {
+        Node *node = &m->nodes[path[depth]];
+        uint8_t state = __atomic_load_n(&node->state, __ATOMIC_ACQUIRE);
+        if (state == NODE_EXPANDED) {
+            if (node->child_count == 0) {
+                value = -1.0f;
+                break;
+            }
+            if (depth == MCTS_MAX_DEPTH) {
+                value = leaf_value(w, &pos);
+                break;
+            }
+            uint32_t next = select_child(m, node);
+            __atomic_add_fetch(&m->nodes[next].virtual_loss, MCTS_VIRTUAL_LOSS, __ATOMIC_RELAXED);
+            path[++depth] = next;
+            game_make(&pos, &m->nodes[next].move, &undo[depth]);
+            if (network) gnn_acc_make(&w->acc, &pos, &undo[depth]);
+            continue;
+        }
+        uint8_t expected = NODE_LEAF;
+        if (state == NODE_LEAF &&
+            __atomic_compare_exchange_n(&node->state, &expected, NODE_EXPANDING, false,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            value = expand(w, node, &pos);
+        } else {
+            // Another thread is expanding it
+            value = leaf_value(w, &pos);
+        }
+        break;
+    }
+    // Back to the root, where the next simulation starts
+    for (int d = depth; d > 0 && network; d--) {
+        game_unmake(&pos, &undo[d]);
+        gnn_acc_unmake(&w->acc, &pos);
+    }
+
+    // value is for the side to move at the leaf; each node stores the
+    // result for the player who moved into it
+    for (int d = depth; d >= 0; d--) {
+        Node *node = &m->nodes[path[d]];
+        __atomic_add_fetch(&node->value_sum, (int64_t)(-value * VALUE_ONE), __ATOMIC_RELAXED);
+        __atomic_add_fetch(&node->visits, 1, __ATOMIC_RELAXED);
+        __atomic_sub_fetch(&node->virtual_loss, MCTS_VIRTUAL_LOSS, __ATOMIC_RELAXED);
+        value = -value;
+    }
+    if (depth > w->max_depth) w->max_depth = depth;
+    w->simulations++;
+}
+
+static void *helper_main(void *arg) {
+    Worker *w = arg;
+    while (!__atomic_load_n(w->stop, __ATOMIC_RELAXED) && !__atomic_load_n(&w->m->full, __ATOMIC_RELAXED)) {
+        simulate(w);
+    }
+    return NULL;
+}
+
+// Most visited root child, and the root value for the side to move
+static void fill_result(const Mcts *m, SearchResult *out) {
+    const Node *root = &m->nodes[m->root];
+    if (__atomic_load_n(&root->state, __ATOMIC_ACQUIRE) != NODE_EXPANDED) return;
+
+    int best_visits = -1;
+    for (int i = 0; i < root->child_count; i++) {
+        const Node *c = &m->nodes[root->first_child + i];
+        int visits = __atomic_load_n(&c->visits, __ATOMIC_RELAXED);
+        if (visits > best_visits) {
+            best_visits = visits;
+            out->best = c->move;
+            out->has_move = true;
+        }
+    }
+    int visits = __atomic_load_n(&root->visits, __ATOMIC_RELAXED);
+    int64_t sum = __atomic_load_n(&root->value_sum, __ATOMIC_RELAXED);
+    if (visits > 0) out->score = (int)(-1000.0 * (double)sum / VALUE_ONE / visits);
+}
+
+// w comes zeroed from calloc()
+static void worker_init(Worker *w, Mcts *m, MctsEval eval, int *stop, uint64_t seed) {
+    w->m = m;
+    w->eval = eval;
+    w->stop = stop;
+    w->rng = seed ? seed : 1;
+    if (eval == MCTS_EVAL_NETWORK) {
+        gnn_batch_init(&w->batch, MAX_TURNS + 1);
+        gnn_acc_reset(&w->acc, &m->root_pos);
+    }
+}
+
+static int thread_count(const SearchLimits *lim) {
+    int threads = lim->threads;
+    if (threads <= 0) threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads < 1) threads = 1;
+    if (threads > SEARCH_MAX_THREADS) threads = SEARCH_MAX_THREADS;
+    return threads;
+}
+
+bool mcts_search(Mcts *m, const GameState *g, const SearchLimits *lim,
+                 MctsEval eval, SearchResult *out) {
+    if (!m || !g || !lim || !out) return false;
+    memset(out, 0, sizeof(SearchResult));
+
+    double start = clock_now();
+    Turn turns[MAX_TURNS];
+    int n = chain_generate(g, turns, MAX_TURNS);
+    if (n > MAX_TURNS) n = MAX_TURNS; // the tree holds the first MAX_TURNS only
+    if (n == 0) return false;
+
+    out->best = turns[0];
+    out->has_move = true;
+    out->threads = 1;
+    if (n == 1 && lim->time_limit > 0) {
+        // A forced reply needs no search
+        out->elapsed = clock_now() - start;
+        return true;
+    }
+
+    set_root(m, g);
+    m->full = 0;
+    int threads = thread_count(lim);
+    Worker *workers = calloc(threads, sizeof(Worker));
+    if (!workers) return false;
+
+    int stop = 0, started = 1;
+    uint64_t seed = (uint64_t)(start * 1e9) ^ g->hash;
+    for (int i = 0; i < threads; i++) {
+        worker_init(&workers[i], m, eval, &stop, seed + 0x9E3779B97F4A7C15ULL * (i + 1));
+    }
+    while (started < threads &&
+           pthread_create(&workers[started].thread, NULL, helper_main, &workers[started]) == 0) {
+        started++;
+    }
+
+    // The calling thread searches too, and watches the clock
+    Worker *w = &workers[0];
+    double deadline = lim->time_limit > 0 ? start + lim->time_limit : 0;
+    double next_report = start + REPORT_INTERVAL;
+    while (!__atomic_load_n(&m->full, __ATOMIC_RELAXED)) {
+        simulate(w);
+        if ((w->simulations & 15) != 0) continue;
+        if (lim->cancel && __atomic_load_n(lim->cancel, __ATOMIC_RELAXED)) break;
+        double now = clock_now();
+        if (deadline > 0 && now >= deadline) break;
+        if (lim->on_iteration && now >= next_report) {
+            SearchResult partial = *out;
+            fill_result(m, &partial);
+            partial.nodes = w->simulations * started;
+            partial.depth = w->max_depth;
+            partial.elapsed = now - start;
+            lim->on_iteration(&partial, lim->userdata);
+            next_report = now + REPORT_INTERVAL;
+        }
+    }
+
+    __atomic_store_n(&stop, 1, __ATOMIC_RELAXED);
+    for (int i = 0; i < threads; i++) {
+        if (i > 0 && i < started) pthread_join(workers[i].thread, NULL);
+        out->thread_nodes[i] = workers[i].simulations;
+        out->nodes += workers[i].simulations;
+        if (workers[i].max_depth > out->depth) out->depth = workers[i].max_depth;
+        gnn_batch_free(&workers[i].batch);
+    }
+    fill_result(m, out);
+    out->threads = started;
+    out->node_ratio = w->simulations ? (double)out->nodes / w->simulations : 1.0;
+    out->elapsed = clock_now() - start;
+    free(workers);
+    return true;
+}
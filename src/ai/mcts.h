@@ -0,0 +1,31 @@
+#pragma once
+#include "minimax.h"
+#include <stddef.h>
+
+// Monte-Carlo tree search with PUCT selection, an alternative to
+// minimax_search(). Leaves are scored by a random playout or by the neural
+// evaluator. Nodes live in one arena allocated up front, threads share the
+// tree and spread out with virtual loss, and the subtree under the next
+// position is kept from one search to the next.
+
+typedef enum { MCTS_EVAL_PLAYOUT, MCTS_EVAL_NETWORK } MctsEval;
+
+#define MCTS_C_PUCT        1.5f
+#define MCTS_VIRTUAL_LOSS  3   // losses charged to a node while a thread is below it
+#define MCTS_PLAYOUT_PLIES 120 // longer playouts are scored by material
+#define MCTS_MAX_DEPTH     128
+
+typedef struct Mcts Mcts;
+
+Mcts *mcts_create(size_t arena_mb);
+void  mcts_destroy(Mcts *m);
+void  mcts_clear(Mcts *m);
+
+// Uses lim->time_limit, threads, cancel and on_iteration (called about ten
+// times a second). Also stops when the arena is full, which is the only
+// limit when there is no time limit. out->nodes counts simulations,
+// out->depth is the deepest node reached and out->score the root value
+// for the side to move, scaled to -1000..1000. MCTS_EVAL_NETWORK falls
+// back to playouts when no network is loaded.
+bool mcts_search(Mcts *m, const GameState *g, const SearchLimits *lim,
+                 MctsEval eval, SearchResult *out);
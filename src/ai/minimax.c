@@ -1,16 +1,412 @@
+#define _POSIX_C_SOURCE 200112L
 #include "minimax.h"
+#include "tablebase.h"
+#include "../engine/chain.h"
+#include "../core/clock.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
-double minimax_eval(const GameState *g, int depth) {
-    if (!g || depth <= 0) return 0.0;
-    
-    // Basic evaluation: count pieces
-    double score = 0.0;
-    for (int x = 0; x < 9; x++) {
-        for (int y = 0; y < 5; y++) {
-            if (g->board[x][y] == WHITE) score += 1.0;
-            else if (g->board[x][y] == BLACK) score -= 1.0;
+#define STRONG_BONUS  4
+#define QSEARCH_PLIES 4
+
+typedef struct {
+    GameState pos;
+    Turn      turns[SEARCH_MAX_PLY][MAX_TURNS];
+    int       order[SEARCH_MAX_PLY][MAX_TURNS];
+    Turn      killers[SEARCH_MAX_PLY][2];
+    int       history[2][BOARD_POINTS][BOARD_POINTS];
+    uint64_t  path[SEARCH_MAX_PLY + 1]; // hashes from the root, for repetitions
+    uint64_t  nodes;
+    double    start, deadline;          // deadline 0 = none
+    bool      stop;
+    int      *shared_stop;              // raised when the main thread finishes
+    const int *cancel;                  // raised by the caller
+    TransTable *tt;
+    uint64_t  tt_probes, tt_hits;
+} Searcher;
+
+int minimax_evaluate(const GameState *g) {
+    int side = g->current_player - 1;
+    Bitboard strong = DIR_MASK[DIR_SE] | DIR_MASK[DIR_NW] | DIR_MASK[DIR_SW] | DIR_MASK[DIR_NE];
+    Bitboard own = g->pieces[side], opp = g->pieces[side ^ 1];
+
+    // Stones on strong points have more lines to move and capture along
+    int score = (bb_count(own) - bb_count(opp)) * STONE_VALUE;
+    score += (bb_count(own & strong) - bb_count(opp & strong)) * STRONG_BONUS;
+    return score;
+}
+
+static bool time_up(Searcher *s) {
+    if (s->stop) return true;
+    if ((s->nodes & 1023) == 0) {
+        if (__atomic_load_n(s->shared_stop, __ATOMIC_RELAXED)) s->stop = true;
+        if (s->cancel && __atomic_load_n(s->cancel, __ATOMIC_RELAXED)) s->stop = true;
+        if (s->deadline > 0 && clock_now() >= s->deadline) s->stop = true;
+    }
+    return s->stop;
+}
+
+static bool is_repetition(const Searcher *s, int ply) {
+    for (int i = ply - 2; i >= 0; i -= 2) {
+        if (s->path[i] == s->path[ply]) return true;
+    }
+    return false;
+}
+
+// Hash move first, then captures by size, then killers, then the history
+// heuristic for paika moves
+static void score_turns(Searcher *s, int ply, int n, int *scores, uint32_t tt_move) {
+    int side = s->pos.current_player - 1;
+    for (int i = 0; i < n; i++) {
+        const Turn *t = &s->turns[ply][i];
+        if (tt_move && tt_move_key(t) == tt_move) {
+            scores[i] = 2000000;
+        } else if (t->captured) {
+            scores[i] = 1000000 + bb_count(t->captured) * 1000 - t->length;
+        } else if (game_turn_equal(t, &s->killers[ply][0])) {
+            scores[i] = 900000;
+        } else if (game_turn_equal(t, &s->killers[ply][1])) {
+            scores[i] = 800000;
+        } else {
+            scores[i] = s->history[side][t->path[0]][t->path[1]];
         }
+        s->order[ply][i] = i;
     }
-    
-    return score;
+}
+
+// Selection sort step: brings the next best turn to position k
+static const Turn *next_turn(Searcher *s, int ply, int k, int n, int *scores) {
+    int *order = s->order[ply];
+    int best = k;
+    for (int i = k + 1; i < n; i++) {
+        if (scores[order[i]] > scores[order[best]]) best = i;
+    }
+    int tmp = order[k];
+    order[k] = order[best];
+    order[best] = tmp;
+    return &s->turns[ply][order[k]];
+}
+
+static void note_cutoff(Searcher *s, int ply, const Turn *t, int depth) {
+    if (t->captured) return;
+    if (!game_turn_equal(t, &s->killers[ply][0])) {
+        s->killers[ply][1] = s->killers[ply][0];
+        s->killers[ply][0] = *t;
+    }
+    int *h = &s->history[s->pos.current_player - 1][t->path[0]][t->path[1]];
+    *h += depth * depth;
+    if (*h > 700000) {
+        for (int i = 0; i < 2 * BOARD_POINTS * BOARD_POINTS; i++) (&s->history[0][0][0])[i] /= 2;
+    }
+}
+
+static int search(Searcher *s, int depth, int ply, int alpha, int beta) {
+    if (time_up(s)) return 0;
+    s->nodes++;
+    s->path[ply] = s->pos.hash;
+
+    if (ply > 0 && is_repetition(s, ply)) return 0;
+
+    // Endgame tables: exact result, ranked below any win seen by the search
+    if (ply > 0 && bb_count(s->pos.pieces[0] | s->pos.pieces[1]) <= tb_max_pieces()) {
+        int result, distance;
+        if (tb_probe(&s->pos, &result, &distance)) {
+            return result * (SCORE_TB_WIN - ply - distance);
+        }
+    }
+
+    // Past the horizon, keep resolving pending captures for a few plies.
+    // Captures are compulsory, but standing pat on the static score still
+    // bounds the explosion of chain prefixes well enough.
+    int best = -SCORE_INF;
+    if (depth <= 0) {
+        Step steps[MAX_STEPS];
+        int n = game_gen_steps(&s->pos, steps);
+        if (n == 0) return -SCORE_WIN + ply;
+
+        int stand_pat = minimax_evaluate(&s->pos);
+        if (steps[0].capture == CAPTURE_NONE || depth <= -QSEARCH_PLIES ||
+            ply >= SEARCH_MAX_PLY - 1 || stand_pat >= beta) {
+            return stand_pat;
+        }
+        if (stand_pat > alpha) alpha = stand_pat;
+        best = stand_pat;
+    }
+
+    // Hash table: cut off on a deep enough bound, else borrow its move
+    uint32_t tt_move = 0;
+    if (s->tt && depth > 0) {
+        TTHit hit;
+        s->tt_probes++;
+        if (tt_probe(s->tt, s->pos.hash, ply, &hit)) {
+            s->tt_hits++;
+            tt_move = hit.move;
+            if (ply > 0 && hit.depth >= depth &&
+                (hit.bound == TT_EXACT ||
+                 (hit.bound == TT_LOWER && hit.score >= beta) ||
+                 (hit.bound == TT_UPPER && hit.score <= alpha))) {
+                return hit.score;
+            }
+        }
+    }
+
+    int n = chain_generate(&s->pos, s->turns[ply], MAX_TURNS);
+    if (n > MAX_TURNS) n = MAX_TURNS; // the search sees the first MAX_TURNS only
+    if (n == 0) return -SCORE_WIN + ply;
+
+    int scores[MAX_TURNS];
+    score_turns(s, ply, n, scores, tt_move);
+
+    int alpha_orig = alpha;
+    uint32_t best_move = 0;
+
+    for (int k = 0; k < n; k++) {
+        const Turn *t = next_turn(s, ply, k, n, scores);
+        Undo u;
+        int score;
+
+        game_make(&s->pos, t, &u);
+        if (k == 0) {
+            score = -search(s, depth - 1, ply + 1, -beta, -alpha);
+        } else {
+            // Principal variation search: prove the rest are worse with a null window
+            score = -search(s, depth - 1, ply + 1, -alpha - 1, -alpha);
+            if (score > alpha && score < beta) {
+                score = -search(s, depth - 1, ply + 1, -beta, -alpha);
+            }
+        }
+        game_unmake(&s->pos, &u);
+        if (s->stop) return 0;
+
+        if (score > best) best = score;
+        if (score > alpha) {
+            alpha = score;
+            best_move = tt_move_key(t);
+        }
+        if (alpha >= beta) {
+            note_cutoff(s, ply, t, depth);
+            break;
+        }
+    }
+
+    if (s->tt && depth > 0) {
+        TTBound bound = best <= alpha_orig ? TT_UPPER : best >= beta ? TT_LOWER : TT_EXACT;
+        tt_store(s->tt, s->pos.hash, ply, depth, best, bound, best_move);
+    }
+    return best;
+}
+
+// One iteration at the root. Keeps the previous best first so a partial
+// iteration can still be trusted once that move has been searched.
+static bool search_root(Searcher *s, int depth, Turn *root, int n, Turn *best, int *best_score) {
+    int alpha = -SCORE_INF, beta = SCORE_INF;
+    bool any = false;
+
+    for (int k = 0; k < n; k++) {
+        Undo u;
+        int score;
+        game_make(&s->pos, &root[k], &u);
+        if (k == 0) {
+            score = -search(s, depth - 1, 1, -beta, -alpha);
+        } else {
+            score = -search(s, depth - 1, 1, -alpha - 1, -alpha);
+            if (score > alpha) score = -search(s, depth - 1, 1, -beta, -alpha);
+        }
+        game_unmake(&s->pos, &u);
+        if (s->stop) break;
+
+        any = true;
+        if (score > alpha) {
+            alpha = score;
+            *best = root[k];
+            *best_score = score;
+        }
+    }
+    return any;
+}
+
+// Iterative deepening for one thread. Helper threads start at staggered
+// depths so they fill the shared hash table ahead of the main thread.
+static void iterate(Searcher *s, Turn *root, int n, int first_depth, int max_depth,
+                    const SearchLimits *lim, SearchResult *out) {
+    for (int depth = first_depth; depth <= max_depth; depth++) {
+        Turn best = root[0];
+        int best_score = -SCORE_INF;
+        bool any = search_root(s, depth, root, n, &best, &best_score);
+        if (any && best_score > -SCORE_INF) {
+            out->best = best;
+            out->score = best_score;
+        }
+        if (s->stop) break;
+        out->depth = depth;
+        out->depth_time[depth] = clock_now() - s->start;
+        if (lim && lim->on_iteration) {
+            out->nodes = s->nodes;
+            out->elapsed = clock_now() - s->start;
+            lim->on_iteration(out, lim->userdata);
+        }
+
+        // Move the best turn to the front for the next iteration
+        for (int i = 0; i < n; i++) {
+            if (game_turn_equal(&root[i], &best)) {
+                root[i] = root[0];
+                root[0] = best;
+                break;
+            }
+        }
+        if (best_score >= SCORE_WIN - SEARCH_MAX_PLY || best_score <= -SCORE_WIN + SEARCH_MAX_PLY) break;
+    }
+}
+
+typedef struct {
+    pthread_t    thread;
+    Searcher    *s;
+    Turn         root[MAX_TURNS];
+    int          n, first_depth, max_depth;
+    SearchResult result;
+} Helper;
+
+static void *helper_main(void *arg) {
+    Helper *h = arg;
+    iterate(h->s, h->root, h->n, h->first_depth, h->max_depth, NULL, &h->result);
+    return NULL;
+}
+
+static Searcher *searcher_create(const GameState *g, const SearchLimits *lim,
+                                 double start, int *shared_stop) {
+    Searcher *s = calloc(1, sizeof(Searcher));
+    if (!s) return NULL;
+    s->pos = *g;
+    s->path[0] = g->hash;
+    s->start = start;
+    s->deadline = lim->time_limit > 0 ? start + lim->time_limit : 0;
+    s->tt = lim->tt;
+    s->shared_stop = shared_stop;
+    s->cancel = lim->cancel;
+    return s;
+}
+
+static void searcher_finish(Searcher *s) {
+    if (s->tt) tt_add_stats(s->tt, s->tt_probes, s->tt_hits);
+    free(s);
+}
+
+static int thread_count(const SearchLimits *lim) {
+    int threads = lim->threads;
+    if (threads <= 0) threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads < 1) threads = 1;
+    if (threads > SEARCH_MAX_THREADS) threads = SEARCH_MAX_THREADS;
+    // Helpers without a shared table would only duplicate the main thread
+    return lim->tt ? threads : 1;
+}
+
+bool minimax_search(const GameState *g, const SearchLimits *lim, SearchResult *out) {
+    if (!g || !lim || !out) return false;
+    memset(out, 0, sizeof(SearchResult));
+
+    double start = clock_now();
+    int shared_stop = 0;
+    Searcher *s = searcher_create(g, lim, start, &shared_stop);
+    if (!s) return false;
+    if (!lim->keep_generation) tt_new_search(s->tt);
+
+    Turn root[MAX_TURNS];
+    int n = chain_generate(g, root, MAX_TURNS);
+    if (n > MAX_TURNS) n = MAX_TURNS; // the search sees the first MAX_TURNS only
+    if (n == 0) {
+        free(s);
+        return false;
+    }
+
+    out->best = root[0];
+    out->has_move = true;
+    out->threads = 1;
+    if (n == 1 && lim->time_limit > 0) {
+        // A forced reply needs no search
+        game_apply_turn(&s->pos, &root[0]);
+        out->score = -minimax_evaluate(&s->pos);
+        out->elapsed = clock_now() - start;
+        free(s);
+        return true;
+    }
+    int max_depth = lim->max_depth > 0 ? lim->max_depth : SEARCH_MAX_PLY - 1;
+    if (max_depth > SEARCH_MAX_PLY - 1) max_depth = SEARCH_MAX_PLY - 1;
+
+    // Lazy SMP: helpers run the same search and share only the hash table
+    int threads = thread_count(lim);
+    Helper *helpers = threads > 1 ? calloc(threads - 1, sizeof(Helper)) : NULL;
+    int started = 0;
+    for (int i = 0; helpers && i < threads - 1; i++) {
+        Helper *h = &helpers[i];
+        h->s = searcher_create(g, lim, start, &shared_stop);
+        if (!h->s) break;
+        memcpy(h->root, root, n * sizeof(Turn));
+        h->n = n;
+        h->first_depth = 1 + (i + 1) % 2;
+        h->max_depth = max_depth;
+        if (pthread_create(&h->thread, NULL, helper_main, h) != 0) {
+            free(h->s);
+            break;
+        }
+        started++;
+    }
+
+    iterate(s, root, n, 1, max_depth, lim, out);
+
+    __atomic_store_n(&shared_stop, 1, __ATOMIC_RELAXED);
+    out->thread_nodes[0] = s->nodes;
+    out->nodes = s->nodes;
+    for (int i = 0; i < started; i++) {
+        pthread_join(helpers[i].thread, NULL);
+        out->thread_nodes[i + 1] = helpers[i].s->nodes;
+        out->nodes += helpers[i].s->nodes;
+        searcher_finish(helpers[i].s);
+    }
+    free(helpers);
+
+    out->threads = started + 1;
+    out->node_ratio = s->nodes ? (double)out->nodes / s->nodes : 1.0;
+    out->elapsed = clock_now() - start;
+    searcher_finish(s);
+    return true;
+}
+
+void minimax_limits(SearchLimits *lim, int difficulty, const GameManager *gm) {
+    static const int    depth_for_level[5] = { 2, 4, 6, 10, 0 };
+    static const double time_for_level[5]  = { 0.1, 0.3, 1.0, 3.0, 10.0 };
+
+    memset(lim, 0, sizeof(SearchLimits));
+    if (difficulty < 1) difficulty = 1;
+    if (difficulty > 5) difficulty = 5;
+    lim->max_depth = depth_for_level[difficulty - 1];
+    lim->time_limit = time_for_level[difficulty - 1];
+    lim->threads = difficulty >= 4 ? 0 : 1; // the strongest levels use every core
+
+    // Never spend more than a twentieth of what is left on the clock
+    if (gm) {
+        int side = gm->state.current_player - 1;
+        if (side >= 0 && side < 2) {
+            double share = gm->time_remaining[side] / 20.0;
+            if (share < lim->time_limit) lim->time_limit = share > 0.01 ? share : 0.01;
+        }
+    }
+}
+
+double minimax_eval(const GameState *g, int depth) {
+    if (!g) return 0.0;
+
+    int score;
+    SearchResult r;
+    SearchLimits lim;
+    memset(&lim, 0, sizeof(lim));
+    lim.max_depth = depth;
+    lim.threads = 1;
+    if (depth > 0 && minimax_search(g, &lim, &r)) score = r.score;
+    else score = minimax_evaluate(g);
+
+    // Report from white's point of view
+    if (g->current_player == 2) score = -score;
+    return (double)score / STONE_VALUE;
 }
@@ -1,3 +1,53 @@
 #pragma once
 #include "../engine/fanorona.h"
-double minimax_eval(const GameState *g, int depth);
\ No newline at end of file
+#include "../engine/game_state.h"
+#include "tt.h"
+#include "tablebase.h"
+#include <stdint.h>
+
+#define SEARCH_MAX_PLY 64
+#define SCORE_INF      32000
+#define SCORE_WIN      30000 // minus the distance to the win, in plies
+#define SCORE_TB_WIN   (SCORE_WIN - SEARCH_MAX_PLY) // table wins: minus ply and table distance
+#define SCORE_PROVEN   (SCORE_TB_WIN - SEARCH_MAX_PLY - TB_MAX_DISTANCE) // lowest proven win
+#define STONE_VALUE    100
+#define SEARCH_MAX_THREADS 64
+
+typedef struct SearchResult SearchResult;
+
+typedef struct {
+    int         max_depth;  // 0 = no limit
+    double      time_limit; // seconds, 0 = no limit
+    TransTable *tt;         // shared hash table, optional
+    int         threads;    // 0 = one per core; helpers need tt
+    bool        keep_generation; // tt is aged by the caller, once for several searches sharing it
+    const int  *cancel;     // search stops soon after *cancel becomes non-zero
+    // Called from the searching thread after every completed iteration
+    void      (*on_iteration)(const SearchResult *partial, void *userdata);
+    void       *userdata;
+} SearchLimits;
+
+struct SearchResult {
+    Turn     best;
+    bool     has_move;
+    int      score;   // for the side to move, in hundredths of a stone
+    int      depth;   // last completed iteration
+    uint64_t nodes;   // all threads
+    double   elapsed;
+    int      threads;
+    uint64_t thread_nodes[SEARCH_MAX_THREADS]; // [0] = main thread
+    double   node_ratio; // all nodes over the main thread's; helpers repeat work, so not a speedup
+    double   depth_time[SEARCH_MAX_PLY]; // seconds until iteration d completed, main thread;
+                                         // against a 1-thread run this gives the speedup
+};
+
+// Depth and time budget for Config.ai_difficulty (1-5), capped by the
+// clock of the side to move when gm is given. Clears lim->tt.
+void minimax_limits(SearchLimits *lim, int difficulty, const GameManager *gm);
+
+// Negamax alpha-beta with iterative deepening and PVS, on lim->threads
+// threads (Lazy SMP) sharing lim->tt
+bool minimax_search(const GameState *g, const SearchLimits *lim, SearchResult *out);
+int  minimax_evaluate(const GameState *g); // static, for the side to move
+
+double minimax_eval(const GameState *g, int depth); // in stones, white positive
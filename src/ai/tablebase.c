@@ -0,0 +1,274 @@
+#define _POSIX_C_SOURCE 200112L
+#include "tablebase.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+typedef struct {
+    void           *map;
+    size_t          size;
+    const TbHeader *header;
+    const uint32_t *offsets;
+    const uint8_t  *data;
+} TbTable;
+
+static TbTable tables[TB_MAX_PIECES][TB_MAX_PIECES]; // [white][black]
+static int max_pieces;
+
+static uint64_t binom[BOARD_POINTS + 1][TB_MAX_PIECES + 1];
+static pthread_once_t binom_once = PTHREAD_ONCE_INIT;
+
+static void binom_init(void) {
+    for (int n = 0; n <= BOARD_POINTS; n++) {
+        binom[n][0] = 1;
+        for (int k = 1; k <= TB_MAX_PIECES; k++) {
+            binom[n][k] = n == 0 ? 0 : binom[n - 1][k - 1] + binom[n - 1][k];
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Indexing
+// ---------------------------------------------------------------------------
+
+uint64_t tb_positions(int white, int black) {
+    pthread_once(&binom_once, binom_init);
+    return binom[BOARD_POINTS][white] * binom[BOARD_POINTS - white][black];
+}
+
+static uint64_t subset_rank(Bitboard set) {
+    uint64_t r = 0;
+    for (int i = 1; set; set &= set - 1, i++) r += binom[bb_lsb(set)][i];
+    return r;
+}
+
+static Bitboard subset_unrank(uint64_t r, int k) {
+    Bitboard set = 0;
+    int p = BOARD_POINTS - 1;
+    for (int i = k; i >= 1; i--, p--) {
+        while (binom[p][i] > r) p--;
+        set |= BIT(p);
+        r -= binom[p][i];
+    }
+    return set;
+}
+
+// Black points renumbered over the points white leaves empty, and back
+static Bitboard squeeze(Bitboard black, Bitboard white) {
+    Bitboard out = 0;
+    for (; black; black &= black - 1) {
+        int p = bb_lsb(black);
+        out |= BIT(p - bb_count(white & (BIT(p) - 1)));
+    }
+    return out;
+}
+
+static Bitboard unsqueeze(Bitboard squeezed, Bitboard white) {
+    Bitboard out = 0;
+    int q = 0;
+    for (int p = 0; p < BOARD_POINTS && squeezed; p++) {
+        if (white & BIT(p)) continue;
+        if (squeezed & BIT(q)) {
+            out |= BIT(p);
+            squeezed ^= BIT(q);
+        }
+        q++;
+    }
+    return out;
+}
+
+uint64_t tb_index(Bitboard white, Bitboard black) {
+    pthread_once(&binom_once, binom_init);
+    int nw = bb_count(white), nb = bb_count(black);
+    return subset_rank(white) * binom[BOARD_POINTS - nw][nb] + subset_rank(squeeze(black, white));
+}
+
+void tb_position(uint64_t index, int white, int black, Bitboard *w, Bitboard *b) {
+    pthread_once(&binom_once, binom_init);
+    uint64_t per_white = binom[BOARD_POINTS - white][black];
+    *w = subset_unrank(index / per_white, white);
+    *b = unsqueeze(subset_unrank(index % per_white, black), *w);
+}
+
+// ---------------------------------------------------------------------------
+// Files
+// ---------------------------------------------------------------------------
+
+// Equal values starting at i, at most 128
+static uint64_t run_length(const uint8_t *values, uint64_t i, uint64_t end) {
+    uint64_t run = 1;
+    while (i + run < end && run < 128 && values[i + run] == values[i]) run++;
+    return run;
+}
+
+bool tb_write(const char *path, int white, int black, const uint8_t *values) {
+    uint64_t positions = 2 * tb_positions(white, black);
+    uint32_t blocks = (uint32_t)((positions + TB_BLOCK - 1) / TB_BLOCK);
+    uint32_t *offsets = malloc(((size_t)blocks + 1) * sizeof(uint32_t));
+    uint8_t *data = malloc((size_t)positions + blocks * (TB_BLOCK / 128 + 1));
+    if (!offsets || !data) {
+        free(offsets);
+        free(data);
+        return false;
+    }
+
+    size_t used = 0;
+    for (uint32_t blk = 0; blk < blocks; blk++) {
+        offsets[blk] = (uint32_t)used;
+        uint64_t i = (uint64_t)blk * TB_BLOCK;
+        uint64_t end = i + TB_BLOCK < positions ? i + TB_BLOCK : positions;
+        while (i < end) {
+            uint64_t run = run_length(values, i, end);
+            if (run >= 3) {
+                data[used++] = (uint8_t)(128 + run - 1);
+                data[used++] = values[i];
+                i += run;
+                continue;
+            }
+            // Literal bytes up to the next run worth encoding
+            uint64_t lit = 0;
+            while (i + lit < end && lit < 128 && run_length(values, i + lit, end) < 3) lit++;
+            data[used++] = (uint8_t)(lit - 1);
+            memcpy(data + used, values + i, (size_t)lit);
+            used += (size_t)lit;
+            i += lit;
+        }
+    }
+    offsets[blocks] = (uint32_t)used;
+
+    TbHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, TB_MAGIC, 4);
+    h.version = TB_VERSION;
+    h.white = (uint8_t)white;
+    h.black = (uint8_t)black;
+    h.block_size = TB_BLOCK;
+    h.block_count = blocks;
+    h.positions = positions;
+
+    FILE *f = fopen(path, "wb");
+    bool ok = f && fwrite(&h, sizeof(h), 1, f) == 1 &&
+              fwrite(offsets, sizeof(uint32_t), (size_t)blocks + 1, f) == (size_t)blocks + 1 &&
+              fwrite(data, 1, used, f) == used;
+    if (f && fclose(f) != 0) ok = false;
+    free(offsets);
+    free(data);
+    return ok;
+}
+
+static bool table_map(TbTable *t, const char *path, int white, int black) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(TbHeader)) {
+        close(fd);
+        return false;
+    }
+    size_t size = (size_t)st.st_size;
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return false;
+
+    const TbHeader *h = map;
+    size_t table_start = sizeof(TbHeader) + ((size_t)h->block_count + 1) * sizeof(uint32_t);
+    bool ok = memcmp(h->magic, TB_MAGIC, 4) == 0 && h->version == TB_VERSION &&
+              h->white == white && h->black == black && h->block_size == TB_BLOCK &&
+              h->positions == 2 * tb_positions(white, black) &&
+              h->block_count == (h->positions + TB_BLOCK - 1) / TB_BLOCK && table_start <= size;
+    const uint32_t *offsets = (const uint32_t *)((const char *)map + sizeof(TbHeader));
+    if (!ok || table_start + offsets[h->block_count] != size) {
+        munmap(map, size);
+        return false;
+    }
+    t->map = map;
+    t->size = size;
+    t->header = h;
+    t->offsets = offsets;
+    t->data = (const uint8_t *)map + table_start;
+    return true;
+}
+
+void tb_free(void) {
+    for (int w = 0; w < TB_MAX_PIECES; w++) {
+        for (int b = 0; b < TB_MAX_PIECES; b++) {
+            if (tables[w][b].map) munmap(tables[w][b].map, tables[w][b].size);
+        }
+    }
+    memset(tables, 0, sizeof(tables));
+    max_pieces = 0;
+}
+
+bool tb_init(const char *dir) {
+    tb_free();
+    if (!dir || !dir[0]) return false;
+
+    bool any = false;
+    char path[512];
+    for (int w = 1; w < TB_MAX_PIECES; w++) {
+        for (int b = 1; w + b <= TB_MAX_PIECES; b++) {
+            snprintf(path, sizeof(path), "%s/w%db%d.fntb", dir, w, b);
+            any |= table_map(&tables[w][b], path, w, b);
+        }
+    }
+    // Probing n stones needs every split of n, and of fewer after captures
+    for (int n = 2; n <= TB_MAX_PIECES; n++) {
+        bool complete = true;
+        for (int w = 1; w < n; w++) complete &= tables[w][n - w].map != NULL;
+        if (!complete) break;
+        max_pieces = n;
+    }
+    return any;
+}
+
+int tb_max_pieces(void) {
+    return max_pieces;
+}
+
+static uint8_t table_value(const TbTable *t, uint64_t index) {
+    uint32_t block = (uint32_t)(index / TB_BLOCK);
+    uint32_t skip = (uint32_t)(index % TB_BLOCK);
+    const uint8_t *p = t->data + t->offsets[block];
+    const uint8_t *end = t->data + t->offsets[block + 1];
+    while (p < end) {
+        uint32_t count = (uint32_t)(p[0] & 127) + 1;
+        if (p[0] & 128) {
+            if (skip < count) return p[1];
+            p += 2;
+        } else {
+            if (skip < count) return p[1 + skip];
+            p += 1 + count;
+        }
+        skip -= count;
+    }
+    return TB_DRAW;
+}
+
+bool tb_probe(const GameState *g, int *result, int *distance) {
+    Bitboard white = g->pieces[0], black = g->pieces[1];
+    int nw = bb_count(white), nb = bb_count(black);
+    if (nw == 0 || nb == 0 || nw + nb > max_pieces) return false;
+
+    const TbTable *t = &tables[nw][nb];
+    uint64_t index = tb_index(white, black);
+    if (g->current_player == 2) index += t->header->positions / 2;
+
+    uint8_t v = table_value(t, index);
+    *distance = TB_DISTANCE(v);
+    *result = v == TB_DRAW ? 0 : (TB_IS_LOSS(v) ? -1 : 1);
+    return true;
+}
+
+bool tb_game_result(const GameState *g, int *winner) {
+    if (game_is_terminal(g, winner)) return true;
+
+    int result, distance;
+    if (!tb_probe(g, &result, &distance)) return false;
+    *winner = result == 0 ? 0 : (result > 0 ? g->current_player : 3 - g->current_player);
+    return true;
+}
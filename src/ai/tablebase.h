@@ -0,0 +1,57 @@
+#pragma once
+#include "../engine/fanorona.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Endgame tables: for every material split with at least one stone a side
+// and at most TB_MAX_PIECES in all, the result of each position under
+// perfect play and its distance in plies. One file per split,
+// "w<white>b<black>.fntb", built by fanorona-tbgen.
+#define TB_MAX_PIECES   6
+#define TB_MAGIC        "FNTB"
+#define TB_VERSION      1
+#define TB_BLOCK        4096 // positions per compressed block
+
+// Stored values: 0 = draw, 1..127 = win in that many plies, 128 + d = loss in d
+#define TB_DRAW          0
+#define TB_WIN(d)        ((uint8_t)(d))
+#define TB_LOSS(d)       ((uint8_t)(128 + (d)))
+#define TB_MAX_DISTANCE  127
+#define TB_IS_LOSS(v)    ((v) >= 128)
+#define TB_DISTANCE(v)   ((v) & 127)
+
+// File: TbHeader, uint32 offsets[block_count + 1] into the packed data,
+// then the data, which never crosses a block: a control byte c < 128 is
+// followed by c + 1 literal values, c >= 128 by one value repeated c - 127
+// times.
+// Positions with white to move come first, then those with black to move.
+typedef struct {
+    char     magic[4];
+    uint32_t version;
+    uint8_t  white, black;
+    uint16_t reserved;
+    uint32_t block_size;
+    uint32_t block_count;
+    uint32_t reserved2;
+    uint64_t positions;  // both sides to move
+} TbHeader;
+
+// Indexing: white stones by the combinatorial number system, then black
+// stones over the points white leaves empty
+uint64_t tb_positions(int white, int black); // for one side to move
+uint64_t tb_index(Bitboard white, Bitboard black);
+void     tb_position(uint64_t index, int white, int black, Bitboard *w, Bitboard *b);
+bool     tb_write(const char *path, int white, int black, const uint8_t *values);
+
+// Maps every table found in dir. The tables are global and read-only once
+// loaded; tb_init() and tb_free() must not overlap with probes.
+bool tb_init(const char *dir);
+void tb_free(void);
+int  tb_max_pieces(void); // every split up to this many stones is loaded
+
+// Result for the side to move: 1 win, 0 draw, -1 loss; distance in plies
+bool tb_probe(const GameState *g, int *result, int *distance);
+
+// Adjudication in the style of game_is_terminal(): true when the game is
+// over or the tables know how it ends; winner 1 = white, 2 = black, 0 = draw
+bool tb_game_result(const GameState *g, int *winner);
@@ -0,0 +1,154 @@
+#define _POSIX_C_SOURCE 200112L
+#include "tt.h"
+#include "minimax.h"
+#include <stdlib.h>
+#include <string.h>
+
+// data layout: move (32) | score + 32768 (16) | depth + 128 (8) | bound (2) | generation (6)
+#define PACK(move, score, depth, bound, gen)                                  \
+    (((uint64_t)(move) << 32) | ((uint64_t)(uint16_t)((score) + 32768) << 16) | \
+     ((uint64_t)(uint8_t)((depth) + 128) << 8) | ((uint64_t)(bound) << 6) | (uint64_t)((gen) & 63))
+#define DATA_MOVE(d)  ((uint32_t)((d) >> 32))
+#define DATA_SCORE(d) ((int)(((d) >> 16) & 0xFFFF) - 32768)
+#define DATA_DEPTH(d) ((int)(((d) >> 8) & 0xFF) - 128)
+#define DATA_BOUND(d) ((TTBound)(((d) >> 6) & 3))
+#define DATA_GEN(d)   ((uint8_t)((d) & 63))
+
+#define OCCUPANCY_SAMPLE 4096
+
+TransTable *tt_create(size_t size_mb) {
+    if (size_mb == 0) size_mb = 1;
+
+    size_t buckets = 1;
+    size_t want = size_mb * 1024 * 1024 / (sizeof(TTEntry) * TT_BUCKET);
+    while (buckets * 2 <= want) buckets *= 2;
+
+    TransTable *tt = malloc(sizeof(TransTable));
+    if (!tt) return NULL;
+    memset(tt, 0, sizeof(TransTable));
+
+    void *mem = NULL;
+    if (posix_memalign(&mem, 64, buckets * TT_BUCKET * sizeof(TTEntry)) != 0) {
+        free(tt);
+        return NULL;
+    }
+    tt->entries = mem;
+    tt->bucket_mask = buckets - 1;
+    tt->entry_count = buckets * TT_BUCKET;
+    tt_clear(tt);
+    return tt;
+}
+
+void tt_destroy(TransTable *tt) {
+    if (!tt) return;
+    free(tt->entries);
+    free(tt);
+}
+
+void tt_clear(TransTable *tt) {
+    if (!tt) return;
+    memset(tt->entries, 0, tt->entry_count * sizeof(TTEntry));
+    tt->generation = 0;
+    tt->probes = tt->hits = 0;
+}
+
+void tt_new_search(TransTable *tt) {
+    if (tt) tt->generation = (uint8_t)((tt->generation + 1) & 63);
+}
+
+static TTEntry *bucket_for(const TransTable *tt, uint64_t hash) {
+    return &tt->entries[(hash & tt->bucket_mask) * TT_BUCKET];
+}
+
+// Proven wins, found by the search or read from the endgame tables, are
+// stored relative to the node, not the root
+static int score_to_tt(int score, int ply) {
+    if (score >= SCORE_PROVEN) return score + ply;
+    if (score <= -SCORE_PROVEN) return score - ply;
+    return score;
+}
+
+static int score_from_tt(int score, int ply) {
+    if (score >= SCORE_PROVEN) return score - ply;
+    if (score <= -SCORE_PROVEN) return score + ply;
+    return score;
+}
+
+bool tt_probe(const TransTable *tt, uint64_t hash, int ply, TTHit *hit) {
+    TTEntry *b = bucket_for(tt, hash);
+    for (int i = 0; i < TT_BUCKET; i++) {
+        uint64_t data = __atomic_load_n(&b[i].data, __ATOMIC_RELAXED);
+        uint64_t key = __atomic_load_n(&b[i].key, __ATOMIC_RELAXED);
+        if ((key ^ data) != hash || DATA_BOUND(data) == TT_NONE) continue;
+
+        hit->bound = DATA_BOUND(data);
+        hit->depth = DATA_DEPTH(data);
+        hit->score = score_from_tt(DATA_SCORE(data), ply);
+        hit->move = DATA_MOVE(data);
+        return true;
+    }
+    return false;
+}
+
+void tt_store(TransTable *tt, uint64_t hash, int ply, int depth, int score,
+              TTBound bound, uint32_t move) {
+    TTEntry *b = bucket_for(tt, hash);
+    TTEntry *victim = NULL;
+    int victim_value = 1 << 30;
+
+    for (int i = 0; i < TT_BUCKET; i++) {
+        uint64_t data = __atomic_load_n(&b[i].data, __ATOMIC_RELAXED);
+        uint64_t key = __atomic_load_n(&b[i].key, __ATOMIC_RELAXED);
+        if ((key ^ data) == hash) {
+            // Same position: keep a deeper result, but remember a move
+            if (DATA_DEPTH(data) > depth && bound != TT_EXACT) return;
+            if (!move) move = DATA_MOVE(data);
+            victim = &b[i];
+            break;
+        }
+
+        // Otherwise replace the shallowest entry, preferring stale ones
+        int age = (tt->generation - DATA_GEN(data)) & 63;
+        int value = DATA_BOUND(data) == TT_NONE ? -1000 : DATA_DEPTH(data) - 8 * age;
+        if (value < victim_value) {
+            victim_value = value;
+            victim = &b[i];
+        }
+    }
+
+    if (depth < -127) depth = -127;
+    if (depth > 127) depth = 127;
+    uint64_t data = PACK(move, score_to_tt(score, ply), depth, bound, tt->generation);
+    __atomic_store_n(&victim->data, data, __ATOMIC_RELAXED);
+    __atomic_store_n(&victim->key, hash ^ data, __ATOMIC_RELAXED);
+}
+
+uint32_t tt_move_key(const Turn *t) {
+    // Origin, destination and captures decide the resulting position
+    uint64_t c = t->captured;
+    uint32_t fold = (uint32_t)(c ^ (c >> 20) ^ (c >> 40)) & 0xFFFFF;
+    return 1u | ((uint32_t)t->path[0] << 1) | ((uint32_t)t->path[t->length] << 7) | (fold << 13);
+}
+
+void tt_add_stats(TransTable *tt, uint64_t probes, uint64_t hits) {
+    __atomic_fetch_add(&tt->probes, probes, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&tt->hits, hits, __ATOMIC_RELAXED);
+}
+
+void tt_get_stats(const TransTable *tt, TTStats *stats) {
+    memset(stats, 0, sizeof(TTStats));
+    if (!tt) return;
+
+    stats->entries = tt->entry_count;
+    uint64_t probes = __atomic_load_n(&tt->probes, __ATOMIC_RELAXED);
+    uint64_t hits = __atomic_load_n(&tt->hits, __ATOMIC_RELAXED);
+    stats->hit_rate = probes ? (double)hits / probes : 0.0;
+
+    size_t sample = tt->entry_count < OCCUPANCY_SAMPLE ? tt->entry_count : OCCUPANCY_SAMPLE;
+    size_t used = 0;
+    for (size_t i = 0; i < sample; i++) {
+        uint64_t data = __atomic_load_n(&tt->entries[i].data, __ATOMIC_RELAXED);
+        if (DATA_BOUND(data) != TT_NONE && DATA_GEN(data) == tt->generation) used++;
+    }
+    stats->occupancy = sample ? (double)used / sample : 0.0;
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include "../engine/fanorona.h"
+#include <stdint.h>
+#include <stddef.h>
+
+// Shared transposition table. Each entry stores key ^ data next to data,
+// so a reader racing a writer sees a mismatch instead of a torn entry.
+// Threads share it without locks.
+
+typedef enum { TT_NONE, TT_EXACT, TT_LOWER, TT_UPPER } TTBound;
+
+typedef struct {
+    uint64_t key;  // position hash ^ data
+    uint64_t data; // see tt.c for the layout
+} TTEntry;
+
+#define TT_BUCKET 4 // entries per 64-byte cache line
+
+typedef struct {
+    TTEntry *entries;
+    uint64_t bucket_mask;   // bucket count - 1 (a power of two)
+    size_t   entry_count;
+    uint8_t  generation;    // bumped by tt_new_search(), ages old entries
+    uint64_t probes, hits;  // accumulated by tt_add_stats()
+} TransTable;
+
+typedef struct {
+    TTBound  bound;
+    int      depth;
+    int      score;
+    uint32_t move; // tt_move_key() of the best turn, 0 if none
+} TTHit;
+
+typedef struct {
+    size_t entries;
+    double hit_rate;  // hits / probes since the last clear
+    double occupancy; // share of entries written by the current search
+} TTStats;
+
+TransTable *tt_create(size_t size_mb);  // rounded down to a power of two
+void        tt_destroy(TransTable *tt);
+void        tt_clear(TransTable *tt);
+void        tt_new_search(TransTable *tt);
+
+bool tt_probe(const TransTable *tt, uint64_t hash, int ply, TTHit *hit);
+void tt_store(TransTable *tt, uint64_t hash, int ply, int depth, int score,
+              TTBound bound, uint32_t move);
+
+uint32_t tt_move_key(const Turn *t); // identifies a turn among its siblings
+void     tt_add_stats(TransTable *tt, uint64_t probes, uint64_t hits);
+void     tt_get_stats(const TransTable *tt, TTStats *stats);
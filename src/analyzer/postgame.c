@@ -1,18 +1,92 @@
+#define _POSIX_C_SOURCE 200112L
 #include "postgame.h"
-#include <stdio.h>
+#include "../ai/minimax.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef struct {
+    GameState      *history;   // copied, the caller's array may go away
+    int             len;
+    int             next;      // next position to take, atomically
+    void          (*callback)(AltMove *alts, int count);
+    pthread_mutex_t callback_lock;
+    TransTable     *tt;        // shared by the workers
+    pthread_t       threads[ANALYZER_MAX_THREADS];
+    int             thread_count;
+    bool            running;
+} Analyzer;
+
+static Analyzer analyzer;
+
+static void *worker_main(void *arg) {
+    Analyzer *a = arg;
+    SearchLimits lim;
+    memset(&lim, 0, sizeof(lim));
+    lim.max_depth = ANALYZER_DEPTH;
+    lim.time_limit = ANALYZER_TIME;
+    lim.threads = 1;
+    lim.tt = a->tt;
+    lim.keep_generation = true; // aged once in analyzer_start(), not racing per search
+
+    for (;;) {
+        int ply = __atomic_fetch_add(&a->next, 1, __ATOMIC_RELAXED);
+        if (ply >= a->len) break;
+
+        SearchResult r;
+        if (!minimax_search(&a->history[ply], &lim, &r) || !r.has_move) continue;
+
+        AltMove alt;
+        alt.from = pos_from_index(r.best.path[0]);
+        alt.to = pos_from_index(r.best.path[r.best.length]);
+        alt.score = (float)r.score / STONE_VALUE;
+        alt.ply = ply;
+        if (a->callback) {
+            pthread_mutex_lock(&a->callback_lock);
+            a->callback(&alt, 1);
+            pthread_mutex_unlock(&a->callback_lock);
+        }
+    }
+    return NULL;
+}
 
 void analyzer_start(const GameState *history, int len,
                     void (*callback)(AltMove *alts, int count)) {
-    (void)history; (void)len;
-    
-    if (callback) {
-        // Placeholder: no alternative moves for now
-        callback(NULL, 0);
+    analyzer_wait();
+    if (!history || len <= 0) return;
+
+    Analyzer *a = &analyzer;
+    memset(a, 0, sizeof(Analyzer));
+    a->history = malloc((size_t)len * sizeof(GameState));
+    if (!a->history) return;
+    memcpy(a->history, history, (size_t)len * sizeof(GameState));
+    a->len = len;
+    a->callback = callback;
+    a->tt = tt_create(64);
+    tt_new_search(a->tt); // one generation for the whole analysis
+    pthread_mutex_init(&a->callback_lock, NULL);
+    a->running = true;
+
+    int threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads > len) threads = len;
+    if (threads > ANALYZER_MAX_THREADS) threads = ANALYZER_MAX_THREADS;
+    if (threads < 1) threads = 1;
+    for (int i = 0; i < threads; i++) {
+        if (pthread_create(&a->threads[i], NULL, worker_main, a) != 0) break;
+        a->thread_count++;
     }
-    
-    printf("Postgame analysis not implemented yet\n");
+    // Without any thread the analysis runs here
+    if (a->thread_count == 0) worker_main(a);
 }
 
 void analyzer_wait(void) {
-    // Wait for analysis to complete
+    Analyzer *a = &analyzer;
+    if (!a->running) return;
+
+    for (int i = 0; i < a->thread_count; i++) pthread_join(a->threads[i], NULL);
+    pthread_mutex_destroy(&a->callback_lock);
+    tt_destroy(a->tt);
+    free(a->history);
+    memset(a, 0, sizeof(Analyzer));
 }
@@ -1,6 +1,20 @@
 #pragma once
 #include "../engine/fanorona.h"
-typedef struct { Pos from, to; float score; } AltMove;
+
+// Each position is searched to this depth, or for this long, whichever
+// comes first; positions are shared out across one thread per core
+#define ANALYZER_DEPTH       8
+#define ANALYZER_TIME        0.5  // seconds per position
+#define ANALYZER_MAX_THREADS 64
+
+// Best turn found at position `ply` of the history, from `from` to the
+// stone's final point; score in stones for the side to move there
+typedef struct { Pos from, to; float score; int ply; } AltMove;
+
+// Analyses history[0..len-1] in the background. The callback runs on a
+// worker thread once per position as soon as its search ends, in whatever
+// order they finish, never two at a time. Starting a new analysis waits
+// for the previous one.
 void analyzer_start(const GameState *history, int len,
                     void (*callback)(AltMove *alts, int count));
-void analyzer_wait(void);
\ No newline at end of file
+void analyzer_wait(void); // joins the workers
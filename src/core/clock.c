@@ -0,0 +1,9 @@
+#define _POSIX_C_SOURCE 199309L
+#include "clock.h"
+#include <time.h>
+
+double clock_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
@@ -0,0 +1,5 @@
+#pragma once
+
+// Monotonic wall clock in seconds. Unlike timer_now() it does not need
+// SDL, so the AI and the headless tools can use it.
+double clock_now(void);
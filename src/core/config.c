@@ -19,6 +19,13 @@ void config_set_defaults(Config *cfg) {
     
     // Gameplay settings
     cfg->ai_difficulty = 3;
+    cfg->ai_hash_mb = 64;
+    cfg->ai_threads = 0;
+    cfg->ai_engine = AI_ENGINE_MINIMAX;
+    cfg->ai_weights[0] = '\0';
+    strcpy(cfg->ai_book, "fanorona.book");
+    strcpy(cfg->ai_tablebases, "tb");
+    strcpy(cfg->record_file, "games.fngr");
     cfg->show_hints = true;
     cfg->animate_moves = true;
     cfg->animation_speed = 1.0;
@@ -46,6 +53,22 @@ bool config_load(Config *cfg, const char *filename) {
             cfg->window_width = atoi(line + 6);
         } else if (strncmp(line, "height=", 7) == 0) {
             cfg->window_height = atoi(line + 7);
+        } else if (strncmp(line, "difficulty=", 11) == 0) {
+            cfg->ai_difficulty = atoi(line + 11);
+        } else if (strncmp(line, "hash=", 5) == 0) {
+            cfg->ai_hash_mb = atoi(line + 5);
+        } else if (strncmp(line, "threads=", 8) == 0) {
+            cfg->ai_threads = atoi(line + 8);
+        } else if (strncmp(line, "engine=", 7) == 0) {
+            cfg->ai_engine = strcmp(line + 7, "mcts") == 0 ? AI_ENGINE_MCTS : AI_ENGINE_MINIMAX;
+        } else if (strncmp(line, "weights=", 8) == 0) {
+            snprintf(cfg->ai_weights, sizeof(cfg->ai_weights), "%s", line + 8);
+        } else if (strncmp(line, "book=", 5) == 0) {
+            snprintf(cfg->ai_book, sizeof(cfg->ai_book), "%s", line + 5);
+        } else if (strncmp(line, "tablebases=", 11) == 0) {
+            snprintf(cfg->ai_tablebases, sizeof(cfg->ai_tablebases), "%s", line + 11);
+        } else if (strncmp(line, "record=", 7) == 0) {
+            snprintf(cfg->record_file, sizeof(cfg->record_file), "%s", line + 7);
         }
         // TODO: Add more config parsing
     }
@@ -64,6 +87,14 @@ bool config_save(const Config *cfg, const char *filename) {
     fprintf(f, "height=%d\n", cfg->window_height);
     fprintf(f, "fullscreen=%d\n", cfg->fullscreen ? 1 : 0);
     fprintf(f, "volume=%.2f\n", cfg->master_volume);
+    fprintf(f, "difficulty=%d\n", cfg->ai_difficulty);
+    fprintf(f, "hash=%d\n", cfg->ai_hash_mb);
+    fprintf(f, "threads=%d\n", cfg->ai_threads);
+    fprintf(f, "engine=%s\n", cfg->ai_engine == AI_ENGINE_MCTS ? "mcts" : "minimax");
+    fprintf(f, "weights=%s\n", cfg->ai_weights);
+    fprintf(f, "book=%s\n", cfg->ai_book);
+    fprintf(f, "tablebases=%s\n", cfg->ai_tablebases);
+    fprintf(f, "record=%s\n", cfg->record_file);
     // TODO: Add more config saving
     
     fclose(f);
@@ -1,6 +1,8 @@
 #pragma once
 #include <stdbool.h>
 
+typedef enum { AI_ENGINE_MINIMAX, AI_ENGINE_MCTS } AIEngine;
+
 typedef struct {
     // Display settings
     int window_width;
@@ -14,7 +16,14 @@ typedef struct {
     bool audio_enabled;
     
     // Gameplay settings
-    int ai_difficulty; // 1-5
+    int ai_difficulty; // 1-5, see minimax_limits()
+    int ai_hash_mb;    // Transposition table or MCTS arena size
+    int ai_threads;    // Search threads, 0 = one per core
+    AIEngine ai_engine;
+    char ai_weights[256]; // Network for MCTS leaves, empty = random playouts
+    char ai_book[256];    // Opening book, empty = none
+    char ai_tablebases[256]; // Endgame table directory, empty = none
+    char record_file[256];   // Games played are appended here, empty = none
     bool show_hints;
     bool animate_moves;
     double animation_speed;
@@ -0,0 +1,128 @@
+#include "chain.h"
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    Turn     *out;
+    int       count, max;
+    GameState state; // board as the chain progresses
+    Turn      cur;   // turn being built
+} ChainCtx;
+
+int chain_continuations(const GameState *g, int at, int last_dir, Bitboard visited, Step *out) {
+    int side = g->current_player - 1;
+    Bitboard opp = g->pieces[side ^ 1];
+    Bitboard empty = BOARD_ALL & ~(g->pieces[0] | g->pieces[1]) & ~visited;
+    int n = 0;
+
+    for (int d = 0; d < DIR_COUNT; d++) {
+        if (d == last_dir || !(DIR_MASK[d] & BIT(at))) continue;
+        int to = at + DIR_DELTA[d];
+        if (!(empty & BIT(to))) continue;
+
+        if ((DIR_MASK[d] & BIT(to)) && (opp & BIT(to + DIR_DELTA[d]))) {
+            out[n++] = (Step){ (uint8_t)at, (uint8_t)to, (uint8_t)d, CAPTURE_APPROACH };
+        }
+        if ((DIR_MASK[d ^ 1] & BIT(at)) && (opp & BIT(at - DIR_DELTA[d]))) {
+            out[n++] = (Step){ (uint8_t)at, (uint8_t)to, (uint8_t)d, CAPTURE_WITHDRAWAL };
+        }
+    }
+    return n;
+}
+
+static void emit_turn(ChainCtx *c) {
+    if (c->count < c->max) c->out[c->count] = c->cur;
+    c->count++;
+}
+
+// Plays one capturing step, records the turn ending there, then tries to
+// extend it. Turns past max are counted, not written.
+static void extend(ChainCtx *c, const Step *s, Bitboard visited) {
+    GameState saved = c->state;
+    Turn saved_turn = c->cur;
+    int i = c->cur.length;
+
+    Bitboard captured = game_apply_step(&c->state, s);
+    c->cur.captured |= captured;
+    if (s->capture == CAPTURE_WITHDRAWAL) c->cur.withdrawals |= 1u << i;
+    c->cur.path[i + 1] = s->to;
+    c->cur.length = (uint8_t)(i + 1);
+    emit_turn(c);
+
+    visited |= BIT(s->to);
+    Step next[MAX_CHAIN_STEPS];
+    int n = chain_continuations(&c->state, s->to, s->dir, visited, next);
+    for (int k = 0; k < n; k++) {
+        extend(c, &next[k], visited);
+    }
+
+    c->state = saved;
+    c->cur = saved_turn;
+}
+
+int chain_generate(const GameState *g, Turn *out, int max) {
+    Step steps[MAX_STEPS];
+    int n = game_gen_steps(g, steps);
+
+    ChainCtx c;
+    c.out = out;
+    c.count = 0;
+    c.max = max;
+    c.state = *g;
+
+    for (int i = 0; i < n; i++) {
+        memset(&c.cur, 0, sizeof(Turn));
+        c.cur.path[0] = steps[i].from;
+        if (steps[i].capture == CAPTURE_NONE) {
+            c.cur.path[1] = steps[i].to;
+            c.cur.length = 1;
+            emit_turn(&c);
+        } else {
+            extend(&c, &steps[i], BIT(steps[i].from));
+        }
+    }
+    return c.count;
+}
+
+Turn *chain_generate_all(const GameState *g, Turn *buf, int max, int *count) {
+    int n = chain_generate(g, buf, max);
+    *count = n;
+    if (n <= max) return buf;
+    Turn *all = malloc((size_t)n * sizeof(Turn));
+    if (all) chain_generate(g, all, n);
+    return all;
+}
+
+// The step of t from path[i] among `steps`, of the kind t says
+static const Step *find_step(const Step *steps, int n, const Turn *t, int i) {
+    CaptureType kind = t->captured == 0 ? CAPTURE_NONE
+                     : (t->withdrawals >> i) & 1 ? CAPTURE_WITHDRAWAL : CAPTURE_APPROACH;
+    for (int k = 0; k < n; k++) {
+        if (steps[k].from == t->path[i] && steps[k].to == t->path[i + 1] && steps[k].capture == kind) {
+            return &steps[k];
+        }
+    }
+    return NULL;
+}
+
+bool chain_turn_legal(const GameState *g, const Turn *t) {
+    if (t->length < 1 || t->length > MAX_CHAIN || (t->withdrawals >> t->length) != 0) return false;
+
+    Step steps[MAX_STEPS];
+    const Step *s = find_step(steps, game_gen_steps(g, steps), t, 0);
+    if (!s) return false;
+    if (s->capture == CAPTURE_NONE) return t->length == 1 && t->withdrawals == 0;
+
+    // Each step is used up before next[] is refilled
+    GameState state = *g;
+    Bitboard visited = BIT(s->from), captured = 0;
+    Step next[MAX_CHAIN_STEPS];
+    for (int i = 1;; i++) {
+        captured |= game_apply_step(&state, s);
+        visited |= BIT(s->to);
+        if (i == t->length) break;
+        int n = chain_continuations(&state, t->path[i], s->dir, visited, next);
+        if (!(s = find_step(next, n, t, i))) return false;
+    }
+    return captured == t->captured;
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include "fanorona.h"
+
+// Room for the turns of ordinary positions (random games reach about 230).
+// There is no useful bound on chains, so chain_generate() reports the full
+// count and callers that must see every turn use chain_generate_all().
+#define MAX_TURNS 512
+
+// At most one approach and one withdrawal per direction
+#define MAX_CHAIN_STEPS 16
+
+// Capturing steps that may continue a chain with the stone on `at`,
+// which arrived by `last_dir` (-1 for none) after visiting `visited`.
+int chain_continuations(const GameState *g, int at, int last_dir, Bitboard visited, Step *out);
+
+// Every legal turn of the side to move, including each point where a
+// chain may stop. Uses no heap memory. Like snprintf(), returns how many
+// turns there are; only the first max are written, so callers that index
+// out[] clamp the result to max.
+int chain_generate(const GameState *g, Turn *out, int max);
+
+// The same, but never cut: returns buf when the turns fit in max, else a
+// malloc()ed array the caller frees (NULL when out of memory).
+Turn *chain_generate_all(const GameState *g, Turn *buf, int max, int *count);
+
+// Whether t is one of the turns chain_generate() lists, checked by playing
+// its steps rather than by listing them
+bool chain_turn_legal(const GameState *g, const Turn *t);
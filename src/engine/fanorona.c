@@ -1,35 +1,255 @@
 #include "fanorona.h"
+#include "zobrist.h"
 #include <stdbool.h>
+#include <string.h>
+
+const int DIR_DELTA[DIR_COUNT] = { 1, -1, BOARD_W, -BOARD_W,
+                                   BOARD_W + 1, -(BOARD_W + 1),
+                                   BOARD_W - 1, -(BOARD_W - 1) };
+
+// Diagonal masks only contain strong points (x + y even)
+const Bitboard DIR_MASK[DIR_COUNT] = {
+    0x0FF7FBFDFEFFULL, // E
+    0x1FEFF7FBFDFEULL, // W
+    0x000FFFFFFFFFULL, // S
+    0x1FFFFFFFFE00ULL, // N
+    0x000551555455ULL, // SE
+    0x154555515400ULL, // NW
+    0x000555515554ULL, // SW
+    0x055551555400ULL, // NE
+};
+
+const Bitboard ADJACENT[BOARD_POINTS] = {
+    0x000000000602ULL, 0x000000000405ULL, 0x000000001C0AULL,
+    0x000000001014ULL, 0x000000007028ULL, 0x000000004050ULL,
+    0x00000001C0A0ULL, 0x000000010140ULL, 0x000000030080ULL,
+    0x000000040401ULL, 0x0000001C0A07ULL, 0x000000101404ULL,
+    0x00000070281CULL, 0x000000405010ULL, 0x000001C0A070ULL,
+    0x000001014040ULL, 0x0000070281C0ULL, 0x000004010100ULL,
+    0x000018080600ULL, 0x000010140400ULL, 0x000070281C00ULL,
+    0x000040501000ULL, 0x0001C0A07000ULL, 0x000101404000ULL,
+    0x00070281C000ULL, 0x000405010000ULL, 0x000C02030000ULL,
+    0x001010040000ULL, 0x0070281C0000ULL, 0x004050100000ULL,
+    0x01C0A0700000ULL, 0x010140400000ULL, 0x070281C00000ULL,
+    0x040501000000ULL, 0x1C0A07000000ULL, 0x100404000000ULL,
+    0x002018000000ULL, 0x005010000000ULL, 0x00A070000000ULL,
+    0x014040000000ULL, 0x0281C0000000ULL, 0x050100000000ULL,
+    0x0A0700000000ULL, 0x140400000000ULL, 0x080C00000000ULL,
+};
+
+// Black holds rows 0-1, white rows 3-4; the middle row alternates
+// B W B W . B W B W with the centre point empty.
+#define OPENING_WHITE 0x1FFFFD280000ULL
+#define OPENING_BLACK 0x00000297FFFFULL
+
+void game_state_init(GameState *g) {
+    memset(g, 0, sizeof(GameState));
+    g->pieces[0] = OPENING_WHITE;
+    g->pieces[1] = OPENING_BLACK;
+    g->current_player = 1;
+    g->hash = zobrist_compute(g);
+}
+
+Cell game_cell(const GameState *g, int x, int y) {
+    Bitboard b = BIT(POS_INDEX(x, y));
+    if (g->pieces[0] & b) return WHITE;
+    if (g->pieces[1] & b) return BLACK;
+    return EMPTY;
+}
+
+void game_set_cell(GameState *g, int x, int y, Cell c) {
+    int i = POS_INDEX(x, y);
+    for (int side = 0; side < 2; side++) {
+        if (g->pieces[side] & BIT(i)) {
+            g->pieces[side] ^= BIT(i);
+            g->hash ^= ZOBRIST_PIECE[side][i];
+        }
+    }
+    if (c != EMPTY) {
+        int side = (c == WHITE) ? 0 : 1;
+        g->pieces[side] |= BIT(i);
+        g->hash ^= ZOBRIST_PIECE[side][i];
+    }
+    ZOBRIST_CHECK(g);
+}
+
+void game_switch_player(GameState *g) {
+    g->current_player = (g->current_player == 1) ? 2 : 1;
+    g->hash ^= ZOBRIST_SIDE;
+}
+
+static uint64_t captures_hash(int side, Bitboard captured) {
+    uint64_t h = 0;
+    for (; captured; captured &= captured - 1) {
+        h ^= ZOBRIST_PIECE[side][bb_lsb(captured)];
+    }
+    return h;
+}
+
+static Step *emit_steps(Step *out, Bitboard movers, int dir, CaptureType capture) {
+    while (movers) {
+        int from = bb_lsb(movers);
+        movers &= movers - 1;
+        out->from = (uint8_t)from;
+        out->to = (uint8_t)(from + DIR_DELTA[dir]);
+        out->dir = (uint8_t)dir;
+        out->capture = (uint8_t)capture;
+        out++;
+    }
+    return out;
+}
+
+int game_gen_steps(const GameState *g, Step *out) {
+    int side = g->current_player - 1;
+    Bitboard own = g->pieces[side], opp = g->pieces[side ^ 1];
+    Bitboard empty = BOARD_ALL & ~(own | opp);
+    Step *p = out;
+
+    for (int d = 0; d < DIR_COUNT; d++) {
+        // Own stones whose neighbour in direction d is empty
+        Bitboard movers = own & bb_shift(empty, d ^ 1);
+        // ...and an enemy stone one point further (approach) or just behind (withdrawal)
+        Bitboard approach = movers & bb_shift(bb_shift(opp, d ^ 1), d ^ 1);
+        Bitboard withdraw = movers & bb_shift(opp, d);
+        p = emit_steps(p, approach, d, CAPTURE_APPROACH);
+        p = emit_steps(p, withdraw, d, CAPTURE_WITHDRAWAL);
+    }
+    if (p != out) return (int)(p - out);
+
+    // Paika: plain moves are only legal when nothing can be captured
+    for (int d = 0; d < DIR_COUNT; d++) {
+        p = emit_steps(p, own & bb_shift(empty, d ^ 1), d, CAPTURE_NONE);
+    }
+    return (int)(p - out);
+}
+
+Bitboard game_step_captures(const GameState *g, const Step *s) {
+    Bitboard opp = g->pieces[g->current_player == 1 ? 1 : 0];
+    switch (s->capture) {
+        case CAPTURE_APPROACH:
+            if (!(DIR_MASK[s->dir] & BIT(s->to))) return 0;
+            return bb_capture_line(opp, s->to + DIR_DELTA[s->dir], s->dir);
+        case CAPTURE_WITHDRAWAL:
+            if (!(DIR_MASK[s->dir ^ 1] & BIT(s->from))) return 0;
+            return bb_capture_line(opp, s->from - DIR_DELTA[s->dir], s->dir ^ 1);
+        default:
+            return 0;
+    }
+}
+
+Bitboard game_apply_step(GameState *g, const Step *s) {
+    int side = g->current_player - 1;
+    Bitboard captured = game_step_captures(g, s);
+    g->pieces[side] ^= BIT(s->from) | BIT(s->to);
+    g->pieces[side ^ 1] &= ~captured;
+    g->hash ^= ZOBRIST_PIECE[side][s->from] ^ ZOBRIST_PIECE[side][s->to];
+    g->hash ^= captures_hash(side ^ 1, captured);
+    ZOBRIST_CHECK(g);
+    return captured;
+}
+
+void game_apply_turn(GameState *g, const Turn *t) {
+    int side = g->current_player - 1;
+    int from = t->path[0], to = t->path[t->length];
+    g->pieces[side] ^= BIT(from) | BIT(to);
+    g->pieces[side ^ 1] &= ~t->captured;
+    g->hash ^= ZOBRIST_PIECE[side][from] ^ ZOBRIST_PIECE[side][to];
+    g->hash ^= captures_hash(side ^ 1, t->captured);
+    game_switch_player(g);
+    ZOBRIST_CHECK(g);
+}
+
+void game_make(GameState *g, const Turn *t, Undo *u) {
+    u->from = t->path[0];
+    u->to = t->path[t->length];
+    u->captured = t->captured;
+    u->prev_hash = g->hash;
+    u->prev_player = (int8_t)g->current_player;
+    game_apply_turn(g, t);
+}
+
+void game_unmake(GameState *g, const Undo *u) {
+    int side = u->prev_player - 1;
+    g->pieces[side] ^= BIT(u->from) | BIT(u->to);
+    g->pieces[side ^ 1] |= u->captured;
+    g->current_player = u->prev_player;
+    g->hash = u->prev_hash;
+    ZOBRIST_CHECK(g);
+}
+
+void game_turn_step(const Turn *t, int i, Step *s) {
+    s->from = t->path[i];
+    s->to = t->path[i + 1];
+    s->dir = 0;
+    for (int d = 0; d < DIR_COUNT; d++) {
+        if (s->from + DIR_DELTA[d] == s->to && (DIR_MASK[d] & BIT(s->from))) {
+            s->dir = (uint8_t)d;
+            break;
+        }
+    }
+    if (!t->captured) s->capture = CAPTURE_NONE;
+    else s->capture = (t->withdrawals >> i) & 1 ? CAPTURE_WITHDRAWAL : CAPTURE_APPROACH;
+}
+
+bool game_turn_equal(const Turn *a, const Turn *b) {
+    if (a->length != b->length || a->captured != b->captured) return false;
+    if (a->withdrawals != b->withdrawals) return false;
+    return memcmp(a->path, b->path, a->length + 1) == 0;
+}
+
+static bool pos_on_board(Pos p) {
+    return p.x >= 0 && p.x < BOARD_W && p.y >= 0 && p.y < BOARD_H;
+}
+
+// The legal step from -> to taking `capture`. CAPTURE_NONE stands for no
+// choice made: it accepts the only step there is, but not a step that may
+// capture either by approach or by withdrawal.
+static bool find_step(const GameState *g, Pos from, Pos to, CaptureType capture, Step *found) {
+    if (!pos_on_board(from) || !pos_on_board(to)) return false;
+
+    int f = POS_INDEX(from.x, from.y), t = POS_INDEX(to.x, to.y);
+    if (!(ADJACENT[f] & BIT(t))) return false;
+
+    Step steps[MAX_STEPS];
+    int n = game_gen_steps(g, steps), matches = 0;
+    for (int i = 0; i < n; i++) {
+        if (steps[i].from != f || steps[i].to != t) continue;
+        if (capture != CAPTURE_NONE && steps[i].capture != capture) continue;
+        *found = steps[i];
+        matches++;
+    }
+    return matches == 1;
+}
 
 bool game_move_valid(const GameState *g, Pos from, Pos to) {
-    // Basic bounds checking
-    if (from.x < 0 || from.x >= 9 || from.y < 0 || from.y >= 5) return false;
-    if (to.x < 0 || to.x >= 9 || to.y < 0 || to.y >= 5) return false;
-    
-    // Check if starting position has current player's piece
-    if (g->board[from.x][from.y] != (g->current_player == 1 ? WHITE : BLACK)) return false;
-    
-    // Check if destination is empty
-    if (g->board[to.x][to.y] != EMPTY) return false;
-    
-    // TODO: Add proper move validation logic
-    return true;
+    Step s;
+    return find_step(g, from, to, CAPTURE_NONE, &s) || find_step(g, from, to, CAPTURE_APPROACH, &s);
 }
 
-void game_apply_move(GameState *g, Pos from, Pos to) {
-    if (!game_move_valid(g, from, to)) return;
-    
-    // Move the piece
-    g->board[to.x][to.y] = g->board[from.x][from.y];
-    g->board[from.x][from.y] = EMPTY;
-    
+bool game_apply_move(GameState *g, Pos from, Pos to, CaptureType capture) {
+    Step s;
+    if (!find_step(g, from, to, capture, &s)) return false;
+
+    game_apply_step(g, &s);
+
     // Switch player
-    g->current_player = (g->current_player == 1) ? 2 : 1;
+    game_switch_player(g);
+    return true;
 }
 
 bool game_is_terminal(const GameState *g, int *winner) {
-    // TODO: Implement proper game end detection
-    (void)g; // Suppress unused warning
-    *winner = 0; // Draw by default
+    int side = g->current_player - 1;
+    *winner = 0;
+
+    // A side that has lost all its stones, or cannot move, has lost
+    if (!g->pieces[side ^ 1]) {
+        *winner = side + 1;
+        return true;
+    }
+    Step steps[MAX_STEPS];
+    if (!g->pieces[side] || game_gen_steps(g, steps) == 0) {
+        *winner = (side ^ 1) + 1;
+        return true;
+    }
     return false;
 }
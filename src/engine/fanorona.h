@@ -1,13 +1,100 @@
 #pragma once
 #include <stdbool.h>
+#include <stdint.h>
+
+// Board geometry: 9 columns (x) by 5 rows (y), point index = y * 9 + x.
+// Points where x + y is even are "strong" and also connect diagonally.
+#define BOARD_W      9
+#define BOARD_H      5
+#define BOARD_POINTS 45
+#define BOARD_ALL    ((Bitboard)0x1FFFFFFFFFFFULL)
+#define POS_INDEX(x, y) ((y) * BOARD_W + (x))
+#define BIT(i)       ((Bitboard)1 << (i))
+
+// Upper bound on single steps in one position: the board has 108 lines
+// between adjacent points, each usable by at most one own->empty step,
+// and each step can capture by approach or by withdrawal.
+#define MAX_STEPS 216
+
+// Every capturing step takes at least one of the 22 enemy stones
+#define MAX_CHAIN 22
 
 typedef enum { EMPTY, WHITE, BLACK } Cell;
 typedef struct { int x, y; } Pos;
+typedef uint64_t Bitboard;
+
+// Ordered so that the opposite direction of d is d ^ 1
+typedef enum {
+    DIR_E, DIR_W, DIR_S, DIR_N, DIR_SE, DIR_NW, DIR_SW, DIR_NE, DIR_COUNT
+} Direction;
+
+typedef enum { CAPTURE_NONE, CAPTURE_APPROACH, CAPTURE_WITHDRAWAL } CaptureType;
+
+// One stone sliding to an adjacent empty point
+typedef struct {
+    uint8_t from, to;   // point indices
+    uint8_t dir;        // Direction
+    uint8_t capture;    // CaptureType
+} Step;
+
+// A whole turn: one paika step, or a chain of capturing steps by one stone
 typedef struct {
-    Cell board[9][5];
-    int  current_player;
+    Bitboard captured;            // every stone taken during the turn
+    uint32_t withdrawals;         // bit i set: step i captured by withdrawal
+    uint8_t  length;              // number of steps
+    uint8_t  path[MAX_CHAIN + 1]; // path[0] = origin, path[length] = destination
+} Turn;
+
+typedef struct {
+    Bitboard pieces[2];   // [0] = white, [1] = black
+    int      current_player; // 1 = white, 2 = black
+    uint64_t hash;        // Zobrist key, kept up to date by every update below
 } GameState;
 
-bool game_move_valid(const GameState *g, Pos from, Pos to);
-void game_apply_move(GameState *g, Pos from, Pos to);
-bool game_is_terminal(const GameState *g, int *winner);
\ No newline at end of file
+// Everything game_unmake() needs to take a turn back
+typedef struct {
+    Bitboard captured;     // stones taken by the turn
+    uint64_t prev_hash;
+    uint8_t  from, to;     // moved stone
+    int8_t   prev_player;
+} Undo;
+
+extern const int      DIR_DELTA[DIR_COUNT];
+extern const Bitboard DIR_MASK[DIR_COUNT];     // points with a neighbour in that direction
+extern const Bitboard ADJACENT[BOARD_POINTS];  // neighbours of each point
+
+static inline Bitboard bb_shift(Bitboard b, int dir) {
+    b &= DIR_MASK[dir];
+    return DIR_DELTA[dir] > 0 ? b << DIR_DELTA[dir] : b >> -DIR_DELTA[dir];
+}
+// Enemy stones in an unbroken line starting at `start` and running along `dir`
+static inline Bitboard bb_capture_line(Bitboard opp, int start, int dir) {
+    Bitboard cap = 0, b = BIT(start);
+    while (b & opp) {
+        cap |= b;
+        b = bb_shift(b, dir);
+    }
+    return cap;
+}
+static inline int bb_count(Bitboard b) { return __builtin_popcountll(b); }
+static inline int bb_lsb(Bitboard b)   { return __builtin_ctzll(b); }
+static inline Pos pos_from_index(int i) { Pos p = { i % BOARD_W, i / BOARD_W }; return p; }
+
+void     game_state_init(GameState *g);   // opening position, white to move
+Cell     game_cell(const GameState *g, int x, int y);
+void     game_set_cell(GameState *g, int x, int y, Cell c);
+int      game_gen_steps(const GameState *g, Step *out); // captures only when one exists
+Bitboard game_step_captures(const GameState *g, const Step *s);
+Bitboard game_apply_step(GameState *g, const Step *s);   // keeps the turn, returns captures
+void     game_apply_turn(GameState *g, const Turn *t);   // whole turn, then switches player
+void     game_make(GameState *g, const Turn *t, Undo *u);
+void     game_unmake(GameState *g, const Undo *u); // O(1) in the number of captures
+void     game_switch_player(GameState *g);
+void     game_turn_step(const Turn *t, int i, Step *s);
+bool     game_turn_equal(const Turn *a, const Turn *b);
+
+// capture: CAPTURE_NONE when the player made no choice, which is refused
+// if the step can capture both by approach and by withdrawal
+bool game_move_valid(const GameState *g, Pos from, Pos to); // with some capture choice
+bool game_apply_move(GameState *g, Pos from, Pos to, CaptureType capture);
+bool game_is_terminal(const GameState *g, int *winner);
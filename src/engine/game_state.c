@@ -1,16 +1,47 @@
 #include "game_state.h"
+#include "chain.h"
+#include "zobrist.h"
 #include <stdlib.h>
 #include <string.h>
 
+bool history_push(MoveHistory *h, PackedMove m) {
+    int chunk = h->count / HISTORY_CHUNK;
+    if (chunk == h->chunk_count) {
+        if (chunk == HISTORY_MAX_CHUNKS) return false;
+        h->chunks[chunk] = malloc(HISTORY_CHUNK * sizeof(PackedMove));
+        if (!h->chunks[chunk]) return false;
+        h->chunk_count++;
+    }
+    *history_at(h, h->count++) = m;
+    return true;
+}
+
+void history_free(MoveHistory *h) {
+    for (int i = 0; i < h->chunk_count; i++) free(h->chunks[i]);
+    memset(h, 0, sizeof(MoveHistory));
+}
+
+// Takes an entry back; `switched` when the turn was finished and the
+// player to move changed after it
+static void history_undo(GameState *g, PackedMove m, bool switched) {
+    int side = PMOVE_SIDE(m), from = PMOVE_FROM(m), to = PMOVE_TO(m);
+    Bitboard captured = PMOVE_CAPTURED(m);
+    g->pieces[side] ^= BIT(from) | BIT(to);
+    g->pieces[side ^ 1] ^= captured;
+    g->hash ^= ZOBRIST_PIECE[side][from] ^ ZOBRIST_PIECE[side][to];
+    for (; captured; captured &= captured - 1) g->hash ^= ZOBRIST_PIECE[side ^ 1][bb_lsb(captured)];
+    if (switched) game_switch_player(g);
+    ZOBRIST_CHECK(g);
+}
+
 GameManager *game_manager_create(void) {
     GameManager *gm = malloc(sizeof(GameManager));
+    if (!gm) return NULL;
     memset(gm, 0, sizeof(GameManager));
     
-    gm->move_capacity = 100;
-    gm->move_history = malloc(sizeof(Move) * gm->move_capacity);
-    gm->move_count = 0;
     gm->game_over = false;
     gm->winner = 0;
+    game_state_init(&gm->state);
     
     // Initialize timers (10 minutes per player)
     gm->time_per_player[0] = gm->time_per_player[1] = 600.0;
@@ -21,59 +52,146 @@ GameManager *game_manager_create(void) {
 
 void game_manager_destroy(GameManager *gm) {
     if (!gm) return;
-    free(gm->move_history);
+    history_free(&gm->history);
+    free(gm->valid_moves);
     free(gm);
 }
 
-bool game_manager_make_move(GameManager *gm, Pos from, Pos to) {
+// Feeds the recorder a finished turn, and the result once the game is over
+static void record_finished(GameManager *gm, const Turn *t) {
+    if (!gm->recorder) return;
+    record_turn(gm->recorder, t);
+    if (gm->game_over) record_end(gm->recorder, (RecordResult)gm->winner);
+}
+
+static void finish_turn(GameManager *gm) {
+    game_switch_player(&gm->state);
+    
+    // Check for game end
+    gm->game_over = game_is_terminal(&gm->state, &gm->winner);
+    record_finished(gm, &gm->pending);
+    gm->pending.length = 0;
+}
+
+// Steps the player may take now: chain continuations while a capture
+// chain is in progress, otherwise the first steps of every legal turn.
+static int current_steps(const GameManager *gm, Step *out) {
+    const Turn *t = &gm->pending;
+    if (t->length == 0) return game_gen_steps(&gm->state, out);
+    
+    Bitboard visited = 0;
+    for (int i = 0; i <= t->length; i++) visited |= BIT(t->path[i]);
+    return chain_continuations(&gm->state, t->path[t->length], gm->pending_dir, visited, out);
+}
+
+bool game_manager_make_move(GameManager *gm, Pos from, Pos to, CaptureType capture) {
     if (!gm || gm->game_over) return false;
     
-    if (!game_move_valid(&gm->state, from, to)) return false;
+    // Find the step; with no choice given it must be the only one
+    Step steps[MAX_STEPS], s;
+    int n = current_steps(gm, steps), matches = 0;
+    for (int i = 0; i < n; i++) {
+        if (steps[i].from != POS_INDEX(from.x, from.y) || steps[i].to != POS_INDEX(to.x, to.y)) continue;
+        if (capture != CAPTURE_NONE && steps[i].capture != capture) continue;
+        s = steps[i];
+        matches++;
+    }
+    if (matches != 1) return false;
     
-    // Store move in history
-    if (gm->move_count >= gm->move_capacity) {
-        gm->move_capacity *= 2;
-        gm->move_history = realloc(gm->move_history, sizeof(Move) * gm->move_capacity);
+    // A chain keeps extending the history entry of the turn that started it
+    Turn *t = &gm->pending;
+    int side = gm->state.current_player - 1;
+    if (t->length == 0) {
+        if (!history_push(&gm->history, pmove_pack(s.from, s.from, 0, side))) return false;
+        memset(t, 0, sizeof(Turn));
+        t->path[0] = s.from;
     }
     
-    Move *move = &gm->move_history[gm->move_count++];
-    move->from = from;
-    move->to = to;
-    move->captured_count = 0; // TODO: Calculate captures
+    Bitboard captured = game_apply_step(&gm->state, &s);
+    if (s.capture == CAPTURE_WITHDRAWAL) t->withdrawals |= 1u << t->length;
+    t->captured |= captured;
+    t->path[++t->length] = s.to;
+    gm->pending_dir = s.dir;
+    *history_at(&gm->history, gm->history.count - 1) = pmove_pack(t->path[0], s.to, t->captured, side);
+    
+    if (s.capture == CAPTURE_NONE || current_steps(gm, steps) == 0) {
+        finish_turn(gm);
+    }
+    return true;
+}
+
+bool game_manager_end_turn(GameManager *gm) {
+    if (!gm || gm->pending.length == 0) return false;
+    finish_turn(gm);
+    return true;
+}
+
+bool game_manager_play_turn(GameManager *gm, const Turn *t) {
+    if (!gm || !t || gm->game_over || gm->pending.length) return false;
     
-    game_apply_move(&gm->state, from, to);
+    // Checked step by step, so no list of turns can be too short for it
+    if (!chain_turn_legal(&gm->state, t)) return false;
     
-    // Check for game end
+    int side = gm->state.current_player - 1;
+    if (!history_push(&gm->history, pmove_pack(t->path[0], t->path[t->length], t->captured, side))) {
+        return false;
+    }
+    game_apply_turn(&gm->state, t);
     gm->game_over = game_is_terminal(&gm->state, &gm->winner);
-    
+    record_finished(gm, t);
     return true;
 }
 
+// Takes back the last turn, or the part of a chain played so far
 void game_manager_undo_move(GameManager *gm) {
-    if (!gm || gm->move_count == 0) return;
-    // TODO: Implement move undo
-    gm->move_count--;
+    if (!gm || gm->history.count == 0) return;
+    
+    // A chain in progress was never recorded, nor has the player changed
+    bool finished = gm->pending.length == 0;
+    if (finished && gm->recorder) record_undo(gm->recorder);
+    history_undo(&gm->state, *history_at(&gm->history, --gm->history.count), finished);
+    gm->pending.length = 0;
+    gm->game_over = false;
+    gm->winner = 0;
 }
 
 bool game_manager_can_undo(const GameManager *gm) {
-    return gm && gm->move_count > 0;
+    return gm && gm->history.count > 0;
 }
 
 void game_manager_reset(GameManager *gm) {
     if (!gm) return;
-    memset(&gm->state, 0, sizeof(GameState));
-    gm->move_count = 0;
+    game_state_init(&gm->state);
+    gm->history.count = 0;
+    gm->pending.length = 0;
     gm->game_over = false;
     gm->winner = 0;
     gm->time_remaining[0] = gm->time_per_player[0];
     gm->time_remaining[1] = gm->time_per_player[1];
+    if (gm->recorder) record_begin(gm->recorder, &gm->state); // ends the old game as unfinished
 }
 
-Move *game_manager_get_valid_moves(const GameManager *gm, int *count) {
+Move *game_manager_get_valid_moves(GameManager *gm, int *count) {
     if (!gm || !count) return NULL;
     *count = 0;
-    // TODO: Generate valid moves
-    return NULL;
+    if (gm->game_over) return NULL;
+
+    if (!gm->valid_moves) {
+        gm->valid_moves = malloc(sizeof(Move) * MAX_STEPS);
+        if (!gm->valid_moves) return NULL;
+    }
+
+    Step steps[MAX_STEPS];
+    int n = current_steps(gm, steps);
+    for (int i = 0; i < n; i++) {
+        Move *m = &gm->valid_moves[i];
+        m->from = pos_from_index(steps[i].from);
+        m->to = pos_from_index(steps[i].to);
+        m->captured = game_step_captures(&gm->state, &steps[i]);
+        m->capture = (CaptureType)steps[i].capture;
+    }
+    *count = n;
+    return gm->valid_moves;
 }
 
 void game_manager_update_timers(GameManager *gm, double dt) {
@@ -85,6 +203,29 @@ void game_manager_update_timers(GameManager *gm, double dt) {
         if (gm->time_remaining[current] <= 0) {
             gm->game_over = true;
             gm->winner = (current == 0) ? 2 : 1; // Other player wins
+            if (gm->recorder) record_end(gm->recorder, (RecordResult)gm->winner);
         }
     }
 }
+
+void game_manager_set_recorder(GameManager *gm, RecordWriter *w) {
+    if (!gm) return;
+    gm->recorder = w;
+    if (w) record_begin(w, &gm->state);
+}
+
+int game_manager_positions(const GameManager *gm, GameState *out, int max) {
+    if (!gm || !out) return 0;
+    int count = gm->history.count;
+    if (max < count + 1) return 0;
+
+    GameState g = gm->state;
+    out[count] = g;
+    for (int i = count - 1; i >= 0; i--) {
+        // Only the last entry can be a chain still in progress
+        bool finished = i < count - 1 || gm->pending.length == 0;
+        history_undo(&g, *history_at(&gm->history, i), finished);
+        out[i] = g;
+    }
+    return count + 1;
+}
@@ -1,29 +1,72 @@
 #pragma once
 #include "fanorona.h"
+#include "record.h"
 #include <stdbool.h>
 
+// A step the player may take, see game_manager_get_valid_moves()
 typedef struct {
     Pos from, to;
-    int captured_count;
-    Pos captured_pieces[20]; // Max possible captures
+    Bitboard captured;
+    CaptureType capture; // a step that can do both is listed twice
 } Move;
 
+// History entry: origin and final point of a turn (6 bits each), the
+// stones it took (45 bits) and the side that played it. Taking it back is
+// an XOR of the same bits, so no undo record is kept.
+typedef uint64_t PackedMove;
+#define PMOVE_FROM(m)     ((int)((m) & 63))
+#define PMOVE_TO(m)       ((int)(((m) >> 6) & 63))
+#define PMOVE_CAPTURED(m) ((Bitboard)((m) >> 12) & BOARD_ALL)
+#define PMOVE_SIDE(m)     ((int)((m) >> 57) & 1) // 0 = white, 1 = black
+
+static inline PackedMove pmove_pack(int from, int to, Bitboard captured, int side) {
+    return (PackedMove)from | (PackedMove)to << 6 | (PackedMove)captured << 12 | (PackedMove)side << 57;
+}
+
+// Chunks of 4 KB allocated as the game grows and kept for the next one;
+// entries never move, so nothing is copied as the history grows
+#define HISTORY_CHUNK      512
+#define HISTORY_MAX_CHUNKS 64  // 32768 turns
+
+typedef struct {
+    PackedMove *chunks[HISTORY_MAX_CHUNKS];
+    int         chunk_count; // allocated
+    int         count;       // entries in use
+} MoveHistory;
+
+bool history_push(MoveHistory *h, PackedMove m); // false when out of memory or chunks
+void history_free(MoveHistory *h);
+static inline PackedMove *history_at(const MoveHistory *h, int i) {
+    return &h->chunks[i / HISTORY_CHUNK][i % HISTORY_CHUNK];
+}
+
 typedef struct {
     GameState state;
-    Move *move_history;
-    int move_count;
-    int move_capacity;
+    MoveHistory history; // last entry is the chain in progress, if any
     bool game_over;
     int winner; // 0=draw, 1=white, 2=black
     double time_per_player[2];
     double time_remaining[2];
+    Move *valid_moves; // Buffer reused by game_manager_get_valid_moves()
+    Turn pending;      // Capture chain in progress (length 0 between turns)
+    int pending_dir;   // Direction of its last step
+    RecordWriter *recorder; // Optional, not owned: every finished turn is recorded
 } GameManager;
 
 GameManager *game_manager_create(void);
 void game_manager_destroy(GameManager *gm);
-bool game_manager_make_move(GameManager *gm, Pos from, Pos to);
+// One step; chains continue. capture is the player's choice, CAPTURE_NONE
+// when none was made, which fails if approach and withdrawal are both possible.
+bool game_manager_make_move(GameManager *gm, Pos from, Pos to, CaptureType capture);
+bool game_manager_end_turn(GameManager *gm);                      // stop a chain early
+bool game_manager_play_turn(GameManager *gm, const Turn *t);      // whole turn (AI, network)
 void game_manager_undo_move(GameManager *gm);
 bool game_manager_can_undo(const GameManager *gm);
 void game_manager_reset(GameManager *gm);
-Move *game_manager_get_valid_moves(const GameManager *gm, int *count);
+Move *game_manager_get_valid_moves(GameManager *gm, int *count); // owned by gm
 void game_manager_update_timers(GameManager *gm, double dt);
+void game_manager_set_recorder(GameManager *gm, RecordWriter *w); // starts a record here
+
+// Positions before each history entry and the current one: out[0..count],
+// rebuilt backwards from the current position. Returns the number written.
+int  game_manager_positions(const GameManager *gm, GameState *out, int max);
@@ -0,0 +1,102 @@
+#include "notation.h"
+#include "chain.h"
+#include "zobrist.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+bool game_from_fen(GameState *g, const char *fen) {
+    if (!g || !fen) return false;
+    memset(g, 0, sizeof(GameState));
+
+    int x = 0, y = 0;
+    for (; *fen && *fen != ' '; fen++) {
+        char c = *fen;
+        if (c == '/') {
+            if (x != BOARD_W) return false;
+            x = 0;
+            if (++y >= BOARD_H) return false;
+        } else if (c >= '1' && c <= '9') {
+            x += c - '0';
+        } else if (c == 'W' || c == 'B') {
+            if (x >= BOARD_W) return false;
+            g->pieces[c == 'W' ? 0 : 1] |= BIT(POS_INDEX(x, y));
+            x++;
+        } else {
+            return false;
+        }
+        if (x > BOARD_W) return false;
+    }
+    if (x != BOARD_W || y != BOARD_H - 1) return false;
+
+    while (*fen == ' ') fen++;
+    if (*fen == 'w' || *fen == '\0') g->current_player = 1;
+    else if (*fen == 'b') g->current_player = 2;
+    else return false;
+
+    // Each army starts with 22 stones
+    if (bb_count(g->pieces[0]) > 22 || bb_count(g->pieces[1]) > 22) return false;
+    g->hash = zobrist_compute(g);
+    return true;
+}
+
+void game_to_fen(const GameState *g, char *buf, size_t size) {
+    char tmp[FEN_MAX];
+    int n = 0;
+    for (int y = 0; y < BOARD_H; y++) {
+        int run = 0;
+        for (int x = 0; x < BOARD_W; x++) {
+            Cell c = game_cell(g, x, y);
+            if (c == EMPTY) {
+                run++;
+                continue;
+            }
+            if (run) tmp[n++] = (char)('0' + run);
+            run = 0;
+            tmp[n++] = (c == WHITE) ? 'W' : 'B';
+        }
+        if (run) tmp[n++] = (char)('0' + run);
+        tmp[n++] = (y < BOARD_H - 1) ? '/' : ' ';
+    }
+    tmp[n++] = (g->current_player == 1) ? 'w' : 'b';
+    tmp[n] = '\0';
+    snprintf(buf, size, "%s", tmp);
+}
+
+static int write_point(char *p, int index) {
+    Pos pos = pos_from_index(index);
+    p[0] = (char)('a' + pos.x);
+    p[1] = (char)('1' + (BOARD_H - 1 - pos.y));
+    return 2;
+}
+
+void turn_to_string(const Turn *t, char *buf, size_t size) {
+    char tmp[TURN_STR_MAX];
+    int n = write_point(tmp, t->path[0]);
+    for (int i = 0; i < t->length; i++) {
+        tmp[n++] = '-';
+        n += write_point(tmp + n, t->path[i + 1]);
+        if (t->captured) tmp[n++] = ((t->withdrawals >> i) & 1) ? 'W' : 'A';
+    }
+    tmp[n] = '\0';
+    snprintf(buf, size, "%s", tmp);
+}
+
+bool turn_parse(const GameState *g, const char *str, Turn *out) {
+    if (!g || !str || !out) return false;
+
+    Turn buf[MAX_TURNS];
+    char name[TURN_STR_MAX];
+    int n;
+    Turn *turns = chain_generate_all(g, buf, MAX_TURNS, &n);
+    bool found = false;
+    for (int i = 0; turns && i < n && !found; i++) {
+        turn_to_string(&turns[i], name, sizeof(name));
+        if (strcmp(name, str) == 0) {
+            *out = turns[i];
+            found = true;
+        }
+    }
+    if (turns != buf) free(turns);
+    return found;
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include "fanorona.h"
+#include <stddef.h>
+
+// Position strings list rows y = 0..4 separated by '/', using 'W', 'B' and
+// digits for runs of empty points, then the side to move:
+//   "BBBBBBBBB/BBBBBBBBB/BWBW1BWBW/WWWWWWWWW/WWWWWWWWW w"
+#define FEN_OPENING "BBBBBBBBB/BBBBBBBBB/BWBW1BWBW/WWWWWWWWW/WWWWWWWWW w"
+#define FEN_MAX     64
+
+// Turns name the points they visit, file a-i then rank 1-5 from white's
+// side, each capture suffixed with A (approach) or W (withdrawal):
+//   "e2-e3A-d4W", or "c2-d3" for a paika move
+#define TURN_STR_MAX (MAX_CHAIN * 4 + 4)
+
+bool game_from_fen(GameState *g, const char *fen);
+void game_to_fen(const GameState *g, char *buf, size_t size);
+void turn_to_string(const Turn *t, char *buf, size_t size);
+bool turn_parse(const GameState *g, const char *str, Turn *out); // must be legal
@@ -0,0 +1,411 @@
+#define _POSIX_C_SOURCE 200112L
+#include "record.h"
+#include "zobrist.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#define HEADER_SIZE   8
+#define READ_BUFFER   65536
+#define BITBOARD_SIZE 6 // 45 bits
+
+// CRC-32 (IEEE 802.3, reflected polynomial 0xEDB88320)
+static const uint32_t CRC_TABLE[256] = {
+    0x00000000, 0x77073096, 0xEE0E612C, 0x990951BA, 0x076DC419, 0x706AF48F,
+    0xE963A535, 0x9E6495A3, 0x0EDB8832, 0x79DCB8A4, 0xE0D5E91E, 0x97D2D988,
+    0x09B64C2B, 0x7EB17CBD, 0xE7B82D07, 0x90BF1D91, 0x1DB71064, 0x6AB020F2,
+    0xF3B97148, 0x84BE41DE, 0x1ADAD47D, 0x6DDDE4EB, 0xF4D4B551, 0x83D385C7,
+    0x136C9856, 0x646BA8C0, 0xFD62F97A, 0x8A65C9EC, 0x14015C4F, 0x63066CD9,
+    0xFA0F3D63, 0x8D080DF5, 0x3B6E20C8, 0x4C69105E, 0xD56041E4, 0xA2677172,
+    0x3C03E4D1, 0x4B04D447, 0xD20D85FD, 0xA50AB56B, 0x35B5A8FA, 0x42B2986C,
+    0xDBBBC9D6, 0xACBCF940, 0x32D86CE3, 0x45DF5C75, 0xDCD60DCF, 0xABD13D59,
+    0x26D930AC, 0x51DE003A, 0xC8D75180, 0xBFD06116, 0x21B4F4B5, 0x56B3C423,
+    0xCFBA9599, 0xB8BDA50F, 0x2802B89E, 0x5F058808, 0xC60CD9B2, 0xB10BE924,
+    0x2F6F7C87, 0x58684C11, 0xC1611DAB, 0xB6662D3D, 0x76DC4190, 0x01DB7106,
+    0x98D220BC, 0xEFD5102A, 0x71B18589, 0x06B6B51F, 0x9FBFE4A5, 0xE8B8D433,
+    0x7807C9A2, 0x0F00F934, 0x9609A88E, 0xE10E9818, 0x7F6A0DBB, 0x086D3D2D,
+    0x91646C97, 0xE6635C01, 0x6B6B51F4, 0x1C6C6162, 0x856530D8, 0xF262004E,
+    0x6C0695ED, 0x1B01A57B, 0x8208F4C1, 0xF50FC457, 0x65B0D9C6, 0x12B7E950,
+    0x8BBEB8EA, 0xFCB9887C, 0x62DD1DDF, 0x15DA2D49, 0x8CD37CF3, 0xFBD44C65,
+    0x4DB26158, 0x3AB551CE, 0xA3BC0074, 0xD4BB30E2, 0x4ADFA541, 0x3DD895D7,
+    0xA4D1C46D, 0xD3D6F4FB, 0x4369E96A, 0x346ED9FC, 0xAD678846, 0xDA60B8D0,
+    0x44042D73, 0x33031DE5, 0xAA0A4C5F, 0xDD0D7CC9, 0x5005713C, 0x270241AA,
+    0xBE0B1010, 0xC90C2086, 0x5768B525, 0x206F85B3, 0xB966D409, 0xCE61E49F,
+    0x5EDEF90E, 0x29D9C998, 0xB0D09822, 0xC7D7A8B4, 0x59B33D17, 0x2EB40D81,
+    0xB7BD5C3B, 0xC0BA6CAD, 0xEDB88320, 0x9ABFB3B6, 0x03B6E20C, 0x74B1D29A,
+    0xEAD54739, 0x9DD277AF, 0x04DB2615, 0x73DC1683, 0xE3630B12, 0x94643B84,
+    0x0D6D6A3E, 0x7A6A5AA8, 0xE40ECF0B, 0x9309FF9D, 0x0A00AE27, 0x7D079EB1,
+    0xF00F9344, 0x8708A3D2, 0x1E01F268, 0x6906C2FE, 0xF762575D, 0x806567CB,
+    0x196C3671, 0x6E6B06E7, 0xFED41B76, 0x89D32BE0, 0x10DA7A5A, 0x67DD4ACC,
+    0xF9B9DF6F, 0x8EBEEFF9, 0x17B7BE43, 0x60B08ED5, 0xD6D6A3E8, 0xA1D1937E,
+    0x38D8C2C4, 0x4FDFF252, 0xD1BB67F1, 0xA6BC5767, 0x3FB506DD, 0x48B2364B,
+    0xD80D2BDA, 0xAF0A1B4C, 0x36034AF6, 0x41047A60, 0xDF60EFC3, 0xA867DF55,
+    0x316E8EEF, 0x4669BE79, 0xCB61B38C, 0xBC66831A, 0x256FD2A0, 0x5268E236,
+    0xCC0C7795, 0xBB0B4703, 0x220216B9, 0x5505262F, 0xC5BA3BBE, 0xB2BD0B28,
+    0x2BB45A92, 0x5CB36A04, 0xC2D7FFA7, 0xB5D0CF31, 0x2CD99E8B, 0x5BDEAE1D,
+    0x9B64C2B0, 0xEC63F226, 0x756AA39C, 0x026D930A, 0x9C0906A9, 0xEB0E363F,
+    0x72076785, 0x05005713, 0x95BF4A82, 0xE2B87A14, 0x7BB12BAE, 0x0CB61B38,
+    0x92D28E9B, 0xE5D5BE0D, 0x7CDCEFB7, 0x0BDBDF21, 0x86D3D2D4, 0xF1D4E242,
+    0x68DDB3F8, 0x1FDA836E, 0x81BE16CD, 0xF6B9265B, 0x6FB077E1, 0x18B74777,
+    0x88085AE6, 0xFF0F6A70, 0x66063BCA, 0x11010B5C, 0x8F659EFF, 0xF862AE69,
+    0x616BFFD3, 0x166CCF45, 0xA00AE278, 0xD70DD2EE, 0x4E048354, 0x3903B3C2,
+    0xA7672661, 0xD06016F7, 0x4969474D, 0x3E6E77DB, 0xAED16A4A, 0xD9D65ADC,
+    0x40DF0B66, 0x37D83BF0, 0xA9BCAE53, 0xDEBB9EC5, 0x47B2CF7F, 0x30B5FFE9,
+    0xBDBDF21C, 0xCABAC28A, 0x53B39330, 0x24B4A3A6, 0xBAD03605, 0xCDD70693,
+    0x54DE5729, 0x23D967BF, 0xB3667A2E, 0xC4614AB8, 0x5D681B02, 0x2A6F2B94,
+    0xB40BBE37, 0xC30C8EA1, 0x5A05DF1B, 0x2D02EF8D,
+};
+
+uint32_t record_crc32(uint32_t crc, const void *data, size_t size) {
+    const uint8_t *p = data;
+    crc = ~crc;
+    while (size--) crc = CRC_TABLE[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+static bool is_opening(const GameState *g) {
+    GameState opening;
+    game_state_init(&opening);
+    return g->pieces[0] == opening.pieces[0] && g->pieces[1] == opening.pieces[1] &&
+           g->current_player == opening.current_player;
+}
+
+int record_encode_turn(const Turn *t, uint8_t *out) {
+    Step s;
+    game_turn_step(t, 0, &s);
+    int kind = t->captured ? ((t->withdrawals & 1) ? 2 : 1) : 0;
+    out[0] = (uint8_t)(t->path[0] | kind << 6);
+    out[1] = (uint8_t)((t->length - 1) << 3 | s.dir);
+    int n = 2;
+    for (int i = 1; i < t->length; i++) {
+        game_turn_step(t, i, &s);
+        uint8_t nibble = (uint8_t)(((t->withdrawals >> i) & 1) << 3 | s.dir);
+        if (i % 2) out[n] = nibble;
+        else out[n++] |= (uint8_t)(nibble << 4);
+    }
+    if (t->length % 2 == 0) n++; // odd number of nibbles, last byte half used
+    return n;
+}
+
+int record_turn_size(uint8_t second) {
+    return 2 + ((second >> 3) + 1) / 2;
+}
+
+bool record_decode_turn(GameState *g, const uint8_t *in, Turn *t) {
+    int origin = in[0] & 63, kind = in[0] >> 6, length = (in[1] >> 3) + 1;
+    if (origin >= BOARD_POINTS || kind == 3 || length > MAX_CHAIN || (kind == 0 && length > 1)) {
+        return false;
+    }
+    GameState next = *g;
+    int side = next.current_player - 1;
+    if (!(next.pieces[side] & BIT(origin))) return false;
+
+    memset(t, 0, sizeof(Turn));
+    t->path[0] = (uint8_t)origin;
+    int at = origin;
+    for (int i = 0; i < length; i++) {
+        int nibble = i == 0 ? ((kind == 2) << 3 | (in[1] & 7)) : (in[2 + (i - 1) / 2] >> (i % 2 ? 0 : 4)) & 15;
+        Step s;
+        s.dir = nibble & 7;
+        s.capture = kind == 0 ? CAPTURE_NONE : ((nibble & 8) ? CAPTURE_WITHDRAWAL : CAPTURE_APPROACH);
+        s.from = (uint8_t)at;
+        if (!(DIR_MASK[s.dir] & BIT(at))) return false;
+        s.to = (uint8_t)(at + DIR_DELTA[s.dir]);
+        if ((next.pieces[0] | next.pieces[1]) & BIT(s.to)) return false;
+
+        Bitboard captured = game_apply_step(&next, &s);
+        if (s.capture != CAPTURE_NONE && !captured) return false;
+        if (s.capture == CAPTURE_WITHDRAWAL) t->withdrawals |= 1u << i;
+        t->captured |= captured;
+        t->path[i + 1] = s.to;
+        at = s.to;
+    }
+    t->length = (uint8_t)length;
+    game_switch_player(&next);
+    *g = next;
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Writer
+// ---------------------------------------------------------------------------
+
+struct RecordWriter {
+    FILE     *f;
+    bool      in_game;
+    bool      sealed;       // the last game was written by record_end()
+    off_t     game_start;   // file offset of that game
+    uint8_t  *bytes;        // the current game, written out whole by record_end()
+    size_t    length, capacity;
+    uint32_t *turn_starts;  // offset of each turn in bytes, for record_undo()
+    int       turns, turn_capacity;
+};
+
+RecordWriter *record_writer_open(const char *path) {
+    if (!path || !path[0]) return NULL;
+
+    // An existing file must be a record of this version
+    FILE *f = fopen(path, "rb");
+    if (f) {
+        uint8_t h[HEADER_SIZE];
+        size_t n = fread(h, 1, HEADER_SIZE, f);
+        fclose(f);
+        if (n != 0 && (n != HEADER_SIZE || memcmp(h, RECORD_MAGIC, 4) != 0 || h[4] != RECORD_VERSION)) {
+            return NULL;
+        }
+    }
+
+    RecordWriter *w = calloc(1, sizeof(RecordWriter));
+    if (!w) return NULL;
+    w->f = fopen(path, "ab");
+    if (!w->f || fseeko(w->f, 0, SEEK_END) != 0) {
+        record_writer_close(w);
+        return NULL;
+    }
+    if (ftello(w->f) == 0) {
+        uint8_t h[HEADER_SIZE] = { 'F', 'N', 'G', 'R', RECORD_VERSION, 0, 0, 0 };
+        if (fwrite(h, 1, HEADER_SIZE, w->f) != HEADER_SIZE || fflush(w->f) != 0) {
+            record_writer_close(w);
+            return NULL;
+        }
+    }
+    return w;
+}
+
+void record_writer_close(RecordWriter *w) {
+    if (!w) return;
+    if (w->in_game) record_end(w, RECORD_UNFINISHED);
+    if (w->f) fclose(w->f);
+    free(w->bytes);
+    free(w->turn_starts);
+    free(w);
+}
+
+static bool put_bytes(RecordWriter *w, const uint8_t *data, size_t size) {
+    if (w->length + size > w->capacity) {
+        size_t capacity = w->capacity ? w->capacity * 2 : 1024;
+        while (capacity < w->length + size) capacity *= 2;
+        uint8_t *bytes = realloc(w->bytes, capacity);
+        if (!bytes) return false;
+        w->bytes = bytes;
+        w->capacity = capacity;
+    }
+    memcpy(w->bytes + w->length, data, size);
+    w->length += size;
+    return true;
+}
+
+bool record_begin(RecordWriter *w, const GameState *start) {
+    if (!w || !start) return false;
+    if (w->in_game && !record_end(w, RECORD_UNFINISHED)) return false;
+
+    w->length = 0;
+    w->turns = 0;
+    w->in_game = true;
+    w->sealed = false;
+
+    uint8_t b[2 + 2 * BITBOARD_SIZE];
+    if (is_opening(start)) {
+        b[0] = 0;
+        return put_bytes(w, b, 1);
+    }
+    b[0] = 1;
+    for (int side = 0; side < 2; side++) {
+        for (int i = 0; i < BITBOARD_SIZE; i++) {
+            b[1 + side * BITBOARD_SIZE + i] = (uint8_t)(start->pieces[side] >> (8 * i));
+        }
+    }
+    b[1 + 2 * BITBOARD_SIZE] = (uint8_t)start->current_player;
+    return put_bytes(w, b, sizeof(b));
+}
+
+bool record_turn(RecordWriter *w, const Turn *t) {
+    if (!w || !w->in_game || !t || t->length == 0 || t->length > MAX_CHAIN) return false;
+
+    if (w->turns == w->turn_capacity) {
+        int capacity = w->turn_capacity ? w->turn_capacity * 2 : 256;
+        uint32_t *starts = realloc(w->turn_starts, (size_t)capacity * sizeof(uint32_t));
+        if (!starts) return false;
+        w->turn_starts = starts;
+        w->turn_capacity = capacity;
+    }
+
+    uint8_t b[RECORD_TURN_MAX];
+    int n = record_encode_turn(t, b);
+    w->turn_starts[w->turns++] = (uint32_t)w->length;
+    return put_bytes(w, b, (size_t)n);
+}
+
+bool record_undo(RecordWriter *w) {
+    if (!w || (!w->in_game && !w->sealed) || w->turns == 0) return false;
+
+    // Taking back the last turn of a finished game reopens it
+    if (w->sealed) {
+        if (fflush(w->f) != 0 || ftruncate(fileno(w->f), w->game_start) != 0 ||
+            fseeko(w->f, w->game_start, SEEK_SET) != 0) {
+            return false;
+        }
+        w->sealed = false;
+        w->in_game = true;
+    }
+    w->length = w->turn_starts[--w->turns];
+    return true;
+}
+
+bool record_end(RecordWriter *w, RecordResult result) {
+    if (!w || !w->in_game) return false;
+    w->in_game = false;
+
+    uint32_t crc = record_crc32(0, w->bytes, w->length);
+    uint8_t end[2] = { RECORD_END, (uint8_t)result };
+    crc = record_crc32(crc, end, 2);
+    uint8_t c[4] = { (uint8_t)crc, (uint8_t)(crc >> 8), (uint8_t)(crc >> 16), (uint8_t)(crc >> 24) };
+
+    w->game_start = ftello(w->f);
+    w->sealed = fwrite(w->bytes, 1, w->length, w->f) == w->length &&
+                fwrite(end, 1, 2, w->f) == 2 && fwrite(c, 1, 4, w->f) == 4 && fflush(w->f) == 0;
+    return w->sealed;
+}
+
+// ---------------------------------------------------------------------------
+// Reader
+// ---------------------------------------------------------------------------
+
+struct RecordReader {
+    FILE        *f;
+    uint8_t      buffer[READ_BUFFER];
+    size_t       pos, fill;
+    uint32_t     crc;      // running CRC of the game, not yet inverted back
+    bool         in_game, failed;
+    GameState    position;
+    RecordResult result;
+};
+
+static int read_raw(RecordReader *r) {
+    if (r->pos == r->fill) {
+        r->fill = fread(r->buffer, 1, READ_BUFFER, r->f);
+        r->pos = 0;
+        if (r->fill == 0) return -1;
+    }
+    return r->buffer[r->pos++];
+}
+
+// A byte of the game body, counted in its checksum
+static int read_byte(RecordReader *r) {
+    int c = read_raw(r);
+    if (c >= 0) r->crc = CRC_TABLE[(r->crc ^ (uint32_t)c) & 0xFF] ^ (r->crc >> 8);
+    return c;
+}
+
+RecordReader *record_reader_open(const char *path) {
+    RecordReader *r = calloc(1, sizeof(RecordReader));
+    if (!r) return NULL;
+    r->f = path ? fopen(path, "rb") : NULL;
+    uint8_t h[HEADER_SIZE];
+    if (!r->f || fread(h, 1, HEADER_SIZE, r->f) != HEADER_SIZE ||
+        memcmp(h, RECORD_MAGIC, 4) != 0 || h[4] != RECORD_VERSION) {
+        record_reader_close(r);
+        return NULL;
+    }
+    return r;
+}
+
+void record_reader_close(RecordReader *r) {
+    if (!r) return;
+    if (r->f) fclose(r->f);
+    free(r);
+}
+
+static bool fail(RecordReader *r) {
+    r->failed = true;
+    r->in_game = false;
+    return false;
+}
+
+static int corrupt(RecordReader *r) {
+    fail(r);
+    return -1;
+}
+
+bool record_next_game(RecordReader *r, GameState *start) {
+    if (!r || r->failed) return false;
+
+    // Skip what is left of a game the caller did not finish
+    Turn t;
+    while (r->in_game && record_next_turn(r, &t) > 0) {}
+    if (r->failed) return false;
+
+    r->crc = 0xFFFFFFFFu;
+    int kind = read_byte(r);
+    if (kind < 0) return false; // end of file
+    if (kind == 0) {
+        game_state_init(&r->position);
+    } else if (kind == 1) {
+        memset(&r->position, 0, sizeof(GameState));
+        for (int side = 0; side < 2; side++) {
+            for (int i = 0; i < BITBOARD_SIZE; i++) {
+                int c = read_byte(r);
+                if (c < 0) return fail(r);
+                r->position.pieces[side] |= (Bitboard)c << (8 * i);
+            }
+        }
+        int player = read_byte(r);
+        Bitboard w = r->position.pieces[0], b = r->position.pieces[1];
+        if ((player != 1 && player != 2) || (w & b) || ((w | b) & ~BOARD_ALL)) return fail(r);
+        r->position.current_player = player;
+        r->position.hash = zobrist_compute(&r->position);
+    } else {
+        return fail(r);
+    }
+    r->in_game = true;
+    if (start) *start = r->position;
+    return true;
+}
+
+static int finish_game(RecordReader *r) {
+    int result = read_byte(r);
+    uint32_t crc = ~r->crc;
+    uint32_t stored = 0;
+    for (int i = 0; i < 4; i++) {
+        int c = read_raw(r);
+        if (c < 0) return corrupt(r);
+        stored |= (uint32_t)c << (8 * i);
+    }
+    if (result < 0 || result > RECORD_UNFINISHED || stored != crc) return corrupt(r);
+    r->result = (RecordResult)result;
+    r->in_game = false;
+    return 0;
+}
+
+int record_next_turn(RecordReader *r, Turn *t) {
+    if (!r || !r->in_game) return -1;
+
+    int b0 = read_byte(r);
+    if (b0 == RECORD_END) return finish_game(r);
+    int b1 = read_byte(r);
+    if (b0 < 0 || b1 < 0) return corrupt(r);
+
+    uint8_t b[RECORD_TURN_MAX] = { (uint8_t)b0, (uint8_t)b1 };
+    int size = record_turn_size(b[1]);
+    if (size > RECORD_TURN_MAX) return corrupt(r);
+    for (int i = 2; i < size; i++) {
+        int c = read_byte(r);
+        if (c < 0) return corrupt(r);
+        b[i] = (uint8_t)c;
+    }
+    return record_decode_turn(&r->position, b, t) ? 1 : corrupt(r);
+}
+
+const GameState *record_position(const RecordReader *r) {
+    return &r->position;
+}
+
+RecordResult record_result(const RecordReader *r) {
+    return r->result;
+}
+
+bool record_failed(const RecordReader *r) {
+    return r->failed;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include "fanorona.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Binary game records: "FNGR", a version byte and 3 reserved bytes, then
+// any number of games. A game is
+//   start    0 = opening position, 1 = followed by white and black as
+//            6-byte little-endian bitboards and the side to move (1 or 2)
+//   turns    byte 0: origin | first capture << 6 (0 paika, 1 approach,
+//            2 withdrawal), byte 1: (length - 1) << 3 | first direction,
+//            then one nibble per further step, withdrawal << 3 | direction,
+//            low nibble first, padded with 0 to a whole byte
+//   0xFF, the result byte (RecordResult) and the CRC-32 of the game from
+//   its start byte through the result, little-endian
+// Paika moves and single captures take 2 bytes; captures are not stored,
+// they follow from the position.
+#define RECORD_MAGIC   "FNGR"
+#define RECORD_VERSION 1
+#define RECORD_END     0xFF
+
+typedef enum {
+    RECORD_DRAW, RECORD_WHITE_WINS, RECORD_BLACK_WINS, RECORD_UNFINISHED
+} RecordResult;
+
+typedef struct RecordWriter RecordWriter;
+typedef struct RecordReader RecordReader;
+
+// Appends to path, creating it when missing. A game is kept in memory
+// until record_end() writes it out whole with its checksum, so a crash
+// never leaves a torn game in the file. Not thread-safe.
+RecordWriter *record_writer_open(const char *path);
+void          record_writer_close(RecordWriter *w); // ends an open game as unfinished
+bool          record_begin(RecordWriter *w, const GameState *start);
+bool          record_turn(RecordWriter *w, const Turn *t);
+bool          record_undo(RecordWriter *w); // drops the last turn, reopening a game just ended
+bool          record_end(RecordWriter *w, RecordResult result);
+
+// Streams games back. record_next_game() positions the reader on the next
+// game; record_next_turn() then decodes one turn against the current
+// position and plays it. Turns are checked for shape (points on the board,
+// directions along real lines, empty destinations, captures that take
+// something) but not against the full move generator.
+RecordReader    *record_reader_open(const char *path);
+void             record_reader_close(RecordReader *r);
+bool             record_next_game(RecordReader *r, GameState *start); // false at the end or on error
+// 1 = turn played, 0 = game over with a valid checksum, -1 = corrupt
+int              record_next_turn(RecordReader *r, Turn *t);
+const GameState *record_position(const RecordReader *r); // after the turns read so far
+RecordResult     record_result(const RecordReader *r);   // once record_next_turn() returned 0
+bool             record_failed(const RecordReader *r);   // a bad header or game was met
+
+// The turn encoding on its own, shared with the network protocol.
+// record_decode_turn() checks the turn as the reader does, then plays it on
+// g; in holds record_turn_size(in[1]) bytes.
+#define RECORD_TURN_MAX (2 + MAX_CHAIN / 2)
+int  record_encode_turn(const Turn *t, uint8_t *out); // bytes written
+int  record_turn_size(uint8_t second);                // from a turn's second byte
+bool record_decode_turn(GameState *g, const uint8_t *in, Turn *t);
+
+uint32_t record_crc32(uint32_t crc, const void *data, size_t size);
@@ -0,0 +1,53 @@
+#include "zobrist.h"
+
+// Fixed keys from a splitmix64 stream seeded with "FANORONA", so hashes are
+// identical across builds, processes and network peers.
+const uint64_t ZOBRIST_PIECE[2][BOARD_POINTS] = {
+    {
+        0x0854A51F1E120026ULL, 0x796628E03290C294ULL, 0xC557542B5BD27AA6ULL,
+        0x8BC51E1EF626333CULL, 0xDD69D956206947F5ULL, 0xD5E1168B6EBBE268ULL,
+        0xCF7F6B421DA44E70ULL, 0x4D1310F2D7CC86E5ULL, 0xB20BC694A105C7CCULL,
+        0xC36A19F0BB9D449FULL, 0xAC1BDFD8A88D1141ULL, 0x690DB15EDEDB71C4ULL,
+        0x7FDE3C9F39019B63ULL, 0x50557C4147B84060ULL, 0x1DF14E6C5DBAC24AULL,
+        0xE180647AEBACA0D6ULL, 0x1A57C9A5C6CD3C56ULL, 0xA33C51AB0C54494EULL,
+        0x4B980F70F1A2A2FBULL, 0x2EA82CF549273064ULL, 0x71FDBEF7A01F09B1ULL,
+        0x97508B51573E9F74ULL, 0xABA3164B3DBA6B2CULL, 0x98F98CD3E8559D00ULL,
+        0x7EFB73670F9F475AULL, 0xA87D017B9FE7E1A2ULL, 0x8A4BF22E20EA95E4ULL,
+        0xCB6399A705CE4FF3ULL, 0xC180DD432FE59D80ULL, 0x4C204618CB074445ULL,
+        0xC789DFAB990E979CULL, 0x8AE01F26F456D28AULL, 0x4E8E4BBC896B35C8ULL,
+        0x7EBE1BC67DCFDA8BULL, 0x34D42AC8C4FF8ED4ULL, 0x7E37A5C718CD8AEAULL,
+        0x59175A8754BBB3C8ULL, 0x5436BD7FE3503F45ULL, 0x9BA5CF96AEBFD5E6ULL,
+        0x8F3D0D4A668315D6ULL, 0x6B8297BBF6CAA23BULL, 0x599B76D4695EB3F7ULL,
+        0x2D20F6DBE70A3B49ULL, 0xA582B2D898D7A47BULL, 0xFDC639369990744FULL,
+    },
+    {
+        0x73FC252FF48B2D23ULL, 0xFA5B247FF81FAABCULL, 0x8B359F67A1DF515BULL,
+        0x82276AB6B5C18224ULL, 0x91DF992CF425C655ULL, 0x875EED01E28E5136ULL,
+        0x91DC4B0728CFDB70ULL, 0x8C3E7529FEFC5142ULL, 0xB29E625C8589A8B0ULL,
+        0x6B0DBAF885F71506ULL, 0x1CA1B7DFC03EEC0EULL, 0x8F9FBD3F6EB99376ULL,
+        0xA5980CFE4FA7147DULL, 0x509EC9D97C7AF77FULL, 0x49CF711331895E6DULL,
+        0x5ADA9E0963E03D8FULL, 0x319B9095F535221CULL, 0xC1044CCB949D4786ULL,
+        0x3E5729435488E7C5ULL, 0xD8108E2EF1F41699ULL, 0xF4171CD92C044F5AULL,
+        0x071BF5EEBC699264ULL, 0x5FC76A3E2D72B9B8ULL, 0xED23DA451B8E6F4AULL,
+        0x2F8D5D7566D5DA51ULL, 0x1BEB77F64C7BA5D7ULL, 0x985067CDF742E029ULL,
+        0xFE46749B0BA98CD0ULL, 0x2B666696D8E6A4E1ULL, 0xC813536A9A7F0BBCULL,
+        0x836C1A17E20F2FB9ULL, 0x3275E4477E21FDDFULL, 0x44EDAC43B54920A4ULL,
+        0x41450AB55C65DB93ULL, 0xE1D881B2B07F1540ULL, 0x45D6C6A826E78058ULL,
+        0xE15DC0FB0879C762ULL, 0x858309D38A013D92ULL, 0x128909CF9198037EULL,
+        0x4B840680D8407E36ULL, 0x0C1B0A89F8370B9AULL, 0xD1661823DD3E9C0DULL,
+        0x9FDE5CBAE7B92EB8ULL, 0x085CF7E6D7D84F62ULL, 0x4184D6ECC192C07DULL,
+    },
+};
+
+const uint64_t ZOBRIST_SIDE = 0x818D4CCEBEFC12EBULL;
+
+uint64_t zobrist_compute(const GameState *g) {
+    uint64_t h = 0;
+    for (int side = 0; side < 2; side++) {
+        for (Bitboard b = g->pieces[side]; b; b &= b - 1) {
+            h ^= ZOBRIST_PIECE[side][bb_lsb(b)];
+        }
+    }
+    if (g->current_player == 2) h ^= ZOBRIST_SIDE;
+    return h;
+}
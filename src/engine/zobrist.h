@@ -0,0 +1,15 @@
+#pragma once
+#include "fanorona.h"
+
+extern const uint64_t ZOBRIST_PIECE[2][BOARD_POINTS];
+extern const uint64_t ZOBRIST_SIDE; // black to move
+
+uint64_t zobrist_compute(const GameState *g); // from scratch
+
+// Debug builds recompute the key after every update and compare
+#ifdef DEBUG
+#include <assert.h>
+#define ZOBRIST_CHECK(g) assert((g)->hash == zobrist_compute(g))
+#else
+#define ZOBRIST_CHECK(g) ((void)0)
+#endif
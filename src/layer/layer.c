@@ -22,6 +22,7 @@ void layer_destroy(Layer *l) {
         child = next;
     }
     
+    render_target_destroy(l->cache);
     free(l);
 }
 
@@ -31,6 +32,10 @@ void layer_set_rect(Layer *l, const SDL_Rect *r) {
     l->dirty = true;
 }
 
+void layer_mark_dirty(Layer *l) {
+    if (l) l->dirty = true;
+}
+
 void layer_add_child(Layer *parent, Layer *child) {
     if (!parent || !child) return;
     
@@ -38,3 +43,13 @@ void layer_add_child(Layer *parent, Layer *child) {
     child->next = parent->children;
     parent->children = child;
 }
+
+void layer_set_cached(Layer *l, bool cached) {
+    if (!l || l->cached == cached) return;
+    l->cached = cached;
+    if (!cached) {
+        render_target_destroy(l->cache);
+        l->cache = NULL;
+    }
+    l->dirty = true;
+}
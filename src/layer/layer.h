@@ -1,11 +1,15 @@
 #pragma once
 #include <SDL2/SDL.h>
 #include <stdbool.h>
+#include "render_target.h"
 typedef struct Layer Layer;
 struct Layer {
     SDL_Rect   rect;      // absolu
     int        z_index;
     bool       dirty;
+    SDL_Rect   drawn;     // rect au dernier rendu, repeint aussi s'il a bougé
+    bool       cached;    // gardée dans sa texture, voir layer_set_cached()
+    RenderTarget *cache;  // créée au premier rendu
     Layer     *parent, *next, *children;
     void     (*on_render)(Layer *self, SDL_Renderer *ren);
     void     (*on_event) (Layer *self, SDL_Event *e);
@@ -14,4 +18,9 @@ struct Layer {
 Layer *layer_create(void);
 void   layer_destroy(Layer *l);
 void   layer_set_rect(Layer *l, const SDL_Rect *r);   // marque dirty
-void   layer_add_child(Layer *parent, Layer *child);
\ No newline at end of file
+void   layer_mark_dirty(Layer *l);                    // contenu changé, redessiné à la prochaine image
+void   layer_add_child(Layer *parent, Layer *child);
+// La couche et ses enfants sont dessinés dans une texture à sa taille, redessinée
+// seulement quand l'un d'eux est dirty ; sinon une seule copie. Les enfants
+// sont coupés au rect de la couche.
+void   layer_set_cached(Layer *l, bool cached);
\ No newline at end of file
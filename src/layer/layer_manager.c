@@ -3,22 +3,28 @@
 #include <stdlib.h>
 #include <string.h>
 
+#define MAX_CLIP_RECTS 16 // beyond this one bounding rect is cheaper than many passes
+
 LayerManager *lm_create(void) {
     LayerManager *lm = malloc(sizeof(LayerManager));
+    memset(lm, 0, sizeof(LayerManager));
     lm->root = layer_create();
     lm->dirty_list = malloc(sizeof(SDL_Rect) * 32);
     lm->dirty_count = 0;
     lm->dirty_cap = 32;
+    lm->full_redraw = true;
     return lm;
 }
 
 void lm_destroy(LayerManager *lm) {
     layer_destroy(lm->root);
+    render_target_destroy(lm->frame);
     free(lm->dirty_list);
     free(lm);
 }
 
 void lm_add_dirty(LayerManager *lm, const SDL_Rect *r) {
+    if (r->w <= 0 || r->h <= 0) return;
     if (lm->dirty_count >= lm->dirty_cap) {
         lm->dirty_cap *= 2;
         lm->dirty_list = realloc(lm->dirty_list, sizeof(SDL_Rect) * lm->dirty_cap);
@@ -26,18 +32,176 @@ void lm_add_dirty(LayerManager *lm, const SDL_Rect *r) {
     lm->dirty_list[lm->dirty_count++] = *r;
 }
 
-static void render_layer_recursive(Layer *l, SDL_Renderer *ren) {
-    if (l->on_render) {
-        l->on_render(l, ren);
+void lm_invalidate(LayerManager *lm) {
+    lm->full_redraw = true;
+}
+
+static bool rect_empty(const SDL_Rect *r) {
+    return r->w <= 0 || r->h <= 0;
+}
+
+// Turns dirty flags into regions: where the layer was and where it is now.
+// A cached layer goes stale when it or anything below it was dirty.
+static bool collect_dirty(LayerManager *lm, Layer *l) {
+    bool dirty = l->dirty;
+    if (l->dirty) {
+        if (l == lm->root) {
+            lm->full_redraw = true;
+        } else {
+            lm_add_dirty(lm, &l->drawn);
+            if (memcmp(&l->drawn, &l->rect, sizeof(SDL_Rect)) != 0) lm_add_dirty(lm, &l->rect);
+        }
+        l->drawn = l->rect;
+        l->dirty = false;
+    }
+    for (Layer *child = l->children; child; child = child->next) {
+        dirty |= collect_dirty(lm, child);
+    }
+    if (dirty && l->cache) l->cache->valid = false;
+    return dirty;
+}
+
+// Merges overlapping rects until none overlap, so no pixel is drawn twice
+static void coalesce(LayerManager *lm) {
+    SDL_Rect *r = lm->dirty_list;
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (int i = 0; i < lm->dirty_count; i++) {
+            for (int j = i + 1; j < lm->dirty_count; j++) {
+                if (!dirty_intersect(&r[i], &r[j])) continue;
+                dirty_union(&r[i], &r[j]);
+                r[j--] = r[--lm->dirty_count];
+                merged = true;
+            }
+        }
+    }
+    if (lm->dirty_count > MAX_CLIP_RECTS) {
+        for (int i = 1; i < lm->dirty_count; i++) dirty_union(&r[0], &r[i]);
+        lm->dirty_count = 1;
+    }
+}
+
+static void clear_transparent(SDL_Renderer *ren, const SDL_Rect *r) {
+    SDL_SetRenderDrawBlendMode(ren, SDL_BLENDMODE_NONE);
+    SDL_SetRenderDrawColor(ren, 0, 0, 0, 0);
+    SDL_RenderFillRect(ren, r);
+    SDL_SetRenderDrawBlendMode(ren, SDL_BLENDMODE_BLEND);
+}
+
+static bool overlaps(const Layer *l, const SDL_Rect *clip) {
+    return !clip || (!rect_empty(&l->rect) && dirty_intersect(&l->rect, clip));
+}
+
+// Layer rects are absolute; drawing into a layer's own texture moves its
+// subtree to the origin for the time of the draw
+static void shift_tree(Layer *l, int dx, int dy) {
+    l->rect.x += dx;
+    l->rect.y += dy;
+    for (Layer *child = l->children; child; child = child->next) {
+        shift_tree(child, dx, dy);
+    }
+}
+
+static void draw_layer(Layer *l, SDL_Renderer *ren, const SDL_Rect *clip);
+
+static void draw_contents(Layer *l, SDL_Renderer *ren, const SDL_Rect *clip) {
+    if (l->on_render) l->on_render(l, ren);
+    for (Layer *child = l->children; child; child = child->next) {
+        draw_layer(child, ren, clip);
+    }
+}
+
+// Redraws the layer's texture if stale, then one copy of it
+static void draw_cached(Layer *l, SDL_Renderer *ren, const SDL_Rect *clip) {
+    if (!l->cache) l->cache = render_target_create(ren, l->rect.w, l->rect.h);
+    else render_target_resize(l->cache, l->rect.w, l->rect.h);
+
+    if (l->cache && !l->cache->valid && render_target_begin(l->cache)) {
+        SDL_Rect all = { 0, 0, l->rect.w, l->rect.h };
+        int x = l->rect.x, y = l->rect.y;
+        clear_transparent(ren, &all);
+        shift_tree(l, -x, -y);
+        draw_contents(l, ren, NULL);
+        shift_tree(l, x, y);
+        render_target_end(l->cache);
+    }
+    if (l->cache && l->cache->valid) render_target_draw(l->cache, &l->rect);
+    else draw_contents(l, ren, clip); // no texture to be had
+}
+
+// Layers are drawn where they overlap the clip, children even when their
+// parent is not. A NULL clip draws everything.
+static void draw_layer(Layer *l, SDL_Renderer *ren, const SDL_Rect *clip) {
+    if (l->cached && !rect_empty(&l->rect)) {
+        if (overlaps(l, clip)) draw_cached(l, ren, clip);
+        return;
     }
+    if (l->on_render && overlaps(l, clip)) l->on_render(l, ren);
     for (Layer *child = l->children; child; child = child->next) {
-        render_layer_recursive(child, ren);
+        draw_layer(child, ren, clip);
+    }
+}
+
+// The cached frame follows the output size; a new one is drawn in full
+static bool ensure_frame(LayerManager *lm, SDL_Renderer *ren) {
+    int w, h;
+    if (SDL_GetRendererOutputSize(ren, &w, &h) != 0) return false;
+    if (!lm->frame) lm->frame = render_target_create(ren, w, h);
+    else render_target_resize(lm->frame, w, h);
+    return lm->frame != NULL;
+}
+
+bool lm_update(LayerManager *lm, SDL_Renderer *ren) {
+    collect_dirty(lm, lm->root);
+    bool cached = ensure_frame(lm, ren);
+    bool changed = lm->full_redraw || lm->dirty_count > 0 || (cached && !lm->frame->valid);
+    if (!changed || !cached || !render_target_begin(lm->frame)) {
+        // Without a cache lm_render() draws the whole tree each time
+        lm->dirty_count = 0;
+        lm->full_redraw = false;
+        return changed;
     }
+
+    // The root paints the background and is drawn under every clip
+    SDL_Rect screen = { 0, 0, lm->frame->width, lm->frame->height };
+    if (lm->full_redraw || !lm->frame->valid) {
+        lm->dirty_list[0] = screen;
+        lm->dirty_count = 1;
+    } else {
+        coalesce(lm);
+    }
+    for (int i = 0; i < lm->dirty_count; i++) {
+        SDL_Rect clip;
+        if (!SDL_IntersectRect(&lm->dirty_list[i], &screen, &clip)) continue;
+        SDL_RenderSetClipRect(ren, &clip);
+        clear_transparent(ren, &clip); // as a fresh frame would be
+        draw_contents(lm->root, ren, &clip);
+    }
+    render_target_end(lm->frame);
+
+    lm->dirty_count = 0;
+    lm->full_redraw = false;
+    return true;
 }
 
 void lm_render(LayerManager *lm, SDL_Renderer *ren) {
-    render_layer_recursive(lm->root, ren);
-    lm->dirty_count = 0; // Reset dirty regions after render
+    lm_update(lm, ren);
+    if (lm->frame && lm->frame->valid) render_target_draw(lm->frame, NULL);
+    else draw_contents(lm->root, ren, NULL);
+}
+
+static void reset_layer(Layer *l, bool device_lost) {
+    render_target_reset(l->cache, device_lost);
+    for (Layer *child = l->children; child; child = child->next) {
+        reset_layer(child, device_lost);
+    }
+}
+
+void lm_reset_targets(LayerManager *lm, bool device_lost) {
+    render_target_reset(lm->frame, device_lost);
+    reset_layer(lm->root, device_lost);
+    lm->full_redraw = true;
 }
 
 static void dispatch_to_layer(Layer *l, SDL_Event *e) {
@@ -50,5 +214,8 @@ static void dispatch_to_layer(Layer *l, SDL_Event *e) {
 }
 
 void lm_dispatch(LayerManager *lm, SDL_Event *e) {
+    if (e->type == SDL_RENDER_TARGETS_RESET || e->type == SDL_RENDER_DEVICE_RESET) {
+        lm_reset_targets(lm, e->type == SDL_RENDER_DEVICE_RESET);
+    }
     dispatch_to_layer(lm->root, e);
 }
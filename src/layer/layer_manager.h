@@ -1,14 +1,24 @@
 #pragma once
 #include "layer.h"
 
+// Rendu retenu : l'image composée est gardée dans une texture et seules les
+// zones sales (layers marqués dirty, rects ajoutés par lm_add_dirty) sont
+// redessinées, découpées par SDL_RenderSetClipRect. Le root couvre toute
+// l'image ; le marquer dirty redessine tout. Les couches cached gardent en
+// plus leur propre texture (layer_set_cached()).
 typedef struct {
     Layer *root;
     SDL_Rect *dirty_list;
     int dirty_count, dirty_cap;
+    RenderTarget *frame;      // dernière image composée, NULL sans render targets
+    bool full_redraw;
 } LayerManager;
 
 LayerManager *lm_create(void);
 void          lm_destroy(LayerManager *lm);
 void          lm_add_dirty(LayerManager *lm, const SDL_Rect *r);
-void          lm_render(LayerManager *lm, SDL_Renderer *ren);
-void          lm_dispatch(LayerManager *lm, SDL_Event *e);
\ No newline at end of file
+void          lm_invalidate(LayerManager *lm);                 // tout redessiner (contenu perdu, redimensionnement)
+bool          lm_update(LayerManager *lm, SDL_Renderer *ren);  // redessine les zones sales ; false si rien n'a changé
+void          lm_render(LayerManager *lm, SDL_Renderer *ren);  // lm_update puis copie l'image sur la cible courante
+void          lm_reset_targets(LayerManager *lm, bool device_lost); // textures perdues, reconstruites au prochain rendu
+void          lm_dispatch(LayerManager *lm, SDL_Event *e);          // gère aussi SDL_RENDER_TARGETS_RESET/DEVICE_RESET
@@ -1,5 +1,79 @@
 #include "render_target.h"
 #include <SDL2/SDL.h>
+#include <stdlib.h>
+#include <string.h>
 
-// Basic render target functionality
-// This can be expanded later for off-screen rendering
+static bool build(RenderTarget *rt) {
+    rt->texture = SDL_CreateTexture(rt->renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET,
+                                    rt->width, rt->height);
+    if (!rt->texture) return false;
+    SDL_SetTextureBlendMode(rt->texture, SDL_BLENDMODE_BLEND);
+    rt->valid = false;
+    return true;
+}
+
+RenderTarget *render_target_create(SDL_Renderer *ren, int w, int h) {
+    if (!ren || w <= 0 || h <= 0 || !SDL_RenderTargetSupported(ren)) return NULL;
+    RenderTarget *rt = malloc(sizeof(RenderTarget));
+    if (!rt) return NULL;
+    memset(rt, 0, sizeof(RenderTarget));
+    rt->renderer = ren;
+    rt->width = w;
+    rt->height = h;
+    if (!build(rt)) {
+        free(rt);
+        return NULL;
+    }
+    return rt;
+}
+
+void render_target_destroy(RenderTarget *rt) {
+    if (!rt) return;
+    if (rt->texture) SDL_DestroyTexture(rt->texture);
+    free(rt);
+}
+
+void render_target_resize(RenderTarget *rt, int w, int h) {
+    if (!rt || w <= 0 || h <= 0 || (w == rt->width && h == rt->height)) return;
+    if (rt->texture) SDL_DestroyTexture(rt->texture);
+    rt->texture = NULL;
+    rt->width = w;
+    rt->height = h;
+    rt->valid = false;
+}
+
+bool render_target_begin(RenderTarget *rt) {
+    if (!rt || (!rt->texture && !build(rt))) return false;
+
+    // Switching targets drops the clip, so the caller's is put back at the end
+    rt->previous = SDL_GetRenderTarget(rt->renderer);
+    rt->previous_clipped = SDL_RenderIsClipEnabled(rt->renderer);
+    SDL_RenderGetClipRect(rt->renderer, &rt->previous_clip);
+    if (SDL_SetRenderTarget(rt->renderer, rt->texture) != 0) return false;
+    SDL_RenderSetClipRect(rt->renderer, NULL);
+    return true;
+}
+
+void render_target_end(RenderTarget *rt) {
+    if (!rt) return;
+    SDL_SetRenderTarget(rt->renderer, rt->previous);
+    SDL_RenderSetClipRect(rt->renderer, rt->previous_clipped ? &rt->previous_clip : NULL);
+    rt->previous = NULL;
+    rt->valid = true;
+}
+
+void render_target_draw(RenderTarget *rt, const SDL_Rect *dst) {
+    if (!rt || !rt->texture) return;
+    SDL_RenderCopy(rt->renderer, rt->texture, NULL, dst);
+}
+
+// Targets reset: the texture is still there but its pixels are not.
+// Device lost: the texture itself is gone and is built again when next used.
+void render_target_reset(RenderTarget *rt, bool device_lost) {
+    if (!rt) return;
+    if (device_lost && rt->texture) {
+        SDL_DestroyTexture(rt->texture);
+        rt->texture = NULL;
+    }
+    rt->valid = false;
+}
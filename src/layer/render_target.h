@@ -1,11 +1,24 @@
 #pragma once
 #include <SDL2/SDL.h>
+#include <stdbool.h>
 
-// Render target functionality for off-screen rendering
+// Render target functionality for off-screen rendering. The texture is
+// rebuilt lazily by render_target_begin() after a resize or a lost device;
+// valid says whether its content is still the last thing drawn into it.
 typedef struct {
+    SDL_Renderer *renderer;
     SDL_Texture *texture;
     int width, height;
+    bool valid;
+    SDL_Texture *previous;  // target and clip to restore in render_target_end()
+    SDL_Rect previous_clip;
+    bool previous_clipped;
 } RenderTarget;
 
-RenderTarget *render_target_create(SDL_Renderer *ren, int w, int h);
+RenderTarget *render_target_create(SDL_Renderer *ren, int w, int h); // NULL without render target support
 void render_target_destroy(RenderTarget *rt);
+void render_target_resize(RenderTarget *rt, int w, int h);
+bool render_target_begin(RenderTarget *rt);   // draw into the texture until render_target_end()
+void render_target_end(RenderTarget *rt);     // marks the content valid
+void render_target_draw(RenderTarget *rt, const SDL_Rect *dst);
+void render_target_reset(RenderTarget *rt, bool device_lost); // SDL_RENDER_TARGETS_RESET or SDL_RENDER_DEVICE_RESET
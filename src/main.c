@@ -1,24 +1,20 @@
 #include "core/sdl_init.h"
 #include "core/timer.h"
+#include "core/config.h"
+#include "ai/ai_service.h"
 #include "audio/audio.h"
+#include "net/p2p.h"
 #include "scenes/scene.h"
 #include "layer/layer_manager.h"
 #include <stdio.h>
 
-static void render_menu_scene(SDL_Renderer *ren) {
-    // Rendu spécifique au menu
-    SDL_SetRenderDrawColor(ren, 40, 40, 60, 255);
-    SDL_RenderClear(ren);
-    
-    // TODO: Rendre les éléments du menu
-}
+#define CONFIG_FILE "fanorona.cfg"
+#define AI_PLAYER   2 // L'IA joue les noirs
 
-static void render_game_scene(SDL_Renderer *ren) {
-    // Rendu spécifique au jeu
-    SDL_SetRenderDrawColor(ren, 20, 40, 20, 255);
-    SDL_RenderClear(ren);
-    
-    // TODO: Rendre les éléments du jeu
+static Scene *open_scene(Scene *s, GameWindow *win) {
+    s->init(s);
+    if (win) s->layout(s, win->width, win->height);
+    return s;
 }
 
 int main(int argc, char *argv[]) {
@@ -34,15 +30,41 @@ int main(int argc, char *argv[]) {
         printf("Warning: Audio initialization failed\n");
     }
     
+    Config cfg;
+    if (!config_load(&cfg, CONFIG_FILE)) {
+        config_set_defaults(&cfg);
+    }
+    
+    // La recherche tourne sur son propre thread pour ne pas bloquer le rendu
+    GameManager *gm = game_manager_create();
+    AIService *ai = ai_service_create(&cfg);
+    if (!ai) {
+        printf("Warning: AI service unavailable\n");
+    }
+    
+    // Chaque partie jouée est ajoutée au fichier d'enregistrement
+    RecordWriter *record = record_writer_open(cfg.record_file);
+    if (cfg.record_file[0] && !record) {
+        printf("Warning: cannot record games to %s\n", cfg.record_file);
+    }
+    game_manager_set_recorder(gm, record);
+    
     // Créer et afficher la fenêtre de menu
     core_switch_to_menu(&core);
     
+    // Chaque fenêtre garde son image : seules les zones modifiées sont redessinées
+    Scene *menu_scene = open_scene(menu_scene_create(), core.menu_window);
+    Scene *game_scene = NULL;
+    
     bool running = true;
     SDL_Event e;
     bool show_game = false; // Pour tester le changement de fenêtre
+    double last_frame = timer_now();
     
     while (running) {
         double frame_start = timer_now();
+        double dt = frame_start - last_frame;
+        last_frame = frame_start;
         
         while (SDL_PollEvent(&e)) {
             if (e.type == SDL_QUIT) {
@@ -52,25 +74,56 @@ int main(int argc, char *argv[]) {
                 show_game = !show_game;
                 if (show_game) {
                     core_switch_to_game(&core);
+                    if (!game_scene) game_scene = open_scene(game_scene_create(), core.game_window);
                 } else {
                     core_switch_to_menu(&core);
                 }
+            } else if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_u) {
+                game_manager_undo_move(gm);
             }
             
             // Gérer les événements de fenêtres
             if (!wm_handle_window_events(&core.wm, &e)) {
                 // Dispatcher les événements à la scène active
                 // TODO: Intégrer avec le layer manager
+                
+                // Textures perdues : chaque scène reconstruit les siennes au prochain rendu
+                if (e.type == SDL_RENDER_TARGETS_RESET || e.type == SDL_RENDER_DEVICE_RESET) {
+                    lm_dispatch(menu_scene->lm, &e);
+                    if (game_scene) lm_dispatch(game_scene->lm, &e);
+                }
+            }
+        }
+        
+        // Réseau : une passe non bloquante par image
+        p2p_update();
+        
+        if (show_game) {
+            game_manager_update_timers(gm, dt);
+            
+            // Abandonner une réflexion devenue inutile (annulation, temps écoulé)
+            ai_service_sync(ai, gm);
+            
+            SearchResult hint;
+            AIStatus status = ai_service_poll(ai, &hint);
+            if (status == AI_DONE && hint.has_move) {
+                game_manager_play_turn(gm, &hint.best);
+            } else if (status != AI_THINKING && !gm->game_over &&
+                       gm->state.current_player == AI_PLAYER) {
+                ai_service_request(ai, gm, cfg.ai_difficulty);
             }
+            // Meilleur coup trouvé jusqu'ici, tracé tant que l'IA réfléchit
+            bool thinking = status == AI_THINKING && hint.has_move;
+            game_scene_show_hint(game_scene, thinking ? &hint.best : NULL);
         }
         
-        // Rendre les fenêtres visibles
+        // Rendre les fenêtres visibles ; une fenêtre inchangée n'est pas présentée
         if (core.menu_window && core.menu_window->visible) {
-            wm_render_window(core.menu_window, render_menu_scene);
+            wm_render_layers(core.menu_window, menu_scene->lm);
         }
         
-        if (core.game_window && core.game_window->visible) {
-            wm_render_window(core.game_window, render_game_scene);
+        if (core.game_window && core.game_window->visible && game_scene) {
+            wm_render_layers(core.game_window, game_scene->lm);
         }
         
         // Cap at 60 FPS
@@ -80,6 +133,13 @@ int main(int argc, char *argv[]) {
         }
     }
     
+    p2p_disconnect();
+    // Les textures des scènes avant leurs renderers
+    menu_scene->cleanup(menu_scene);
+    if (game_scene) game_scene->cleanup(game_scene);
+    ai_service_destroy(ai);
+    game_manager_destroy(gm);
+    record_writer_close(record);
     audio_quit();
     core_quit(&core);
     return 0;
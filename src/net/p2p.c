@@ -1,38 +1,545 @@
+#define _POSIX_C_SOURCE 200112L
 #include "p2p.h"
+#include "../core/clock.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
 #include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
 
-static P2PStatus current_status = P2P_DISCONNECTED;
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
 
-bool p2p_host(unsigned short port, MoveRecv move_cb, StatusChanged status_cb) {
-    (void)port; (void)move_cb; (void)status_cb;
-    printf("P2P hosting not implemented yet\n");
-    return false;
+#define MAX_READS_PER_UPDATE 4 // recv() calls per p2p_update()
+#define TURN_FRAME(w)        (3 + 6 + (w)->size)
+#define SYNC_FRAME           (3 + 15)
+#define PENDING_TIMEOUT      5.0 // seconds a new connection has to introduce itself
+
+// The game as this end knows it: a snapshot and the turns played since
+typedef struct {
+    GameState base;
+    uint16_t  base_turns; // turns played before the snapshot
+    WireTurn  log[P2P_LOG_MAX];
+    int       count;
+    GameState position;   // after the whole log
+} Session;
+
+typedef struct {
+    int           listen_fd;  // host: open for the whole game, else -1
+    int           fd;         // connected or connecting socket, else -1
+    int           pending_fd; // host: accepted, not yet past HELLO and RESUME
+    ProtoRing     pending_rx;
+    double        pending_since;
+    bool          pending_hello;
+    bool          hosting;
+    P2PStatus     status;
+    TurnRecv      turn_cb;
+    StatusChanged status_cb;
+    ChatRecv      chat_cb;
+    SyncRecv      sync_cb;
+    struct sockaddr_storage addr; // joiner: where to reconnect
+    socklen_t     addr_len;
+    ProtoRing     rx;
+    ProtoOutbox   tx;
+    double        last_ping;
+    double        rtt;
+    Session       game;
+} Peer;
+
+static Peer peer = { .listen_fd = -1, .fd = -1, .pending_fd = -1 };
+
+static void set_status(P2PStatus status, const char *message) {
+    peer.status = status;
+    if (peer.status_cb) peer.status_cb(status, message);
+}
+
+static void close_link(void) {
+    if (peer.fd >= 0) close(peer.fd);
+    peer.fd = -1;
+    proto_ring_reset(&peer.rx);
+    peer.tx.length = 0;
+}
+
+static void close_pending(void) {
+    if (peer.pending_fd >= 0) close(peer.pending_fd);
+    peer.pending_fd = -1;
+}
+
+static void close_sockets(void) {
+    close_link();
+    close_pending();
+    if (peer.listen_fd >= 0) close(peer.listen_fd);
+    peer.listen_fd = -1;
+}
+
+static void fail(const char *message) {
+    close_sockets();
+    set_status(P2P_ERROR, message);
+}
+
+// The link is gone but the game is not: a host waits for its peer again
+static void link_lost(const char *message) {
+    close_link();
+    set_status(peer.listen_fd >= 0 ? P2P_CONNECTING : P2P_DISCONNECTED, message);
+}
+
+// The peer broke the protocol. A joiner gives up; a host only drops the
+// link, so whatever sent it cannot end the game for the real peer.
+static void bad_peer(const char *message) {
+    if (peer.hosting) link_lost(message);
+    else fail(message);
+}
+
+static bool set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+// Turns go out as soon as they are written rather than waiting for more
+static void set_nodelay(int fd) {
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+// ---------------------------------------------------------------------------
+// Session
+// ---------------------------------------------------------------------------
+
+static void session_reset(const GameState *start, uint16_t turns) {
+    peer.game.base = *start;
+    peer.game.base_turns = turns;
+    peer.game.count = 0;
+    peer.game.position = *start;
+}
+
+static uint16_t session_turns(void) {
+    return (uint16_t)(peer.game.base_turns + peer.game.count);
+}
+
+// Hash of the position after turn n, false when the log does not reach it
+static bool session_hash(uint16_t n, uint32_t *hash) {
+    int i = (int16_t)(n - peer.game.base_turns);
+    if (i < 0 || i > peer.game.count) return false;
+    *hash = i == 0 ? (uint32_t)peer.game.base.hash : peer.game.log[i - 1].hash;
+    return true;
+}
+
+static void session_push(const WireTurn *w, const Turn *t) {
+    Session *s = &peer.game;
+    if (s->count == P2P_LOG_MAX) session_reset(&s->position, session_turns());
+    s->log[s->count++] = *w;
+    game_apply_turn(&s->position, t);
+}
+
+// ---------------------------------------------------------------------------
+// Connecting
+// ---------------------------------------------------------------------------
+
+static void start(TurnRecv turn_cb, StatusChanged status_cb) {
+    close_sockets();
+    peer.turn_cb = turn_cb;
+    peer.status_cb = status_cb;
+    peer.rtt = 0.0;
+    GameState opening;
+    game_state_init(&opening);
+    session_reset(&opening, 0);
+}
+
+// Both ends introduce themselves as soon as the link is up, and the joiner
+// says where its game stands so the host can fill the gap in its reply
+static void connected(const char *message) {
+    peer.last_ping = clock_now();
+    proto_put_hello(&peer.tx);
+    if (!peer.hosting) {
+        proto_put_resume(&peer.tx, OP_RESUME, session_turns(), (uint32_t)peer.game.position.hash);
+    }
+    set_status(P2P_CONNECTED, message);
+}
+
+bool p2p_host(unsigned short port, TurnRecv turn_cb, StatusChanged status_cb) {
+    start(turn_cb, status_cb);
+    peer.hosting = true;
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        fail("socket() failed");
+        return false;
+    }
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (!set_nonblocking(fd) || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 1) != 0) {
+        close(fd);
+        fail("Cannot listen on that port");
+        return false;
+    }
+    peer.listen_fd = fd;
+    set_status(P2P_CONNECTING, "Waiting for a peer");
+    return true;
 }
 
-bool p2p_join(const char *ip, unsigned short port, MoveRecv move_cb, StatusChanged status_cb) {
-    (void)ip; (void)port; (void)move_cb; (void)status_cb;
-    printf("P2P join not implemented yet\n");
-    return false;
+static bool open_link(void) {
+    int fd = socket(peer.addr.ss_family, SOCK_STREAM, 0);
+    bool ok = fd >= 0 && set_nonblocking(fd);
+    if (ok && connect(fd, (struct sockaddr *)&peer.addr, peer.addr_len) != 0 && errno != EINPROGRESS) ok = false;
+    if (!ok) {
+        if (fd >= 0) close(fd);
+        set_status(P2P_ERROR, "Cannot connect");
+        return false;
+    }
+    set_nodelay(fd);
+    peer.fd = fd;
+    set_status(P2P_CONNECTING, "Connecting");
+    return true;
 }
 
-void p2p_send_move(int fx, int fy, int tx, int ty) {
-    (void)fx; (void)fy; (void)tx; (void)ty;
-    printf("P2P send move not implemented yet\n");
+bool p2p_join(const char *ip, unsigned short port, TurnRecv turn_cb, StatusChanged status_cb) {
+    start(turn_cb, status_cb);
+    peer.hosting = false;
+    peer.addr_len = 0;
+    if (!ip) {
+        fail("No address");
+        return false;
+    }
+
+    // Resolving a name may block; it happens once, before the game
+    char service[8];
+    snprintf(service, sizeof(service), "%u", (unsigned)port);
+    struct addrinfo hints, *res = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(ip, service, &hints, &res) != 0 || !res) {
+        fail("Unknown host");
+        return false;
+    }
+    memcpy(&peer.addr, res->ai_addr, res->ai_addrlen);
+    peer.addr_len = res->ai_addrlen;
+    freeaddrinfo(res);
+    return open_link();
+}
+
+bool p2p_reconnect(void) {
+    if (peer.hosting || peer.addr_len == 0) return false;
+    close_link();
+    return open_link();
+}
+
+void p2p_set_chat_callback(ChatRecv chat_cb) {
+    peer.chat_cb = chat_cb;
+}
+
+void p2p_set_sync_callback(SyncRecv sync_cb) {
+    peer.sync_cb = sync_cb;
+}
+
+// ---------------------------------------------------------------------------
+// Sending
+// ---------------------------------------------------------------------------
+
+// Called with what appending a message returned; flushed by p2p_update()
+static void queued(bool ok) {
+    if (!ok) link_lost("Peer is not reading");
+}
+
+static void send_sync(void) {
+    if (peer.status == P2P_CONNECTED) queued(proto_put_sync(&peer.tx, session_turns(), &peer.game.position));
+}
+
+void p2p_new_game(const GameState *start) {
+    if (!start) return;
+    session_reset(start, 0);
+    send_sync();
+}
+
+void p2p_send_turn(const Turn *t) {
+    if (!t) return;
+    WireTurn w;
+    proto_turn_pack(&w, &peer.game.position, t, session_turns());
+    session_push(&w, t);
+    if (peer.status == P2P_CONNECTED) queued(proto_put_turn(&peer.tx, &w));
 }
 
 void p2p_send_chat(const char *message) {
-    (void)message;
-    printf("P2P chat not implemented yet\n");
+    if (peer.status != P2P_CONNECTED || !message) return;
+    queued(proto_put_chat(&peer.tx, message));
+}
+
+double p2p_get_rtt(void) {
+    return peer.rtt;
 }
 
 P2PStatus p2p_get_status(void) {
-    return current_status;
+    return peer.status;
 }
 
 void p2p_disconnect(void) {
-    current_status = P2P_DISCONNECTED;
+    bool was_open = peer.fd >= 0 || peer.listen_fd >= 0;
+    close_sockets();
+    peer.status = P2P_DISCONNECTED;
+    if (was_open && peer.status_cb) peer.status_cb(P2P_DISCONNECTED, "Disconnected");
+}
+
+// ---------------------------------------------------------------------------
+// Receiving
+// ---------------------------------------------------------------------------
+
+static uint32_t now_ms(void) {
+    return (uint32_t)(clock_now() * 1000.0);
+}
+
+// The games disagree: the host sends its own, the joiner asks for it
+static void resync(void) {
+    if (peer.hosting) send_sync();
+    else if (peer.status == P2P_CONNECTED) queued(proto_put_sync_request(&peer.tx));
+}
+
+// Host: the joiner is at turn n with this hash. Sends the turns it lacks,
+// or our position when that is smaller or its game is not ours.
+static void answer_resume(uint16_t n, uint32_t hash) {
+    uint16_t turns = session_turns();
+    queued(proto_put_resume(&peer.tx, OP_RESUMED, turns, (uint32_t)peer.game.position.hash));
+
+    uint32_t ours;
+    if ((int16_t)(n - turns) > 0) return; // ahead of us; it sends what we lack
+    if (!session_hash(n, &ours) || ours != hash) {
+        send_sync();
+        return;
+    }
+    int first = n - peer.game.base_turns, bytes = 0;
+    for (int i = first; i < peer.game.count; i++) bytes += TURN_FRAME(&peer.game.log[i]);
+    if (bytes > SYNC_FRAME) {
+        send_sync();
+        return;
+    }
+    for (int i = first; i < peer.game.count && peer.fd >= 0; i++) queued(proto_put_turn(&peer.tx, &peer.game.log[i]));
+}
+
+// Joiner: the host is at turn n. Our turns after n were lost with the old
+// link and go out again; anything we lack is already on its way.
+static void resumed(uint16_t n, uint32_t hash) {
+    uint32_t ours;
+    if ((int16_t)(n - session_turns()) >= 0) return;
+    if (!session_hash(n, &ours) || ours != hash) {
+        resync();
+        return;
+    }
+    for (int i = n - peer.game.base_turns; i < peer.game.count && peer.fd >= 0; i++) {
+        queued(proto_put_turn(&peer.tx, &peer.game.log[i]));
+    }
+}
+
+static void receive_turn(const WireTurn *w) {
+    int16_t ahead = (int16_t)(w->seq - session_turns());
+    if (ahead < 0) return; // sent again on a resume, already played
+    Turn t;
+    if (ahead > 0 || !proto_turn_unpack(w, &peer.game.position, &t)) {
+        resync();
+        return;
+    }
+    session_push(w, &t);
+    if (peer.turn_cb) peer.turn_cb(&t);
+}
+
+static void handle_frame(const ProtoFrame *f) {
+    WireTurn w;
+    GameState g;
+    char text[P2P_CHAT_MAX + 1];
+    uint16_t seq;
+    uint32_t hash;
+    switch (f->opcode) {
+    case OP_HELLO:
+        if (f->size < 1 || proto_u8(f, 0) != PROTO_VERSION) bad_peer("Peer runs another version");
+        break;
+    case OP_TURN:
+        if (proto_read_turn(f, &w)) receive_turn(&w);
+        else bad_peer("Bad turn message");
+        break;
+    case OP_CHAT:
+        if (proto_read_chat(f, text, sizeof(text)) && peer.chat_cb) peer.chat_cb(text);
+        break;
+    case OP_SYNC_REQUEST:
+        if (peer.hosting) send_sync(); // only the host's game is authoritative
+        break;
+    case OP_SYNC:
+        if (peer.hosting) break; // the joiner never overrides the host
+        if (!proto_read_sync(f, &seq, &g)) {
+            bad_peer("Bad sync message");
+        } else {
+            session_reset(&g, seq);
+            if (peer.sync_cb) peer.sync_cb(&g, seq);
+        }
+        break;
+    case OP_RESUME:
+        if (peer.hosting && proto_read_resume(f, &seq, &hash)) answer_resume(seq, hash);
+        break;
+    case OP_RESUMED:
+        if (!peer.hosting && proto_read_resume(f, &seq, &hash)) resumed(seq, hash);
+        break;
+    case OP_PING:
+        if (f->size >= 4) queued(proto_put_ping(&peer.tx, OP_PONG, proto_u32(f, 0)));
+        break;
+    case OP_PONG:
+        if (f->size >= 4) peer.rtt = (double)(now_ms() - proto_u32(f, 0)) / 1000.0;
+        break;
+    default:
+        break; // from a newer peer
+    }
+}
+
+// Dispatches every complete frame, leaving a partial one in the ring
+static void parse_frames(void) {
+    ProtoFrame f;
+    int r;
+    while (peer.fd >= 0 && (r = proto_next_frame(&peer.rx, &f)) == 1) handle_frame(&f);
+    if (peer.fd >= 0 && r < 0) bad_peer("Bad message");
+}
+
+static void read_peer(void) {
+    for (int i = 0; i < MAX_READS_PER_UPDATE && peer.fd >= 0; i++) {
+        int room;
+        uint8_t *space = proto_ring_space(&peer.rx, &room);
+        if (room == 0) {
+            bad_peer("Message too long");
+            return;
+        }
+        ssize_t n = recv(peer.fd, space, (size_t)room, 0);
+        if (n == 0) {
+            link_lost("Peer left");
+            return;
+        }
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) return;
+            link_lost("Connection lost");
+            return;
+        }
+        proto_ring_commit(&peer.rx, (int)n);
+        parse_frames();
+    }
+}
+
+static void write_peer(void) {
+    if (peer.fd < 0 || peer.tx.length == 0) return;
+    ssize_t n = send(peer.fd, peer.tx.data, (size_t)peer.tx.length, MSG_NOSIGNAL);
+    if (n < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) link_lost("Connection lost");
+        return;
+    }
+    proto_outbox_sent(&peer.tx, (int)n);
+}
+
+// A host keeps listening: a peer coming back may arrive before its old
+// link is known to be dead. A new connection waits aside, a newer one
+// replacing it, until it has sent HELLO and RESUME.
+static void accept_peer(void) {
+    int fd = accept(peer.listen_fd, NULL, NULL);
+    if (fd < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) fail("accept() failed");
+        return;
+    }
+    if (!set_nonblocking(fd)) {
+        close(fd);
+        return;
+    }
+    set_nodelay(fd);
+    close_pending();
+    peer.pending_fd = fd;
+    peer.pending_since = clock_now();
+    peer.pending_hello = false;
+    proto_ring_reset(&peer.pending_rx);
+}
+
+// The pending connection becomes the link, replacing any live one, and
+// what it sent after RESUME is handled as from the peer
+static void promote_pending(uint16_t n, uint32_t hash) {
+    close_link();
+    peer.fd = peer.pending_fd;
+    peer.rx = peer.pending_rx;
+    peer.pending_fd = -1;
+    connected("Peer joined");
+    answer_resume(n, hash);
+    parse_frames();
+}
+
+// A pending connection must open with our HELLO and a RESUME; anything
+// else, or silence, closes it without touching the game
+static void read_pending(void) {
+    if (clock_now() - peer.pending_since > PENDING_TIMEOUT) {
+        close_pending();
+        return;
+    }
+    for (int i = 0; i < MAX_READS_PER_UPDATE && peer.pending_fd >= 0; i++) {
+        int room;
+        uint8_t *space = proto_ring_space(&peer.pending_rx, &room);
+        ssize_t n = room > 0 ? recv(peer.pending_fd, space, (size_t)room, 0) : 0;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) return;
+        if (n <= 0) {
+            close_pending();
+            return;
+        }
+        proto_ring_commit(&peer.pending_rx, (int)n);
+
+        ProtoFrame f;
+        int r;
+        uint16_t seq;
+        uint32_t hash;
+        while ((r = proto_next_frame(&peer.pending_rx, &f)) == 1) {
+            if (!peer.pending_hello && f.opcode == OP_HELLO && f.size >= 1 && proto_u8(&f, 0) == PROTO_VERSION) {
+                peer.pending_hello = true;
+            } else if (peer.pending_hello && f.opcode == OP_RESUME && proto_read_resume(&f, &seq, &hash)) {
+                promote_pending(seq, hash);
+                return;
+            } else {
+                break;
+            }
+        }
+        if (r != 0) {
+            close_pending();
+            return;
+        }
+    }
 }
 
 void p2p_update(void) {
-    // Network update loop
+    if (peer.listen_fd >= 0) accept_peer();
+    if (peer.pending_fd >= 0) read_pending();
+    if (peer.fd < 0) return;
+
+    if (peer.status == P2P_CONNECTED && clock_now() - peer.last_ping >= P2P_PING_EVERY) {
+        peer.last_ping = clock_now();
+        queued(proto_put_ping(&peer.tx, OP_PING, now_ms()));
+        if (peer.fd < 0) return;
+    }
+
+    struct pollfd pfd = { .fd = peer.fd, .events = POLLIN };
+    if (peer.status == P2P_CONNECTING || peer.tx.length > 0) pfd.events |= POLLOUT;
+    if (poll(&pfd, 1, 0) <= 0) return;
+
+    if (peer.status == P2P_CONNECTING) {
+        if (!(pfd.revents & (POLLOUT | POLLERR | POLLHUP))) return;
+        int err = 0;
+        socklen_t len = sizeof(err);
+        if (getsockopt(peer.fd, SOL_SOCKET, SO_ERROR, &err, &len) != 0 || err != 0) {
+            close_link();
+            set_status(P2P_ERROR, "Connection refused");
+            return;
+        }
+        connected("Connected");
+        return;
+    }
+
+    // Data that arrived before a hang-up is still read
+    if (pfd.revents & (POLLIN | POLLHUP | POLLERR)) read_peer();
+    if (pfd.revents & POLLOUT) write_peer();
 }
@@ -1,6 +1,27 @@
 #pragma once
+#include "protocol.h"
 #include <stdbool.h>
 
+// One TCP peer, driven from the main loop. Sockets are non-blocking and
+// p2p_update() never waits or allocates, so a slow or silent peer cannot
+// stall a frame. Messages use the binary frames of protocol.h: whatever is
+// sent during a frame leaves in a single write on the next p2p_update(),
+// and received frames are read straight from the receive ring.
+//
+// The game survives a dropped link. Both ends keep a snapshot of the
+// position and the turns played since, and follow the game themselves.
+// The joining side opens every connection with RESUME, giving its turn
+// count and position hash, and the host answers at once with the turns
+// it is missing or a snapshot, whichever is smaller. A host whose peer
+// leaves goes back to waiting for it; the joiner calls p2p_reconnect().
+// A new connection to the host only takes over once it has sent HELLO
+// and RESUME, and a bad frame costs the host its link, never the game.
+// Whenever the two games disagree, the host's position wins.
+#define P2P_BUFFER_SIZE PROTO_RING_SIZE // per direction; a peer that lets it fill is dropped
+#define P2P_CHAT_MAX    PROTO_CHAT_MAX
+#define P2P_PING_EVERY  1.0 // seconds between round-trip measurements
+#define P2P_LOG_MAX     512 // turns kept after the snapshot; older ones are folded into it
+
 typedef enum {
     P2P_DISCONNECTED,
     P2P_CONNECTING,
@@ -8,13 +29,20 @@ typedef enum {
     P2P_ERROR
 } P2PStatus;
 
-typedef void (*MoveRecv)(int from_x, int from_y, int to_x, int to_y);
+typedef void (*TurnRecv)(const Turn *turn); // the peer's turn, checked against our position
 typedef void (*StatusChanged)(P2PStatus status, const char *message);
+typedef void (*ChatRecv)(const char *message);
+typedef void (*SyncRecv)(const GameState *position, uint16_t turns); // the host's game, replacing ours
 
-bool p2p_host(unsigned short port, MoveRecv move_cb, StatusChanged status_cb);
-bool p2p_join(const char *ip, unsigned short port, MoveRecv move_cb, StatusChanged status_cb);
-void p2p_send_move(int fx, int fy, int tx, int ty);
+bool p2p_host(unsigned short port, TurnRecv turn_cb, StatusChanged status_cb); // waits for one peer
+bool p2p_join(const char *ip, unsigned short port, TurnRecv turn_cb, StatusChanged status_cb);
+bool p2p_reconnect(void); // joiner after a drop; the game carries on where the host has it
+void p2p_set_chat_callback(ChatRecv chat_cb);
+void p2p_set_sync_callback(SyncRecv sync_cb);
+void p2p_new_game(const GameState *start); // both games restart from start
+void p2p_send_turn(const Turn *t);         // a turn we played; kept for the peer while offline
 void p2p_send_chat(const char *message);
+double p2p_get_rtt(void); // seconds, 0 until measured
 P2PStatus p2p_get_status(void);
 void p2p_disconnect(void);
-void p2p_update(void); // Call in main loop
\ No newline at end of file
+void p2p_update(void); // Call in main loop
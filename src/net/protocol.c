@@ -0,0 +1,201 @@
+#include "protocol.h"
+#include "../engine/zobrist.h"
+#include <string.h>
+
+#define RING_MASK     (PROTO_RING_SIZE - 1)
+#define BITBOARD_SIZE 6 // 45 bits
+#define SYNC_SIZE     (2 + 2 * BITBOARD_SIZE + 1)
+
+// ---------------------------------------------------------------------------
+// Receiving
+// ---------------------------------------------------------------------------
+
+void proto_ring_reset(ProtoRing *r) {
+    r->head = r->tail = 0;
+}
+
+uint8_t *proto_ring_space(ProtoRing *r, int *room) {
+    uint32_t used = r->head - r->tail;
+    uint32_t at = r->head & RING_MASK;
+    uint32_t to_end = PROTO_RING_SIZE - at;
+    uint32_t free_bytes = PROTO_RING_SIZE - used;
+    *room = (int)(free_bytes < to_end ? free_bytes : to_end);
+    return r->data + at;
+}
+
+void proto_ring_commit(ProtoRing *r, int n) {
+    r->head += (uint32_t)n;
+}
+
+static uint8_t ring_byte(const ProtoRing *r, uint32_t at) {
+    return r->data[at & RING_MASK];
+}
+
+int proto_next_frame(ProtoRing *r, ProtoFrame *f) {
+    uint32_t used = r->head - r->tail;
+    if (used < 2) return 0;
+    int length = ring_byte(r, r->tail) | ring_byte(r, r->tail + 1) << 8;
+    if (length == 0 || length > PROTO_FRAME_MAX) return -1;
+    if (used < 2 + (uint32_t)length) return 0;
+
+    f->ring = r;
+    f->opcode = ring_byte(r, r->tail + 2);
+    f->start = r->tail + 3;
+    f->size = length - 1;
+    r->tail += 2 + (uint32_t)length;
+    return 1;
+}
+
+uint8_t proto_u8(const ProtoFrame *f, int at) {
+    return ring_byte(f->ring, f->start + (uint32_t)at);
+}
+
+uint16_t proto_u16(const ProtoFrame *f, int at) {
+    return (uint16_t)(proto_u8(f, at) | proto_u8(f, at + 1) << 8);
+}
+
+uint32_t proto_u32(const ProtoFrame *f, int at) {
+    return (uint32_t)proto_u16(f, at) | (uint32_t)proto_u16(f, at + 2) << 16;
+}
+
+bool proto_read_turn(const ProtoFrame *f, WireTurn *w) {
+    if (f->size < 8) return false;
+    w->seq = proto_u16(f, 0);
+    w->hash = proto_u32(f, 2);
+    uint8_t second = proto_u8(f, 7);
+    int size = record_turn_size(second);
+    if (size > RECORD_TURN_MAX || f->size != 6 + size) return false;
+    for (int i = 0; i < size; i++) w->bytes[i] = proto_u8(f, 6 + i);
+    w->size = (uint8_t)size;
+    return true;
+}
+
+bool proto_read_chat(const ProtoFrame *f, char *text, int max) {
+    if (max <= 0) return false;
+    int n = f->size < max - 1 ? f->size : max - 1;
+    for (int i = 0; i < n; i++) text[i] = (char)proto_u8(f, i);
+    text[n] = '\0';
+    return true;
+}
+
+bool proto_read_sync(const ProtoFrame *f, uint16_t *seq, GameState *g) {
+    if (f->size != SYNC_SIZE) return false;
+    GameState s;
+    memset(&s, 0, sizeof(s));
+    for (int side = 0; side < 2; side++) {
+        for (int i = 0; i < BITBOARD_SIZE; i++) {
+            s.pieces[side] |= (Bitboard)proto_u8(f, 2 + side * BITBOARD_SIZE + i) << (8 * i);
+        }
+    }
+    s.current_player = proto_u8(f, SYNC_SIZE - 1);
+    Bitboard w = s.pieces[0], b = s.pieces[1];
+    if ((s.current_player != 1 && s.current_player != 2) || (w & b) || ((w | b) & ~BOARD_ALL)) return false;
+    s.hash = zobrist_compute(&s);
+    *seq = proto_u16(f, 0);
+    *g = s;
+    return true;
+}
+
+bool proto_read_resume(const ProtoFrame *f, uint16_t *turns, uint32_t *hash) {
+    if (f->size < 6) return false;
+    *turns = proto_u16(f, 0);
+    *hash = proto_u32(f, 2);
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Sending
+// ---------------------------------------------------------------------------
+
+static bool put_frame(ProtoOutbox *o, int opcode, const uint8_t *payload, int size) {
+    if (o->length + 3 + size > PROTO_RING_SIZE) return false;
+    uint8_t *p = o->data + o->length;
+    p[0] = (uint8_t)(size + 1);
+    p[1] = (uint8_t)((size + 1) >> 8);
+    p[2] = (uint8_t)opcode;
+    if (size) memcpy(p + 3, payload, (size_t)size);
+    o->length += 3 + size;
+    return true;
+}
+
+bool proto_put_hello(ProtoOutbox *o) {
+    uint8_t version = PROTO_VERSION;
+    return put_frame(o, OP_HELLO, &version, 1);
+}
+
+bool proto_put_turn(ProtoOutbox *o, const WireTurn *w) {
+    uint8_t b[6 + RECORD_TURN_MAX];
+    b[0] = (uint8_t)w->seq;
+    b[1] = (uint8_t)(w->seq >> 8);
+    for (int i = 0; i < 4; i++) b[2 + i] = (uint8_t)(w->hash >> (8 * i));
+    memcpy(b + 6, w->bytes, w->size);
+    return put_frame(o, OP_TURN, b, 6 + w->size);
+}
+
+bool proto_put_chat(ProtoOutbox *o, const char *text) {
+    size_t n = strlen(text);
+    if (n > PROTO_CHAT_MAX) n = PROTO_CHAT_MAX;
+    return put_frame(o, OP_CHAT, (const uint8_t *)text, (int)n);
+}
+
+bool proto_put_sync_request(ProtoOutbox *o) {
+    return put_frame(o, OP_SYNC_REQUEST, NULL, 0);
+}
+
+bool proto_put_sync(ProtoOutbox *o, uint16_t seq, const GameState *g) {
+    uint8_t b[SYNC_SIZE];
+    b[0] = (uint8_t)seq;
+    b[1] = (uint8_t)(seq >> 8);
+    for (int side = 0; side < 2; side++) {
+        for (int i = 0; i < BITBOARD_SIZE; i++) {
+            b[2 + side * BITBOARD_SIZE + i] = (uint8_t)(g->pieces[side] >> (8 * i));
+        }
+    }
+    b[SYNC_SIZE - 1] = (uint8_t)g->current_player;
+    return put_frame(o, OP_SYNC, b, SYNC_SIZE);
+}
+
+bool proto_put_ping(ProtoOutbox *o, int opcode, uint32_t token) {
+    uint8_t b[4] = { (uint8_t)token, (uint8_t)(token >> 8), (uint8_t)(token >> 16), (uint8_t)(token >> 24) };
+    return put_frame(o, opcode, b, 4);
+}
+
+bool proto_put_start(ProtoOutbox *o, int side, uint32_t clock_ms) {
+    uint8_t b[5] = { (uint8_t)side, (uint8_t)clock_ms, (uint8_t)(clock_ms >> 8),
+                     (uint8_t)(clock_ms >> 16), (uint8_t)(clock_ms >> 24) };
+    return put_frame(o, OP_START, b, 5);
+}
+
+bool proto_put_result(ProtoOutbox *o, int winner, ProtoEnd reason) {
+    uint8_t b[2] = { (uint8_t)winner, (uint8_t)reason };
+    return put_frame(o, OP_RESULT, b, 2);
+}
+
+bool proto_put_resume(ProtoOutbox *o, int opcode, uint16_t turns, uint32_t hash) {
+    uint8_t b[6] = { (uint8_t)turns, (uint8_t)(turns >> 8), (uint8_t)hash, (uint8_t)(hash >> 8),
+                     (uint8_t)(hash >> 16), (uint8_t)(hash >> 24) };
+    return put_frame(o, opcode, b, 6);
+}
+
+void proto_outbox_sent(ProtoOutbox *o, int n) {
+    o->length -= n;
+    memmove(o->data, o->data + n, (size_t)o->length);
+}
+
+// ---------------------------------------------------------------------------
+// Turns
+// ---------------------------------------------------------------------------
+
+void proto_turn_pack(WireTurn *w, const GameState *before, const Turn *t, uint16_t seq) {
+    GameState after = *before;
+    game_apply_turn(&after, t);
+    w->seq = seq;
+    w->hash = (uint32_t)after.hash;
+    w->size = (uint8_t)record_encode_turn(t, w->bytes);
+}
+
+bool proto_turn_unpack(const WireTurn *w, const GameState *before, Turn *t) {
+    if (w->size < 2 || w->size != record_turn_size(w->bytes[1])) return false;
+    GameState after = *before;
+    return record_decode_turn(&after, w->bytes, t) && (uint32_t)after.hash == w->hash;
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include "../engine/record.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Wire format shared by the P2P layer and the match server. Every message
+// is a frame: a little-endian u16 length, then that many bytes, the first
+// being the opcode. Receivers skip opcodes they do not know, so a newer
+// peer may add messages without breaking an older one.
+//
+//   HELLO         u8 version
+//   TURN          u16 seq, u32 hash, turn in the record encoding (2-13 bytes)
+//   CHAT          UTF-8 text, not terminated
+//   SYNC_REQUEST  (empty)
+//   SYNC          u16 seq, white and black as 6-byte bitboards, u8 side
+//   PING, PONG    u32 token, echoed back
+//   START         u8 side (1 white, 2 black), u32 clock per player in ms
+//   RESULT        u8 winner (0 draw, 1 white, 2 black), u8 ProtoEnd reason
+//   RESUME        u16 turns played, u32 hash of the position after them
+//   RESUMED       the same, answering a RESUME
+//
+// seq is the number of turns played before this one in the game, so gaps
+// and repeats show; hash is the low half of the position hash after the
+// turn, so both ends notice when their games drift apart. SYNC carries the
+// turn count of its position. START and RESULT come from the match server:
+// a client says HELLO to join its queue, and again after a RESULT for
+// another game. RESUME and RESUMED pick a P2P game up after a reconnect.
+#define PROTO_VERSION    1
+#define PROTO_RING_SIZE  8192 // power of two
+#define PROTO_FRAME_MAX  512  // longer frames are a protocol error
+#define PROTO_CHAT_MAX   256
+
+enum {
+    OP_HELLO = 1,
+    OP_TURN,
+    OP_CHAT,
+    OP_SYNC_REQUEST,
+    OP_SYNC,
+    OP_PING,
+    OP_PONG,
+    OP_START,
+    OP_RESULT,
+    OP_RESUME,
+    OP_RESUMED
+};
+
+typedef enum {
+    END_RULES,      // no stones or no move left
+    END_TIME,       // the side to move ran out of time
+    END_ABANDON,    // the other player left
+    END_TURN_LIMIT  // drawn after the server's turn limit
+} ProtoEnd;
+
+// Received bytes. head and tail run freely and are masked on access, so
+// the ring never needs compacting and frames are parsed in place.
+typedef struct {
+    uint8_t  data[PROTO_RING_SIZE];
+    uint32_t head, tail; // write and read positions
+} ProtoRing;
+
+// A frame still in the ring, possibly wrapping around its end. Valid until
+// the ring is written again.
+typedef struct {
+    const ProtoRing *ring;
+    uint32_t         start; // first byte after the opcode
+    int              opcode;
+    int              size;  // payload bytes
+} ProtoFrame;
+
+// Bytes waiting to be written. Messages are appended during a frame and
+// leave together in one send().
+typedef struct {
+    uint8_t data[PROTO_RING_SIZE];
+    int     length;
+} ProtoOutbox;
+
+typedef struct {
+    uint16_t seq;
+    uint32_t hash;
+    uint8_t  size;
+    uint8_t  bytes[RECORD_TURN_MAX];
+} WireTurn;
+
+void     proto_ring_reset(ProtoRing *r);
+uint8_t *proto_ring_space(ProtoRing *r, int *room); // contiguous free bytes for recv()
+void     proto_ring_commit(ProtoRing *r, int n);
+// 1 = frame read and consumed, 0 = incomplete, -1 = malformed stream
+int      proto_next_frame(ProtoRing *r, ProtoFrame *f);
+
+uint8_t  proto_u8(const ProtoFrame *f, int at);
+uint16_t proto_u16(const ProtoFrame *f, int at);
+uint32_t proto_u32(const ProtoFrame *f, int at);
+
+// Appending fails, leaving the outbox as it was, when the frame does not fit
+bool proto_put_hello(ProtoOutbox *o);
+bool proto_put_turn(ProtoOutbox *o, const WireTurn *w);
+bool proto_put_chat(ProtoOutbox *o, const char *text);
+bool proto_put_sync_request(ProtoOutbox *o);
+bool proto_put_sync(ProtoOutbox *o, uint16_t seq, const GameState *g);
+bool proto_put_ping(ProtoOutbox *o, int opcode, uint32_t token); // OP_PING or OP_PONG
+bool proto_put_start(ProtoOutbox *o, int side, uint32_t clock_ms);
+bool proto_put_result(ProtoOutbox *o, int winner, ProtoEnd reason);
+bool proto_put_resume(ProtoOutbox *o, int opcode, uint16_t turns, uint32_t hash); // OP_RESUME or OP_RESUMED
+void proto_outbox_sent(ProtoOutbox *o, int n); // drops n written bytes
+
+// Payload readers; false when the frame is too short or out of range
+bool proto_read_turn(const ProtoFrame *f, WireTurn *w);
+bool proto_read_chat(const ProtoFrame *f, char *text, int max); // NUL-terminated, cut to max - 1
+bool proto_read_sync(const ProtoFrame *f, uint16_t *seq, GameState *g);
+bool proto_read_resume(const ProtoFrame *f, uint16_t *turns, uint32_t *hash);
+
+// A turn played from before, packed with its sequence number
+void proto_turn_pack(WireTurn *w, const GameState *before, const Turn *t, uint16_t seq);
+// Decodes w against the position before it. False when the bytes do not
+// describe a turn from there or lead to a position with another hash.
+bool proto_turn_unpack(const WireTurn *w, const GameState *before, Turn *t);
@@ -0,0 +1,465 @@
+#define _POSIX_C_SOURCE 200112L
+#include "server.h"
+#include "../core/clock.h"
+#include "../engine/game_state.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#define MAX_EVENTS           256
+#define MAX_READS_PER_EVENT  4
+
+typedef struct Match Match;
+
+typedef struct Client {
+    int            fd;
+    bool           dirty;         // in Server.dirty, flushed at the end of this poll
+    bool           dead;          // closed, freed at the end of this poll
+    bool           want_out;      // EPOLLOUT armed for a send that did not finish
+    Match         *match;
+    int            side;          // 1 or 2 in a match
+    double         pending_since; // arrival of the oldest turn waiting in tx
+    int            pending_turns;
+    struct Client *prev, *next;
+    ProtoRing      rx;
+    ProtoOutbox    tx;
+} Client;
+
+struct Match {
+    GameManager *gm;
+    Client      *players[2];
+    double       last_tick;
+    int          index; // in Server.matches
+    bool         over;  // ended, freed at the end of this poll
+    int          winner;
+    ProtoEnd     reason;
+    MatchStats   stats;
+};
+
+// Pointers collected during a poll, handled once its events are done
+typedef struct {
+    void **items;
+    int    count, capacity;
+} PtrList;
+
+struct Server {
+    int            epfd, listen_fd;
+    double         clock_seconds;
+    int            max_turns;
+    double         now;      // when the current poll's events arrived
+    Client        *clients;  // every open client
+    Client        *waiting;  // said HELLO, no opponent yet
+    Match        **matches;
+    int            match_count, match_capacity;
+    PtrList        dirty, dead, finished, spare; // spare: GameManagers to reuse
+    uint64_t       next_id;
+    ServerStats    totals;
+    MatchFinished  finish_cb;
+    void          *finish_user;
+};
+
+static bool list_push(PtrList *l, void *p) {
+    if (l->count == l->capacity) {
+        int capacity = l->capacity ? l->capacity * 2 : 64;
+        void **items = realloc(l->items, (size_t)capacity * sizeof(void *));
+        if (!items) return false;
+        l->items = items;
+        l->capacity = capacity;
+    }
+    l->items[l->count++] = p;
+    return true;
+}
+
+static bool set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+Server *server_create(unsigned short port, double clock_seconds, int max_turns) {
+    Server *s = calloc(1, sizeof(Server));
+    if (!s) return NULL;
+    s->clock_seconds = clock_seconds;
+    s->max_turns = max_turns;
+    s->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    s->epfd = epoll_create1(0);
+    if (s->listen_fd < 0 || s->epfd < 0) {
+        server_destroy(s);
+        return NULL;
+    }
+    int one = 1;
+    setsockopt(s->listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = NULL };
+    if (!set_nonblocking(s->listen_fd) || bind(s->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(s->listen_fd, SOMAXCONN) != 0 || epoll_ctl(s->epfd, EPOLL_CTL_ADD, s->listen_fd, &ev) != 0) {
+        server_destroy(s);
+        return NULL;
+    }
+    return s;
+}
+
+void server_destroy(Server *s) {
+    if (!s) return;
+    while (s->clients) {
+        Client *c = s->clients;
+        s->clients = c->next;
+        if (c->fd >= 0) close(c->fd);
+        free(c);
+    }
+    for (int i = 0; i < s->match_count; i++) {
+        game_manager_destroy(s->matches[i]->gm);
+        free(s->matches[i]);
+    }
+    for (int i = 0; i < s->finished.count; i++) {
+        Match *m = s->finished.items[i];
+        game_manager_destroy(m->gm);
+        free(m);
+    }
+    for (int i = 0; i < s->spare.count; i++) game_manager_destroy(s->spare.items[i]);
+    for (int i = 0; i < s->dead.count; i++) free(s->dead.items[i]);
+    free(s->matches);
+    free(s->dirty.items);
+    free(s->dead.items);
+    free(s->finished.items);
+    free(s->spare.items);
+    if (s->listen_fd >= 0) close(s->listen_fd);
+    if (s->epfd >= 0) close(s->epfd);
+    free(s);
+}
+
+void server_set_finish_callback(Server *s, MatchFinished cb, void *user) {
+    s->finish_cb = cb;
+    s->finish_user = user;
+}
+
+void server_get_stats(const Server *s, ServerStats *out) {
+    *out = s->totals;
+    out->waiting = s->waiting != NULL;
+    out->matches = s->match_count;
+}
+
+// ---------------------------------------------------------------------------
+// Matches
+// ---------------------------------------------------------------------------
+
+static void drop_client(Server *s, Client *c);
+
+// Called with what appending a message returned; a client that lets its
+// buffer fill is not reading and is dropped
+static void queued(Server *s, Client *c, bool ok) {
+    if (!ok) {
+        drop_client(s, c);
+    } else if (!c->dirty) {
+        c->dirty = list_push(&s->dirty, c);
+    }
+}
+
+static void finish_match(Server *s, Match *m, int winner, ProtoEnd reason) {
+    if (m->over) return;
+    m->over = true;
+    m->winner = winner;
+    m->reason = reason;
+    m->stats.ended = s->now;
+    list_push(&s->finished, m);
+    for (int i = 0; i < 2; i++) {
+        Client *p = m->players[i];
+        if (p && !p->dead) queued(s, p, proto_put_result(&p->tx, winner, reason));
+    }
+}
+
+static bool start_match(Server *s, Client *white, Client *black) {
+    if (s->match_count == s->match_capacity) {
+        int capacity = s->match_capacity ? s->match_capacity * 2 : 256;
+        Match **matches = realloc(s->matches, (size_t)capacity * sizeof(Match *));
+        if (!matches) return false;
+        s->matches = matches;
+        s->match_capacity = capacity;
+    }
+    Match *m = calloc(1, sizeof(Match));
+    GameManager *gm = s->spare.count ? s->spare.items[--s->spare.count] : game_manager_create();
+    if (!m || !gm) {
+        free(m);
+        game_manager_destroy(gm);
+        return false;
+    }
+    gm->time_per_player[0] = gm->time_per_player[1] = s->clock_seconds;
+    game_manager_reset(gm);
+    m->gm = gm;
+    m->last_tick = s->now;
+    m->index = s->match_count;
+    m->stats.id = ++s->next_id;
+    m->stats.started = s->now;
+    s->matches[s->match_count++] = m;
+
+    uint32_t clock_ms = (uint32_t)(s->clock_seconds * 1000.0);
+    Client *players[2] = { white, black };
+    for (int i = 0; i < 2; i++) {
+        Client *p = players[i];
+        m->players[i] = p;
+        p->match = m;
+        p->side = i + 1;
+        queued(s, p, proto_put_start(&p->tx, p->side, clock_ms));
+    }
+    return true;
+}
+
+// Runs the clock of the side to move up to now
+static void tick(Server *s, Match *m) {
+    if (m->over) return;
+    game_manager_update_timers(m->gm, s->now - m->last_tick);
+    m->last_tick = s->now;
+    if (m->gm->game_over) finish_match(s, m, m->gm->winner, END_TIME);
+}
+
+static void detach(Client *c) {
+    if (!c->match) return;
+    c->match->players[c->side - 1] = NULL;
+    c->match = NULL;
+}
+
+static void join_queue(Server *s, Client *c) {
+    if (c->match && !c->match->over) return; // already playing
+    detach(c);
+    if (s->waiting == c) return;
+    if (!s->waiting) {
+        s->waiting = c;
+        return;
+    }
+    Client *white = s->waiting;
+    s->waiting = NULL;
+    if (!start_match(s, white, c)) {
+        drop_client(s, white);
+        drop_client(s, c);
+    }
+}
+
+static void play_turn(Server *s, Client *c, const ProtoFrame *f) {
+    WireTurn w;
+    if (!proto_read_turn(f, &w)) {
+        drop_client(s, c);
+        return;
+    }
+    Match *m = c->match;
+    if (!m) return;
+    tick(s, m);
+    if (m->over) return; // arrived after the end
+
+    GameManager *gm = m->gm;
+    uint16_t played = (uint16_t)gm->history.count;
+    if ((int16_t)(w.seq - played) < 0) return; // sent again, already played
+    Turn t;
+    if (w.seq != played || gm->state.current_player != c->side || !proto_turn_unpack(&w, &gm->state, &t) ||
+        !game_manager_play_turn(gm, &t)) {
+        m->stats.rejected++;
+        s->totals.rejected++;
+        queued(s, c, proto_put_sync(&c->tx, played, &gm->state));
+        return;
+    }
+    m->stats.turns++;
+    s->totals.turns++;
+
+    Client *o = m->players[2 - c->side];
+    if (o) {
+        if (o->pending_turns++ == 0) o->pending_since = s->now;
+        queued(s, o, proto_put_turn(&o->tx, &w));
+    }
+    if (gm->game_over) {
+        finish_match(s, m, gm->winner, END_RULES);
+    } else if (s->max_turns > 0 && gm->history.count >= s->max_turns) {
+        finish_match(s, m, 0, END_TURN_LIMIT);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Clients
+// ---------------------------------------------------------------------------
+
+static void drop_client(Server *s, Client *c) {
+    if (c->dead) return;
+    c->dead = true;
+    close(c->fd); // also leaves the epoll set
+    c->fd = -1;
+    if (s->waiting == c) s->waiting = NULL;
+    Match *m = c->match;
+    if (m) {
+        detach(c);
+        finish_match(s, m, 3 - c->side, END_ABANDON);
+    }
+    if (c->prev) c->prev->next = c->next;
+    else s->clients = c->next;
+    if (c->next) c->next->prev = c->prev;
+    s->totals.clients--;
+    if (!list_push(&s->dead, c)) free(c);
+}
+
+static void handle_frame(Server *s, Client *c, const ProtoFrame *f) {
+    char text[PROTO_CHAT_MAX + 1];
+    Match *m = c->match;
+    Client *o = m && !m->over ? m->players[2 - c->side] : NULL;
+    switch (f->opcode) {
+    case OP_HELLO:
+        if (f->size < 1 || proto_u8(f, 0) != PROTO_VERSION) drop_client(s, c);
+        else join_queue(s, c);
+        break;
+    case OP_TURN:
+        play_turn(s, c, f);
+        break;
+    case OP_CHAT:
+        if (o && proto_read_chat(f, text, sizeof(text))) queued(s, o, proto_put_chat(&o->tx, text));
+        break;
+    case OP_SYNC_REQUEST:
+        if (m && !m->over) queued(s, c, proto_put_sync(&c->tx, (uint16_t)m->gm->history.count, &m->gm->state));
+        break;
+    case OP_PING:
+        if (f->size >= 4) queued(s, c, proto_put_ping(&c->tx, OP_PONG, proto_u32(f, 0)));
+        break;
+    default:
+        break; // not for the server
+    }
+}
+
+static void read_client(Server *s, Client *c) {
+    for (int i = 0; i < MAX_READS_PER_EVENT && !c->dead; i++) {
+        int room;
+        uint8_t *space = proto_ring_space(&c->rx, &room);
+        if (room == 0) {
+            drop_client(s, c);
+            return;
+        }
+        ssize_t n = recv(c->fd, space, (size_t)room, 0);
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            drop_client(s, c);
+            return;
+        }
+        if (n < 0) return;
+        proto_ring_commit(&c->rx, (int)n);
+        s->totals.bytes_in += (uint64_t)n;
+        if (c->match) c->match->stats.bytes_in += (uint64_t)n;
+
+        ProtoFrame f;
+        int r;
+        while (!c->dead && (r = proto_next_frame(&c->rx, &f)) == 1) handle_frame(s, c, &f);
+        if (!c->dead && r < 0) drop_client(s, c);
+    }
+}
+
+static void accept_clients(Server *s) {
+    for (;;) {
+        int fd = accept(s->listen_fd, NULL, NULL);
+        if (fd < 0) return; // EAGAIN, or out of descriptors until some close
+        Client *c = s->totals.clients < SERVER_MAX_CLIENTS ? malloc(sizeof(Client)) : NULL;
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = c };
+        if (!c || !set_nonblocking(fd) || epoll_ctl(s->epfd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            free(c);
+            close(fd);
+            continue;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        memset(c, 0, offsetof(Client, rx)); // the buffers need no clearing
+        proto_ring_reset(&c->rx);
+        c->tx.length = 0;
+        c->fd = fd;
+        c->next = s->clients;
+        if (s->clients) s->clients->prev = c;
+        s->clients = c;
+        s->totals.clients++;
+    }
+}
+
+// One send() per client per poll, whatever was queued for it
+static void flush_clients(Server *s) {
+    double now = clock_now();
+    for (int i = 0; i < s->dirty.count; i++) {
+        Client *c = s->dirty.items[i];
+        c->dirty = false;
+        if (c->dead || c->tx.length == 0) continue;
+
+        ssize_t n = send(c->fd, c->tx.data, (size_t)c->tx.length, MSG_NOSIGNAL);
+        if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            drop_client(s, c);
+            continue;
+        }
+        if (n > 0) {
+            proto_outbox_sent(&c->tx, (int)n);
+            s->totals.bytes_out += (uint64_t)n;
+            if (c->match) c->match->stats.bytes_out += (uint64_t)n;
+        }
+        if (c->tx.length == 0 && c->pending_turns) {
+            double latency = now - c->pending_since;
+            s->totals.latency_sum += latency * c->pending_turns;
+            if (latency > s->totals.latency_max) s->totals.latency_max = latency;
+            if (c->match) {
+                c->match->stats.latency_sum += latency * c->pending_turns;
+                if (latency > c->match->stats.latency_max) c->match->stats.latency_max = latency;
+            }
+            c->pending_turns = 0;
+        }
+        // Wait for room only while something is left over
+        bool want_out = c->tx.length > 0;
+        if (want_out != c->want_out) {
+            struct epoll_event ev = { .events = EPOLLIN | (want_out ? EPOLLOUT : 0), .data.ptr = c };
+            epoll_ctl(s->epfd, EPOLL_CTL_MOD, c->fd, &ev);
+            c->want_out = want_out;
+        }
+    }
+    s->dirty.count = 0;
+}
+
+// Ended matches and closed clients, once nothing refers to them any more
+static void reap(Server *s) {
+    for (int i = 0; i < s->finished.count; i++) {
+        Match *m = s->finished.items[i];
+        if (s->finish_cb) s->finish_cb(&m->stats, m->winner, m->reason, s->finish_user);
+        for (int k = 0; k < 2; k++) {
+            if (m->players[k]) m->players[k]->match = NULL;
+        }
+        Match *last = s->matches[--s->match_count];
+        s->matches[m->index] = last;
+        last->index = m->index;
+        s->totals.matches_finished++;
+        if (!list_push(&s->spare, m->gm)) game_manager_destroy(m->gm);
+        free(m);
+    }
+    s->finished.count = 0;
+    for (int i = 0; i < s->dead.count; i++) free(s->dead.items[i]);
+    s->dead.count = 0;
+}
+
+bool server_poll(Server *s, int timeout_ms) {
+    struct epoll_event events[MAX_EVENTS];
+    int n = epoll_wait(s->epfd, events, MAX_EVENTS, timeout_ms);
+    if (n < 0) return errno == EINTR;
+    s->now = clock_now();
+
+    for (int i = 0; i < n; i++) {
+        Client *c = events[i].data.ptr;
+        if (!c) {
+            accept_clients(s);
+            continue;
+        }
+        if (c->dead) continue;
+        if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) read_client(s, c);
+        if (!c->dead && (events[i].events & EPOLLOUT)) queued(s, c, true);
+    }
+    for (int i = 0; i < s->match_count; i++) tick(s, s->matches[i]);
+    flush_clients(s);
+    reap(s);
+    return true;
+}
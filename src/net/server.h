@@ -0,0 +1,44 @@
+#pragma once
+#include "protocol.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Headless match server (Linux, epoll). Clients say HELLO and are paired
+// in arrival order; each pair plays one game held in its own GameManager.
+// Every turn is checked against the engine before it is passed on, and the
+// clocks run on the server: a side whose time runs out loses. A client
+// whose turn is refused gets the server's position back as a SYNC.
+//
+// One thread does everything. server_poll() waits for events, handles
+// them, runs the clocks, then writes each client's queued messages in a
+// single send().
+#define SERVER_MAX_CLIENTS 65536
+
+typedef struct {
+    uint64_t id;
+    int      turns;
+    int      rejected;        // turns refused by the engine
+    uint64_t bytes_in, bytes_out;
+    double   started, ended;  // clock_now() seconds
+    double   latency_sum;     // seconds from a turn's arrival until it was sent on
+    double   latency_max;
+} MatchStats;
+
+typedef struct {
+    int      clients, waiting, matches; // now
+    uint64_t matches_finished, turns, rejected;
+    uint64_t bytes_in, bytes_out;
+    double   latency_sum, latency_max;  // over every turn passed on so far
+} ServerStats;
+
+typedef struct Server Server;
+
+// Called as each game ends, before its clients are told
+typedef void (*MatchFinished)(const MatchStats *stats, int winner, ProtoEnd reason, void *user);
+
+// clock_seconds per player; max_turns 0 for no limit
+Server *server_create(unsigned short port, double clock_seconds, int max_turns);
+void    server_destroy(Server *s);
+void    server_set_finish_callback(Server *s, MatchFinished cb, void *user);
+bool    server_poll(Server *s, int timeout_ms); // false when epoll fails
+void    server_get_stats(const Server *s, ServerStats *out);
@@ -1,17 +1,110 @@
 #include "scene.h"
 #include "../layer/layer.h"
+#include "../engine/fanorona.h"
 #include <SDL2/SDL.h>
 #include <stdlib.h>
+#include <string.h>
+
+static void game_background(Layer *self, SDL_Renderer *ren) {
+    (void)self;
+    SDL_SetRenderDrawColor(ren, 20, 40, 20, 255);
+    SDL_RenderFillRect(ren, NULL);
+}
+
+#define BOARD_MARGIN 16
+
+// Une seule scène de jeu : l'indice affiché vit ici
+static Turn hint;
+static bool hint_shown;
+
+// Intersection (x, y) du plateau dessiné dans r
+static SDL_Point board_point(const SDL_Rect *r, int x, int y) {
+    int step_x = (r->w - 2 * BOARD_MARGIN) / (BOARD_W - 1);
+    int step_y = (r->h - 2 * BOARD_MARGIN) / (BOARD_H - 1);
+    SDL_Point p = { r->x + BOARD_MARGIN + x * step_x, r->y + BOARD_MARGIN + y * step_y };
+    return p;
+}
+
+// Les lignes du plateau ne changent jamais : dessinées une fois dans la
+// texture de la couche, puis recopiées
+static void board_render(Layer *self, SDL_Renderer *ren) {
+    const SDL_Rect *r = &self->rect;
+    SDL_Point origin = board_point(r, 0, 0), next = board_point(r, 1, 1);
+    int step_x = next.x - origin.x, step_y = next.y - origin.y;
+    int x0 = origin.x, y0 = origin.y;
+
+    SDL_SetRenderDrawColor(ren, 150, 110, 60, 255);
+    SDL_RenderFillRect(ren, r);
+    SDL_SetRenderDrawColor(ren, 40, 25, 10, 255);
+    for (int y = 0; y < BOARD_H; y++) {
+        SDL_RenderDrawLine(ren, x0, y0 + y * step_y, x0 + (BOARD_W - 1) * step_x, y0 + y * step_y);
+    }
+    for (int x = 0; x < BOARD_W; x++) {
+        SDL_RenderDrawLine(ren, x0 + x * step_x, y0, x0 + x * step_x, y0 + (BOARD_H - 1) * step_y);
+    }
+    // Diagonales partant des points forts (x + y pair)
+    for (int y = 0; y < BOARD_H - 1; y++) {
+        for (int x = 0; x < BOARD_W - 1; x++) {
+            int ax = x0 + x * step_x, ay = y0 + y * step_y;
+            if ((x + y) % 2 == 0) SDL_RenderDrawLine(ren, ax, ay, ax + step_x, ay + step_y);
+            else SDL_RenderDrawLine(ren, ax + step_x, ay, ax, ay + step_y);
+        }
+    }
+}
+
+// Chemin du tour proposé, départ et arrivée marqués
+static void hint_render(Layer *self, SDL_Renderer *ren) {
+    if (!hint_shown) return;
+    SDL_SetRenderDrawColor(ren, 240, 200, 40, 255);
+    for (int i = 0; i < hint.length; i++) {
+        Pos a = pos_from_index(hint.path[i]), b = pos_from_index(hint.path[i + 1]);
+        SDL_Point pa = board_point(&self->rect, a.x, a.y), pb = board_point(&self->rect, b.x, b.y);
+        // Trait de 3 pixels
+        for (int d = -1; d <= 1; d++) {
+            SDL_RenderDrawLine(ren, pa.x + d, pa.y, pb.x + d, pb.y);
+            SDL_RenderDrawLine(ren, pa.x, pa.y + d, pb.x, pb.y + d);
+        }
+    }
+    Pos from = pos_from_index(hint.path[0]), to = pos_from_index(hint.path[hint.length]);
+    SDL_Point pf = board_point(&self->rect, from.x, from.y), pt = board_point(&self->rect, to.x, to.y);
+    SDL_Rect mark = { pf.x - 5, pf.y - 5, 11, 11 };
+    SDL_RenderDrawRect(ren, &mark);
+    mark.x = pt.x - 5;
+    mark.y = pt.y - 5;
+    SDL_RenderFillRect(ren, &mark);
+}
+
+void game_scene_show_hint(Scene *s, const Turn *t) {
+    if (!t || t->length == 0) {
+        if (!hint_shown) return;
+        hint_shown = false;
+    } else {
+        if (hint_shown && hint.length == t->length &&
+            memcmp(hint.path, t->path, t->length + 1) == 0) return;
+        hint = *t;
+        hint_shown = true;
+    }
+    layer_mark_dirty(s->hint_layer);
+}
 
 static void game_init(Scene *s) {
     s->lm = lm_create();
+    s->lm->root->on_render = game_background;
+    // Les enfants ajoutés en dernier sont dessinés en premier
+    s->hint_layer = layer_create();
+    s->hint_layer->on_render = hint_render;
+    layer_add_child(s->lm->root, s->hint_layer);
     s->board_layer = layer_create();
+    s->board_layer->on_render = board_render;
+    layer_set_cached(s->board_layer, true);
     layer_add_child(s->lm->root, s->board_layer);
+    hint_shown = false;
 }
 
 static void game_layout(Scene *s, int w, int h) {
     SDL_Rect board = { .x = w/2-256, .y = h/2-128, .w = 512, .h = 256 };
     layer_set_rect(s->board_layer, &board);
+    layer_set_rect(s->hint_layer, &board);
 }
 
 static void game_cleanup(Scene *s) {
@@ -25,6 +118,7 @@ Scene *game_scene_create(void) {
     Scene *s = malloc(sizeof(Scene));
     s->lm = NULL;
     s->board_layer = NULL;
+    s->hint_layer = NULL;
     s->init = game_init;
     s->layout = game_layout;
     s->cleanup = game_cleanup;
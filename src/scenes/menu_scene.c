@@ -1,8 +1,16 @@
 #include "scene.h"
 #include <stdlib.h>
 
+// Le fond est peint par le root, sous chaque zone redessinée
+static void menu_background(Layer *self, SDL_Renderer *ren) {
+    (void)self;
+    SDL_SetRenderDrawColor(ren, 40, 40, 60, 255);
+    SDL_RenderFillRect(ren, NULL); // contrairement à SDL_RenderClear, respecte le clip
+}
+
 static void menu_init(Scene *s) {
     s->lm = lm_create();
+    s->lm->root->on_render = menu_background;
 }
 
 static void menu_layout(Scene *s, int w, int h) {
@@ -21,6 +29,7 @@ Scene *menu_scene_create(void) {
     Scene *s = malloc(sizeof(Scene));
     s->lm = NULL;
     s->board_layer = NULL;
+    s->hint_layer = NULL;
     s->init = menu_init;
     s->layout = menu_layout;
     s->cleanup = menu_cleanup;
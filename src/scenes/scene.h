@@ -1,14 +1,20 @@
 #pragma once
 #include "../layer/layer_manager.h"
+#include "../engine/fanorona.h"
 
 typedef struct Scene Scene;
 struct Scene {
     LayerManager *lm;
     Layer *board_layer;
+    Layer *hint_layer;    // au-dessus du plateau, hors de sa texture
     void (*init)(Scene *s);
     void (*layout)(Scene *s, int w, int h);
     void (*cleanup)(Scene *s);
 };
 
 Scene *game_scene_create(void);
-Scene *menu_scene_create(void);
\ No newline at end of file
+Scene *menu_scene_create(void);
+
+// Trace le tour t sur le plateau (meilleur coup de l'IA pendant sa
+// réflexion) ; NULL l'efface. Ne redessine que s'il change.
+void game_scene_show_hint(Scene *s, const Turn *t);
@@ -0,0 +1,145 @@
+// fanorona-analyze: times the post-game analyzer on one game.
+//   fanorona-analyze -R games.fngr -n 3     the fourth game of a record
+//   fanorona-analyze -p 60                  a random game of 60 turns
+// Every position before a turn is searched, as after a real game, and the
+// wall time of the whole analysis is reported with the slowest position.
+#define _POSIX_C_SOURCE 200112L
+#include "../analyzer/postgame.h"
+#include "../core/clock.h"
+#include "../engine/chain.h"
+#include "../engine/record.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_POSITIONS 1024
+
+static GameState positions[MAX_POSITIONS];
+static bool verbose;
+
+typedef struct {
+    int    done;
+    double started, last;
+    double slowest; // longest gap between two results
+} Progress;
+
+static Progress progress;
+
+// Runs on a worker, one call at a time
+static void on_result(AltMove *alts, int count) {
+    double now = clock_now();
+    for (int i = 0; i < count; i++) {
+        const AltMove *m = &alts[i];
+        if (verbose) {
+            printf("  ply %3d  %c%d-%c%d  %+.2f\n", m->ply, 'a' + m->from.x, m->from.y + 1,
+                   'a' + m->to.x, m->to.y + 1, m->score);
+        }
+        progress.done++;
+    }
+    if (now - progress.last > progress.slowest) progress.slowest = now - progress.last;
+    progress.last = now;
+}
+
+static uint64_t rng_next(uint64_t *s) {
+    *s ^= *s << 13;
+    *s ^= *s >> 7;
+    *s ^= *s << 17;
+    return *s;
+}
+
+static int random_game(int plies, uint64_t seed) {
+    static Turn turns[MAX_TURNS];
+    uint64_t rng = seed * 0x9E3779B97F4A7C15ULL | 1;
+    GameState g;
+    game_state_init(&g);
+    int count = 0, winner;
+    while (count < plies && count < MAX_POSITIONS && !game_is_terminal(&g, &winner)) {
+        int n = chain_generate(&g, turns, MAX_TURNS);
+        if (n > MAX_TURNS) n = MAX_TURNS;
+        positions[count++] = g;
+        game_apply_turn(&g, &turns[rng_next(&rng) % (uint64_t)n]);
+    }
+    return count;
+}
+
+// Positions before each turn of game `index`, -1 when the record lacks it
+static int recorded_game(const char *path, int index) {
+    RecordReader *r = record_reader_open(path);
+    if (!r) return -1;
+    GameState start;
+    Turn t;
+    int count = -1;
+    for (int i = 0; record_next_game(r, &start); i++) {
+        if (i < index) {
+            while (record_next_turn(r, &t) == 1) {}
+            continue;
+        }
+        count = 0;
+        while (count < MAX_POSITIONS && record_next_turn(r, &t) == 1) {
+            positions[count++] = start;
+            start = *record_position(r);
+        }
+        break;
+    }
+    record_reader_close(r);
+    return count;
+}
+
+static void usage(const char *prog) {
+    printf("Usage: %s [OPTIONS]\n", prog);
+    printf("Options:\n");
+    printf("  -R, --record FILE  Analyse a game from a binary record\n");
+    printf("  -n, --game N       Which game of the record, from 0 (default 0)\n");
+    printf("  -p, --plies N      Otherwise a random game of this many turns (default 60)\n");
+    printf("  -S, --seed N       Seed for the random game (default 1)\n");
+    printf("  -v, --verbose      Print the best turn found at each position\n");
+    printf("  -h, --help         Show this help message\n");
+}
+
+int main(int argc, char *argv[]) {
+    const char *record = NULL;
+    int index = 0, plies = 60;
+    uint64_t seed = 1;
+
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        bool has_arg = i + 1 < argc;
+        if ((!strcmp(a, "-R") || !strcmp(a, "--record")) && has_arg) record = argv[++i];
+        else if ((!strcmp(a, "-n") || !strcmp(a, "--game")) && has_arg) index = atoi(argv[++i]);
+        else if ((!strcmp(a, "-p") || !strcmp(a, "--plies")) && has_arg) plies = atoi(argv[++i]);
+        else if ((!strcmp(a, "-S") || !strcmp(a, "--seed")) && has_arg) seed = strtoull(argv[++i], NULL, 10);
+        else if (!strcmp(a, "-v") || !strcmp(a, "--verbose")) verbose = true;
+        else if (!strcmp(a, "-h") || !strcmp(a, "--help")) {
+            usage(argv[0]);
+            return 0;
+        } else {
+            printf("Unknown option: %s\n", a);
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (index < 0 || plies <= 0 || seed == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    int count = record ? recorded_game(record, index) : random_game(plies, seed);
+    if (count < 0) {
+        printf("No game %d in %s\n", index, record);
+        return 1;
+    }
+    if (count == 0) {
+        printf("The game has no turns\n");
+        return 1;
+    }
+    printf("Analysing %d positions (depth %d, %.2f s each at most)\n", count, ANALYZER_DEPTH, ANALYZER_TIME);
+
+    progress.started = progress.last = clock_now();
+    analyzer_start(positions, count, on_result);
+    analyzer_wait();
+    double elapsed = clock_now() - progress.started;
+
+    printf("%d of %d positions in %.2f s, %.3f s per position, longest wait %.3f s\n", progress.done, count,
+           elapsed, elapsed / count, progress.slowest);
+    return progress.done == count ? 0 : 1;
+}
@@ -0,0 +1,191 @@
+// fanorona-book: builds an opening book from game logs.
+// Reads binary game records (record.h), fanorona-selfplay logs (a
+// "game ... result=..." line followed by turn:ms:nodes tokens) or plain
+// lines of space-separated turns, which count as draws. Every move of
+// the first plies of each game scores 2 / 1 / 0 for the side that
+// played it on a win / draw / loss.
+#include "../ai/book.h"
+#include "../core/clock.h"
+#include "../engine/notation.h"
+#include "../engine/record.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LINE_MAX_LEN 65536
+#define BOOK_PLIES_MAX 64 // book moves kept per recorded game
+
+typedef struct {
+    BookEntry *entries;
+    int        count, capacity;
+    int        games, skipped;
+} Builder;
+
+static bool add_entry(Builder *b, uint64_t key, uint64_t child, uint32_t weight) {
+    if (b->count == b->capacity) {
+        int capacity = b->capacity ? b->capacity * 2 : 4096;
+        BookEntry *e = realloc(b->entries, (size_t)capacity * sizeof(BookEntry));
+        if (!e) return false;
+        b->entries = e;
+        b->capacity = capacity;
+    }
+    BookEntry *e = &b->entries[b->count++];
+    e->key = key;
+    e->child = child;
+    e->weight = weight;
+    e->games = 1;
+    return true;
+}
+
+// winner: 1 = white, 2 = black, 0 = draw
+static bool add_game(Builder *b, char *moves, int winner, int plies) {
+    GameState g;
+    game_state_init(&g);
+    int ply = 0;
+    for (char *tok = strtok(moves, " \t\r\n"); tok && ply < plies; tok = strtok(NULL, " \t\r\n"), ply++) {
+        char *colon = strchr(tok, ':');
+        if (colon) *colon = '\0';
+
+        Turn t;
+        if (!turn_parse(&g, tok, &t)) {
+            b->skipped++;
+            break;
+        }
+        uint64_t key = g.hash;
+        uint32_t weight = winner == 0 ? 1 : (winner == g.current_player ? 2 : 0);
+        game_apply_turn(&g, &t);
+        if (!add_entry(b, key, g.hash, weight)) return false;
+    }
+    b->games++;
+    return true;
+}
+
+static bool read_log(Builder *b, const char *path, int plies) {
+    static char line[LINE_MAX_LEN];
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        printf("Cannot read %s\n", path);
+        return false;
+    }
+
+    int winner = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), f)) {
+        if (line[0] == '#' || line[0] == '\n') continue;
+        if (strncmp(line, "game ", 5) == 0) {
+            // Result of the moves on the next line
+            const char *r = strstr(line, "result=");
+            winner = 0;
+            if (r && strncmp(r + 7, "1-0", 3) == 0) winner = 1;
+            else if (r && strncmp(r + 7, "0-1", 3) == 0) winner = 2;
+            continue;
+        }
+        ok = add_game(b, line, winner, plies);
+        winner = 0;
+    }
+    fclose(f);
+    return ok;
+}
+
+static bool read_record(Builder *b, RecordReader *r, const char *path, int plies) {
+    double t0 = clock_now();
+    int games = 0;
+    uint64_t turns = 0;
+    GameState start;
+    while (record_next_game(r, &start)) {
+        // The result comes last, so the book moves wait for it
+        struct { uint64_t key, child; int mover; } moves[BOOK_PLIES_MAX];
+        int count = 0, status;
+        Turn t;
+        GameState before = start;
+        while ((status = record_next_turn(r, &t)) > 0) {
+            if (count < plies && count < BOOK_PLIES_MAX) {
+                moves[count].key = before.hash;
+                moves[count].child = record_position(r)->hash;
+                moves[count].mover = before.current_player;
+                count++;
+            }
+            before = *record_position(r);
+            turns++;
+        }
+        if (status < 0) break;
+
+        RecordResult result = record_result(r);
+        if (result == RECORD_UNFINISHED) continue;
+        for (int i = 0; i < count; i++) {
+            uint32_t weight = result == RECORD_DRAW ? 1 : (moves[i].mover == (int)result ? 2 : 0);
+            if (!add_entry(b, moves[i].key, moves[i].child, weight)) return false;
+        }
+        b->games++;
+        games++;
+    }
+    if (record_failed(r)) {
+        printf("%s: corrupt game after %d games, rest ignored\n", path, games);
+    }
+    double elapsed = clock_now() - t0;
+    printf("%s: %d games, %llu turns replayed in %.2f s (%.0f games/s)\n", path, games,
+           (unsigned long long)turns, elapsed, elapsed > 0 ? games / elapsed : 0.0);
+    return true;
+}
+
+static void usage(const char *prog) {
+    printf("Usage: %s [OPTIONS] LOG|RECORD...\n", prog);
+    printf("Options:\n");
+    printf("  -o, --output FILE   Book file (default fanorona.book)\n");
+    printf("  -p, --plies N       Plies of each game to keep (default 12)\n");
+    printf("  -n, --min-games N   Drop moves seen in fewer games (default 2)\n");
+    printf("  -h, --help          Show this help message\n");
+}
+
+int main(int argc, char *argv[]) {
+    const char *output = "fanorona.book";
+    int plies = 12, min_games = 2, logs = 0;
+    Builder b;
+    memset(&b, 0, sizeof(b));
+
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        if ((!strcmp(a, "-o") || !strcmp(a, "--output")) && i + 1 < argc) {
+            output = argv[++i];
+        } else if ((!strcmp(a, "-p") || !strcmp(a, "--plies")) && i + 1 < argc) {
+            plies = atoi(argv[++i]);
+        } else if ((!strcmp(a, "-n") || !strcmp(a, "--min-games")) && i + 1 < argc) {
+            min_games = atoi(argv[++i]);
+        } else if (!strcmp(a, "-h") || !strcmp(a, "--help")) {
+            usage(argv[0]);
+            return 0;
+        } else if (a[0] == '-') {
+            printf("Unknown option: %s\n", a);
+            usage(argv[0]);
+            return 1;
+        } else {
+            RecordReader *r = record_reader_open(a);
+            bool ok = r ? read_record(&b, r, a, plies) : read_log(&b, a, plies);
+            record_reader_close(r);
+            if (!ok) {
+                free(b.entries);
+                return 1;
+            }
+            logs++;
+        }
+    }
+    if (logs == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    int moves = b.count;
+    if (!book_write(output, b.entries, b.count, min_games > 0 ? (uint32_t)min_games : 0)) {
+        printf("Cannot write %s\n", output);
+        free(b.entries);
+        return 1;
+    }
+    free(b.entries);
+
+    Book *book = book_open(output);
+    printf("%d games (%d cut short by an unreadable turn), %d moves read\n",
+           b.games, b.skipped, moves);
+    printf("%s: %d entries\n", output, book_size(book));
+    book_close(book);
+    return 0;
+}
@@ -0,0 +1,349 @@
+// fanorona-bots: load test for fanorona-server. Opens many connections
+// from one process, each playing random legal turns through the server
+// and joining the queue again after every game, until the games asked for
+// are played. Reports the turns played per second and the round trip of
+// pings sent alongside the turns.
+//   fanorona-server -i 1 &  fanorona-bots -n 2000 -g 5
+#define _POSIX_C_SOURCE 200112L
+#include "../core/clock.h"
+#include "../engine/chain.h"
+#include "../net/protocol.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#define MAX_EVENTS  256
+#define MAX_SAMPLES (1 << 20)
+#define PING_EVERY  1.0
+
+typedef struct {
+    int         fd;
+    bool        connected, in_game, dirty, want_out;
+    int         side;
+    uint16_t    turns; // played in this game
+    double      think_until, next_ping;
+    uint64_t    rng;
+    GameState   g;
+    ProtoRing   rx;
+    ProtoOutbox tx;
+} Bot;
+
+typedef struct {
+    Bot     *bots;
+    int      count, open;
+    int      playing;     // bots in a game
+    uint64_t target;      // games to play, then everyone leaves
+    int      epfd;
+    double   think;
+    Bot    **dirty;
+    int      dirty_count;
+    uint64_t turns, games, desyncs, failures;
+    double  *rtt;
+    int      rtt_count;
+    int      results[4]; // by ProtoEnd
+} Load;
+
+static uint64_t rng_next(uint64_t *s) {
+    *s ^= *s << 13;
+    *s ^= *s >> 7;
+    *s ^= *s << 17;
+    return *s;
+}
+
+// Ping tokens, wrapping after an hour and a bit; differences stay right
+static uint32_t now_us(void) {
+    return (uint32_t)(uint64_t)(clock_now() * 1e6);
+}
+
+static void queued(Load *l, Bot *b, bool ok) {
+    if (!ok) return; // the server stopped reading; the game will be lost on time
+    if (!b->dirty) {
+        b->dirty = true;
+        l->dirty[l->dirty_count++] = b;
+    }
+}
+
+static void close_bot(Load *l, Bot *b, bool failed) {
+    if (b->fd < 0) return;
+    close(b->fd);
+    b->fd = -1;
+    l->open--;
+    l->failures += failed;
+}
+
+static void handle_frame(Load *l, Bot *b, const ProtoFrame *f) {
+    WireTurn w;
+    Turn t;
+    uint16_t seq;
+    switch (f->opcode) {
+    case OP_START:
+        if (f->size < 5) break;
+        b->side = proto_u8(f, 0);
+        b->in_game = true;
+        l->playing++;
+        b->turns = 0;
+        b->think_until = clock_now() + l->think;
+        game_state_init(&b->g);
+        break;
+    case OP_TURN:
+        if (!proto_read_turn(f, &w)) {
+            close_bot(l, b, true);
+            break;
+        }
+        if (w.seq == b->turns && proto_turn_unpack(&w, &b->g, &t)) {
+            game_apply_turn(&b->g, &t);
+            b->turns++;
+            b->think_until = clock_now() + l->think;
+        } else {
+            l->desyncs++;
+            queued(l, b, proto_put_sync_request(&b->tx));
+        }
+        break;
+    case OP_SYNC:
+        if (proto_read_sync(f, &seq, &b->g)) b->turns = seq;
+        break;
+    case OP_RESULT:
+        if (f->size < 2) break;
+        b->in_game = false;
+        l->playing--;
+        l->games++; // once per player
+        if (proto_u8(f, 1) < 4) l->results[proto_u8(f, 1)]++;
+        if (l->games < 2 * l->target) queued(l, b, proto_put_hello(&b->tx));
+        break;
+    case OP_PONG:
+        if (f->size >= 4 && l->rtt_count < MAX_SAMPLES) {
+            l->rtt[l->rtt_count++] = (double)(uint32_t)(now_us() - proto_u32(f, 0)) / 1e6;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+static void read_bot(Load *l, Bot *b) {
+    int room;
+    uint8_t *space = proto_ring_space(&b->rx, &room);
+    ssize_t n = room ? recv(b->fd, space, (size_t)room, 0) : -1;
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+        close_bot(l, b, true);
+        return;
+    }
+    if (n < 0) return;
+    proto_ring_commit(&b->rx, (int)n);
+    ProtoFrame f;
+    int r;
+    while (b->fd >= 0 && (r = proto_next_frame(&b->rx, &f)) == 1) handle_frame(l, b, &f);
+    if (b->fd >= 0 && r < 0) close_bot(l, b, true);
+}
+
+static void flush(Load *l) {
+    for (int i = 0; i < l->dirty_count; i++) {
+        Bot *b = l->dirty[i];
+        b->dirty = false;
+        if (b->fd < 0 || b->tx.length == 0) continue;
+        ssize_t n = send(b->fd, b->tx.data, (size_t)b->tx.length, MSG_NOSIGNAL);
+        if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            close_bot(l, b, true);
+            continue;
+        }
+        if (n > 0) proto_outbox_sent(&b->tx, (int)n);
+        bool want_out = b->tx.length > 0;
+        if (want_out != b->want_out) {
+            struct epoll_event ev = { .events = EPOLLIN | (want_out ? EPOLLOUT : 0), .data.ptr = b };
+            epoll_ctl(l->epfd, EPOLL_CTL_MOD, b->fd, &ev);
+            b->want_out = want_out;
+        }
+    }
+    l->dirty_count = 0;
+}
+
+// Plays for every bot whose turn it is; returns how many are still thinking
+static int play(Load *l, Turn *turns) {
+    double now = clock_now();
+    int thinking = 0;
+    for (int i = 0; i < l->count; i++) {
+        Bot *b = &l->bots[i];
+        if (b->fd < 0 || !b->connected) continue;
+        if (now >= b->next_ping) {
+            b->next_ping = now + PING_EVERY;
+            queued(l, b, proto_put_ping(&b->tx, OP_PING, now_us()));
+        }
+        if (!b->in_game || b->g.current_player != b->side) continue;
+        if (now < b->think_until) {
+            thinking++;
+            continue;
+        }
+        int n = chain_generate(&b->g, turns, MAX_TURNS);
+        if (n > MAX_TURNS) n = MAX_TURNS;
+        if (n == 0) continue; // lost; the result is on its way
+        const Turn *t = &turns[rng_next(&b->rng) % (uint64_t)n];
+        WireTurn w;
+        proto_turn_pack(&w, &b->g, t, b->turns++);
+        game_apply_turn(&b->g, t);
+        l->turns++;
+        queued(l, b, proto_put_turn(&b->tx, &w));
+    }
+    return thinking;
+}
+
+static bool open_bots(Load *l, const struct addrinfo *ai) {
+    for (int i = 0; i < l->count; i++) {
+        Bot *b = &l->bots[i];
+        b->fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (b->fd < 0) {
+            printf("socket() failed after %d connections (raise ulimit -n?)\n", i);
+            return false;
+        }
+        int flags = fcntl(b->fd, F_GETFL, 0);
+        fcntl(b->fd, F_SETFL, flags | O_NONBLOCK);
+        int one = 1;
+        setsockopt(b->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (connect(b->fd, ai->ai_addr, ai->ai_addrlen) != 0 && errno != EINPROGRESS) {
+            printf("connect() failed: %s\n", strerror(errno));
+            return false;
+        }
+        struct epoll_event ev = { .events = EPOLLIN | EPOLLOUT, .data.ptr = b };
+        epoll_ctl(l->epfd, EPOLL_CTL_ADD, b->fd, &ev);
+        b->want_out = true;
+        b->rng = (uint64_t)(i + 1) * 0x9E3779B97F4A7C15ULL | 1;
+        proto_ring_reset(&b->rx);
+        l->open++;
+    }
+    return true;
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void usage(const char *prog) {
+    printf("Usage: %s [OPTIONS]\n", prog);
+    printf("Options:\n");
+    printf("  -H, --host NAME    Server address (default 127.0.0.1)\n");
+    printf("  -p, --port N       Server port (default 7777)\n");
+    printf("  -n, --bots N       Connections, an even number (default 200)\n");
+    printf("  -g, --games N      Games per bot on average (default 5)\n");
+    printf("  -d, --think MS     Delay before each turn (default 0)\n");
+    printf("  -t, --timeout S    Give up after this many seconds (default 60)\n");
+    printf("  -h, --help         Show this help message\n");
+}
+
+int main(int argc, char *argv[]) {
+    const char *host = "127.0.0.1";
+    int port = 7777, count = 200, games = 5;
+    double think_ms = 0.0, timeout = 60.0;
+
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        bool has_arg = i + 1 < argc;
+        if ((!strcmp(a, "-H") || !strcmp(a, "--host")) && has_arg) host = argv[++i];
+        else if ((!strcmp(a, "-p") || !strcmp(a, "--port")) && has_arg) port = atoi(argv[++i]);
+        else if ((!strcmp(a, "-n") || !strcmp(a, "--bots")) && has_arg) count = atoi(argv[++i]);
+        else if ((!strcmp(a, "-g") || !strcmp(a, "--games")) && has_arg) games = atoi(argv[++i]);
+        else if ((!strcmp(a, "-d") || !strcmp(a, "--think")) && has_arg) think_ms = atof(argv[++i]);
+        else if ((!strcmp(a, "-t") || !strcmp(a, "--timeout")) && has_arg) timeout = atof(argv[++i]);
+        else if (!strcmp(a, "-h") || !strcmp(a, "--help")) {
+            usage(argv[0]);
+            return 0;
+        } else {
+            printf("Unknown option: %s\n", a);
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (port <= 0 || port > 65535 || count < 2 || count % 2 || games < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    struct rlimit rlim;
+    if (getrlimit(RLIMIT_NOFILE, &rlim) == 0 && rlim.rlim_cur < rlim.rlim_max) {
+        rlim.rlim_cur = rlim.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rlim);
+    }
+    char service[8];
+    snprintf(service, sizeof(service), "%d", port);
+    struct addrinfo hints, *ai = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, service, &hints, &ai) != 0 || !ai) {
+        printf("Unknown host %s\n", host);
+        return 1;
+    }
+
+    Load l;
+    memset(&l, 0, sizeof(l));
+    l.count = count;
+    l.target = (uint64_t)count * (uint64_t)games / 2;
+    l.think = think_ms / 1000.0;
+    l.epfd = epoll_create1(0);
+    l.bots = calloc((size_t)count, sizeof(Bot));
+    l.dirty = malloc((size_t)count * sizeof(Bot *));
+    l.rtt = malloc(MAX_SAMPLES * sizeof(double));
+    Turn *turns = malloc(MAX_TURNS * sizeof(Turn));
+    bool ok = l.epfd >= 0 && l.bots && l.dirty && l.rtt && turns && open_bots(&l, ai);
+    freeaddrinfo(ai);
+
+    double t0 = clock_now();
+    struct epoll_event events[MAX_EVENTS];
+    while (ok && l.open > 0 && (l.games < 2 * l.target || l.playing > 0) && clock_now() - t0 < timeout) {
+        int thinking = play(&l, turns);
+        flush(&l);
+        int n = epoll_wait(l.epfd, events, MAX_EVENTS, thinking ? 1 : 10);
+        for (int i = 0; i < n; i++) {
+            Bot *b = events[i].data.ptr;
+            if (b->fd < 0) continue;
+            if (!b->connected) {
+                int err = 0;
+                socklen_t len = sizeof(err);
+                if (getsockopt(b->fd, SOL_SOCKET, SO_ERROR, &err, &len) != 0 || err != 0) {
+                    close_bot(&l, b, true);
+                    continue;
+                }
+                b->connected = true;
+                queued(&l, b, proto_put_hello(&b->tx));
+                continue;
+            }
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) read_bot(&l, b);
+            if (b->fd >= 0 && (events[i].events & EPOLLOUT)) queued(&l, b, true);
+        }
+    }
+    double dt = clock_now() - t0;
+
+    qsort(l.rtt, (size_t)l.rtt_count, sizeof(double), compare_double);
+    double p50 = l.rtt_count ? l.rtt[l.rtt_count / 2] : 0.0;
+    double p99 = l.rtt_count ? l.rtt[(int)(l.rtt_count * 0.99)] : 0.0;
+    double max = l.rtt_count ? l.rtt[l.rtt_count - 1] : 0.0;
+    printf("%d bots, %llu games in %.1f s (%d rules, %d time, %d abandoned, %d turn limit)\n",
+           count, (unsigned long long)l.games / 2, dt, l.results[END_RULES] / 2, l.results[END_TIME] / 2,
+           l.results[END_ABANDON], l.results[END_TURN_LIMIT] / 2);
+    printf("%llu turns, %.0f turns/s | ping rtt p50 %.3f ms, p99 %.3f ms, max %.3f ms (%d samples)\n",
+           (unsigned long long)l.turns, dt > 0 ? l.turns / dt : 0.0, p50 * 1000.0, p99 * 1000.0,
+           max * 1000.0, l.rtt_count);
+    printf("%llu desyncs, %llu connections lost\n", (unsigned long long)l.desyncs, (unsigned long long)l.failures);
+
+    for (int i = 0; i < count && l.bots; i++) {
+        if (l.bots[i].fd >= 0) close(l.bots[i].fd);
+    }
+    free(l.bots);
+    free(l.dirty);
+    free(l.rtt);
+    free(turns);
+    if (l.epfd >= 0) close(l.epfd);
+    return ok && l.games >= 2 * l.target && l.failures == 0 && l.desyncs == 0 ? 0 : 1;
+}
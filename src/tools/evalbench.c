@@ -0,0 +1,268 @@
+// fanorona-evalbench: neural evaluator throughput.
+// Scores positions from the games of a binary record (-R), or sampled from
+// random games, with the weights given by -w or with random weights, and
+// reports evaluations per second. Then replays the games, as often as -n
+// asks, scoring every child of every position as a search does, from
+// scratch and with the incremental accumulator, and scores all positions
+// at once with gnn_predict_batch().
+#include "../ai/gnn_inference.h"
+#include "../core/clock.h"
+#include "../engine/chain.h"
+#include "../engine/record.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_POSITIONS 4096
+
+static GameState positions[BENCH_POSITIONS];
+static float encoded[BENCH_POSITIONS][INPUT_SIZE];
+static Turn played[BENCH_POSITIONS];   // the games, back to back
+static bool game_start[BENCH_POSITIONS];
+static GameState opening[BENCH_POSITIONS]; // before played[i] when game_start[i]
+static int position_count;
+static GnnAccumulator acc;
+static float batch_out[BENCH_POSITIONS];
+
+typedef enum { REPLAY_PREDICT, REPLAY_EVALUATE, REPLAY_INCREMENTAL } ReplayMode;
+
+static uint64_t rng_next(uint64_t *s) {
+    *s ^= *s << 13;
+    *s ^= *s >> 7;
+    *s ^= *s << 17;
+    return *s;
+}
+
+// Positions along random games, restarting from the opening when one ends
+static void sample_positions(uint64_t seed) {
+    Turn turns[MAX_TURNS];
+    GameState g;
+    game_state_init(&g);
+    for (int i = 0; i < BENCH_POSITIONS; i++) {
+        int n = chain_generate(&g, turns, MAX_TURNS);
+        if (n > MAX_TURNS) n = MAX_TURNS;
+        game_start[i] = i == 0 || n == 0;
+        if (n == 0) {
+            game_state_init(&g);
+            n = chain_generate(&g, turns, MAX_TURNS);
+            if (n > MAX_TURNS) n = MAX_TURNS;
+        }
+        if (game_start[i]) opening[i] = g;
+        played[i] = turns[rng_next(&seed) % (uint64_t)n];
+        game_apply_turn(&g, &played[i]);
+        positions[i] = g;
+        gnn_encode(&g, encoded[i]);
+    }
+    position_count = BENCH_POSITIONS;
+}
+
+// Positions along the recorded games, up to BENCH_POSITIONS; a corrupt
+// game is kept up to where it breaks. false when nothing was read.
+static bool read_positions(const char *path) {
+    RecordReader *r = record_reader_open(path);
+    if (!r) return false;
+    GameState start;
+    Turn t;
+    int count = 0;
+    while (count < BENCH_POSITIONS && record_next_game(r, &start)) {
+        bool first = true;
+        while (count < BENCH_POSITIONS && record_next_turn(r, &t) == 1) {
+            game_start[count] = first;
+            if (first) opening[count] = start;
+            first = false;
+            played[count] = t;
+            positions[count] = *record_position(r);
+            gnn_encode(&positions[count], encoded[count]);
+            count++;
+        }
+    }
+    record_reader_close(r);
+    position_count = count;
+    return count > 0;
+}
+
+static float score_child(GameState *g, const Turn *t, ReplayMode mode) {
+    Undo u;
+    float v;
+    game_make(g, t, &u);
+    if (mode == REPLAY_PREDICT) {
+        float in[INPUT_SIZE];
+        gnn_encode(g, in);
+        v = gnn_predict(in);
+    } else if (mode == REPLAY_EVALUATE) {
+        v = gnn_evaluate(g);
+    } else {
+        gnn_acc_make(&acc, g, &u);
+        v = gnn_acc_evaluate(&acc, g);
+    }
+    game_unmake(g, &u);
+    if (mode == REPLAY_INCREMENTAL) gnn_acc_unmake(&acc, g);
+    return v;
+}
+
+// Scores every child of every position of the recorded games. `dev`
+// receives the largest gap to the from-scratch score when not NULL.
+static long replay(ReplayMode mode, double *sum, float *dev) {
+    static Turn turns[MAX_TURNS];
+    GameState g;
+    long evals = 0;
+    *sum = 0.0;
+    for (int i = 0; i < position_count; i++) {
+        if (game_start[i]) {
+            g = opening[i];
+            gnn_acc_reset(&acc, &g);
+        }
+        int n = chain_generate(&g, turns, MAX_TURNS);
+        if (n > MAX_TURNS) n = MAX_TURNS;
+        for (int k = 0; k < n; k++) {
+            float v = score_child(&g, &turns[k], mode);
+            if (dev) {
+                float ref = score_child(&g, &turns[k], REPLAY_EVALUATE);
+                float d = v > ref ? v - ref : ref - v;
+                if (d > *dev) *dev = d;
+            }
+            *sum += v;
+        }
+        evals += n;
+
+        Undo u;
+        game_make(&g, &played[i], &u);
+        gnn_acc_make(&acc, &g, &u);
+    }
+    return evals;
+}
+
+static void report(const char *name, long evals, double dt, double checksum) {
+    printf("  %-11s %10ld evals  %7.3f s  %12.0f evals/s  %7.1f ns/eval  (sum %.4f)\n",
+           name, evals, dt, dt > 0 ? evals / dt : 0.0, dt > 0 ? dt * 1e9 / evals : 0.0, checksum);
+}
+
+static void usage(const char *prog) {
+    printf("Usage: %s [OPTIONS]\n", prog);
+    printf("Options:\n");
+    printf("  -w, --weights FILE  Load this weight file instead of random weights\n");
+    printf("  -R, --record FILE   Positions from the games of a binary record\n");
+    printf("  -n, --evals N       Number of evaluations per run (default 2000000)\n");
+    printf("  -t, --threads N     Threads for batched evaluation, 0 = one per core (default 1)\n");
+    printf("  -S, --seed N        Seed for random weights and positions (default 1)\n");
+    printf("  -o, --output FILE   Write the random weights to FILE and exit\n");
+    printf("  -h, --help          Show this help message\n");
+}
+
+int main(int argc, char *argv[]) {
+    const char *weights = NULL, *output = NULL, *record = NULL;
+    long evals = 2000000;
+    uint64_t seed = 1;
+    int threads = 1;
+
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        if ((!strcmp(a, "-w") || !strcmp(a, "--weights")) && i + 1 < argc) {
+            weights = argv[++i];
+        } else if ((!strcmp(a, "-R") || !strcmp(a, "--record")) && i + 1 < argc) {
+            record = argv[++i];
+        } else if ((!strcmp(a, "-n") || !strcmp(a, "--evals")) && i + 1 < argc) {
+            evals = atol(argv[++i]);
+        } else if ((!strcmp(a, "-t") || !strcmp(a, "--threads")) && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if ((!strcmp(a, "-S") || !strcmp(a, "--seed")) && i + 1 < argc) {
+            seed = strtoull(argv[++i], NULL, 10);
+        } else if ((!strcmp(a, "-o") || !strcmp(a, "--output")) && i + 1 < argc) {
+            output = argv[++i];
+        } else if (!strcmp(a, "-h") || !strcmp(a, "--help")) {
+            usage(argv[0]);
+            return 0;
+        } else {
+            printf("Unknown option: %s\n", a);
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (evals < 1 || seed == 0) {
+        printf("Evaluation count and seed must be positive\n");
+        return 1;
+    }
+
+    if (weights) {
+        if (!gnn_load(weights)) {
+            printf("Cannot load weights: %s\n", weights);
+            return 1;
+        }
+    } else {
+        gnn_init_random(seed);
+    }
+    if (output) {
+        if (!gnn_save(output)) {
+            printf("Cannot write weights: %s\n", output);
+            return 1;
+        }
+        printf("Weights written to %s\n", output);
+        return 0;
+    }
+
+    if (!record) {
+        sample_positions(seed);
+    } else if (!read_positions(record)) {
+        printf("No games in %s\n", record);
+        return 1;
+    }
+    printf("Network %dx%dx%dx1, %s kernels, %s weights\n",
+           INPUT_SIZE, GNN_HIDDEN1, GNN_HIDDEN2, gnn_kernel_name(), weights ? weights : "random");
+
+    double sum = 0.0, t0 = clock_now();
+    for (long i = 0; i < evals; i++) {
+        sum += gnn_predict(encoded[i % position_count]);
+    }
+    report("predict", evals, clock_now() - t0, sum);
+
+    sum = 0.0;
+    t0 = clock_now();
+    for (long i = 0; i < evals; i++) {
+        sum += gnn_evaluate(&positions[i % position_count]);
+    }
+    report("evaluate", evals, clock_now() - t0, sum);
+
+    // Whole replays, one untimed, then as many as make up about -n evaluations
+    printf("Children of %d positions from %s:\n", position_count, record ? record : "random games");
+    static const char *names[] = { "predict", "evaluate", "incremental" };
+    for (int mode = REPLAY_PREDICT; mode <= REPLAY_INCREMENTAL; mode++) {
+        double pass_sum, total = 0.0;
+        long n = 0, pass = replay((ReplayMode)mode, &pass_sum, NULL);
+        t0 = clock_now();
+        while (pass > 0 && n < evals) {
+            n += replay((ReplayMode)mode, &pass_sum, NULL);
+            total += pass_sum;
+        }
+        report(names[mode], n, clock_now() - t0, total);
+    }
+    float dev = 0.0f;
+    replay(REPLAY_INCREMENTAL, &sum, &dev);
+    printf("  incremental vs full: max difference %.2e\n", dev);
+
+    GnnBatch batch;
+    if (!gnn_batch_init(&batch, position_count)) {
+        printf("Out of memory\n");
+        return 1;
+    }
+    for (int i = 0; i < position_count; i++) gnn_batch_add(&batch, &positions[i]);
+    printf("Batches of %d positions, %d thread(s) requested:\n", position_count, threads);
+    long rounds = (evals + position_count - 1) / position_count;
+    sum = 0.0;
+    t0 = clock_now();
+    for (long r = 0; r < rounds; r++) {
+        gnn_predict_batch(&batch, batch_out, threads);
+        sum += batch_out[r % position_count];
+    }
+    report("batch", rounds * position_count, clock_now() - t0, sum);
+    dev = 0.0f;
+    for (int i = 0; i < position_count; i++) {
+        float d = batch_out[i] - gnn_evaluate(&positions[i]);
+        if (d < 0) d = -d;
+        if (d > dev) dev = d;
+    }
+    printf("  batch vs single: max difference %.2e\n", dev);
+    gnn_batch_free(&batch);
+
+    gnn_unload();
+    return 0;
+}
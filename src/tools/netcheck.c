@@ -0,0 +1,556 @@
+// fanorona-netcheck: plays random games between two processes over the
+// P2P layer and checks that both ends finish on the same position.
+//   fanorona-netcheck --host 7777 &  fanorona-netcheck --join 127.0.0.1 7777
+// The host plays white. Every turn is sent whole as it is played, and at
+// the end each side sends its position hash as a chat line for the other
+// to compare. With --drop N the joiner cuts the link after every N of its
+// turns and reconnects, so the game must carry on through resumes.
+// --suite checks the wire format alone over a socketpair, then a host on
+// the loopback against stray and broken clients.
+#define _POSIX_C_SOURCE 200112L
+#include "../core/clock.h"
+#include "../engine/chain.h"
+#include "../engine/game_state.h"
+#include "../net/p2p.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef struct {
+    GameManager *gm;
+    int          turns; // in the game, across resyncs
+    int          syncs;
+    bool         desync;
+    bool         peer_done;
+    uint64_t     peer_hash;
+    P2PStatus    status;
+} Check;
+
+static Check check;
+
+static void on_turn(const Turn *t) {
+    if (game_manager_play_turn(check.gm, t)) check.turns++;
+    else check.desync = true;
+}
+
+// The host's game replaces ours; only the position matters from here
+static void on_sync(const GameState *position, uint16_t turns) {
+    GameManager *gm = check.gm;
+    game_manager_reset(gm);
+    gm->state = *position;
+    gm->game_over = game_is_terminal(&gm->state, &gm->winner);
+    check.turns = turns;
+    check.syncs++;
+}
+
+static void on_chat(const char *message) {
+    unsigned long long hash;
+    if (sscanf(message, "hash %llx", &hash) == 1) {
+        check.peer_hash = hash;
+        check.peer_done = true;
+    }
+}
+
+static void on_status(P2PStatus status, const char *message) {
+    check.status = status;
+    printf("[%s] %s\n", status == P2P_CONNECTED ? "connected" :
+           status == P2P_CONNECTING ? "connecting" : status == P2P_ERROR ? "error" : "closed", message);
+}
+
+static uint64_t rng_next(uint64_t *s) {
+    *s ^= *s << 13;
+    *s ^= *s >> 7;
+    *s ^= *s << 17;
+    return *s;
+}
+
+static void sleep_ms(int ms) {
+    struct timespec ts = { 0, ms * 1000000L };
+    nanosleep(&ts, NULL);
+}
+
+static Turn turns[MAX_TURNS];
+
+static void play_turn(GameManager *gm, uint64_t *rng) {
+    int n = chain_generate(&gm->state, turns, MAX_TURNS);
+    if (n > MAX_TURNS) n = MAX_TURNS;
+    if (n == 0) return;
+    const Turn *t = &turns[rng_next(rng) % (uint64_t)n];
+    if (game_manager_play_turn(gm, t)) {
+        p2p_send_turn(t);
+        check.turns++;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Wire format suite
+// ---------------------------------------------------------------------------
+
+#define SUITE_TURNS 20000
+#define FUZZ_ROUNDS 20000
+
+typedef struct {
+    int       opcode;
+    GameState before;  // OP_TURN: position it was played from
+    Turn      turn;
+    WireTurn  wire;
+    uint32_t  token;   // OP_PING, OP_RESUME hash
+    char      text[PROTO_CHAT_MAX + 1];
+} Sent;
+
+// Reads what is waiting on fd in random slices, so frames arrive split
+// and wrap around the ring, and checks each against what was sent
+static int drain(int fd, ProtoRing *ring, const Sent *sent, int count, int *next, uint64_t *rng) {
+    int failures = 0;
+    while (*next < count) {
+        int room;
+        uint8_t *space = proto_ring_space(ring, &room);
+        int want = 1 + (int)(rng_next(rng) % 64);
+        if (want > room) want = room;
+        ssize_t n = recv(fd, space, (size_t)want, MSG_DONTWAIT);
+        if (n <= 0) break;
+        proto_ring_commit(ring, (int)n);
+
+        ProtoFrame f;
+        int r;
+        while ((r = proto_next_frame(ring, &f)) == 1) {
+            const Sent *e = &sent[(*next)++];
+            bool ok = f.opcode == e->opcode;
+            if (ok && e->opcode == OP_TURN) {
+                WireTurn w;
+                Turn t;
+                ok = proto_read_turn(&f, &w) && w.seq == e->wire.seq &&
+                     proto_turn_unpack(&w, &e->before, &t) && game_turn_equal(&t, &e->turn);
+            } else if (ok && e->opcode == OP_CHAT) {
+                char text[PROTO_CHAT_MAX + 1];
+                ok = proto_read_chat(&f, text, sizeof(text)) && !strcmp(text, e->text);
+            } else if (ok && e->opcode == OP_SYNC) {
+                GameState g;
+                uint16_t seq;
+                ok = proto_read_sync(&f, &seq, &g) && seq == e->wire.seq && g.hash == e->before.hash &&
+                     g.current_player == e->before.current_player;
+            } else if (ok && e->opcode == OP_PING) {
+                ok = f.size == 4 && proto_u32(&f, 0) == e->token;
+            } else if (ok && e->opcode == OP_RESUME) {
+                uint16_t n;
+                uint32_t hash;
+                ok = proto_read_resume(&f, &n, &hash) && n == e->wire.seq && hash == e->token;
+            }
+            failures += !ok;
+        }
+        if (r < 0) return failures + 1;
+    }
+    return failures;
+}
+
+static int round_trip(uint64_t *rng) {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+        printf("[FAIL] socketpair() failed\n");
+        return 1;
+    }
+    static Sent sent[64];
+    static ProtoRing ring;
+    static ProtoOutbox out;
+    proto_ring_reset(&ring);
+    out.length = 0;
+
+    int failures = 0, played = 0, frames = 0;
+    long bytes = 0, turn_bytes = 0;
+    uint16_t seq = 0;
+    GameState g;
+    game_state_init(&g);
+    double t0 = clock_now();
+
+    while (played < SUITE_TURNS && !failures) {
+        // One batch of messages per "frame", written with a single send()
+        int count = 1 + (int)(rng_next(rng) % 32);
+        for (int i = 0; i < count; i++) {
+            Sent *e = &sent[i];
+            int winner, n = game_is_terminal(&g, &winner) ? 0 : chain_generate(&g, turns, MAX_TURNS);
+            if (n > MAX_TURNS) n = MAX_TURNS;
+            int pick = (int)(rng_next(rng) % 17);
+            bool ok;
+            if (n == 0) game_state_init(&g);
+            if (n > 0 && pick < 12) {
+                e->opcode = OP_TURN;
+                e->before = g;
+                e->turn = turns[rng_next(rng) % (uint64_t)n];
+                proto_turn_pack(&e->wire, &g, &e->turn, seq++);
+                game_apply_turn(&g, &e->turn);
+                turn_bytes += 3 + 6 + e->wire.size;
+                played++;
+                ok = proto_put_turn(&out, &e->wire);
+            } else if (pick < 14) {
+                e->opcode = OP_CHAT;
+                int len = (int)(rng_next(rng) % (PROTO_CHAT_MAX + 1));
+                for (int k = 0; k < len; k++) e->text[k] = (char)(1 + rng_next(rng) % 255);
+                e->text[len] = '\0';
+                ok = proto_put_chat(&out, e->text);
+            } else if (pick < 15) {
+                e->opcode = OP_SYNC;
+                e->before = g;
+                e->wire.seq = seq;
+                ok = proto_put_sync(&out, seq, &g);
+            } else if (pick < 16) {
+                e->opcode = OP_PING;
+                e->token = (uint32_t)rng_next(rng);
+                ok = proto_put_ping(&out, OP_PING, e->token);
+            } else {
+                e->opcode = OP_RESUME;
+                e->wire.seq = seq;
+                e->token = (uint32_t)g.hash;
+                ok = proto_put_resume(&out, OP_RESUME, seq, e->token);
+            }
+            if (!ok) {
+                printf("[FAIL] outbox full after %d bytes\n", out.length);
+                failures++;
+                break;
+            }
+        }
+        frames++;
+        bytes += out.length;
+        while (out.length > 0) {
+            ssize_t n = send(fds[0], out.data, (size_t)out.length, 0);
+            if (n <= 0) {
+                failures++;
+                break;
+            }
+            proto_outbox_sent(&out, (int)n);
+        }
+        int next = 0;
+        for (int spin = 0; next < count && spin < 100000 && !failures; spin++) {
+            failures += drain(fds[1], &ring, sent, count, &next, rng);
+        }
+        if (next < count) failures++;
+    }
+    close(fds[0]);
+    close(fds[1]);
+
+    double dt = clock_now() - t0;
+    printf("[%s] round trip  %d turns in %d batches, %ld bytes, %.2f bytes per turn frame, %.3f s\n",
+           failures ? "FAIL" : " OK ", played, frames, bytes, played ? (double)turn_bytes / played : 0.0, dt);
+    return failures ? 1 : 0;
+}
+
+// Random and damaged streams must be rejected or skipped, never trusted
+static int fuzz(uint64_t *rng) {
+    static ProtoRing ring;
+    static ProtoOutbox out;
+    GameState g;
+    game_state_init(&g);
+    long frames = 0, bad_streams = 0, turns_taken = 0;
+
+    for (int round = 0; round < FUZZ_ROUNDS; round++) {
+        proto_ring_reset(&ring);
+        ring.head = ring.tail = (uint32_t)rng_next(rng); // anywhere, wrapping included
+        out.length = 0;
+
+        // Valid messages, then damage
+        int n = chain_generate(&g, turns, MAX_TURNS);
+        if (n > MAX_TURNS) n = MAX_TURNS;
+        for (int i = 0; i < 4 && n > 0; i++) {
+            WireTurn w;
+            proto_turn_pack(&w, &g, &turns[rng_next(rng) % (uint64_t)n], (uint16_t)i);
+            proto_put_turn(&out, &w);
+        }
+        proto_put_sync(&out, 0, &g);
+        proto_put_resume(&out, OP_RESUME, 4, (uint32_t)g.hash);
+        proto_put_chat(&out, "fuzz");
+        int flips = (int)(rng_next(rng) % 8);
+        for (int i = 0; i < flips && out.length; i++) {
+            out.data[rng_next(rng) % (uint64_t)out.length] ^= (uint8_t)(1u << (rng_next(rng) % 8));
+        }
+        if (rng_next(rng) % 4 == 0) {
+            out.length = (int)(rng_next(rng) % 512);
+            for (int i = 0; i < out.length; i++) out.data[i] = (uint8_t)rng_next(rng);
+        }
+
+        int room;
+        uint8_t *space = proto_ring_space(&ring, &room);
+        int first = out.length < room ? out.length : room;
+        memcpy(space, out.data, (size_t)first);
+        proto_ring_commit(&ring, first);
+        space = proto_ring_space(&ring, &room);
+        memcpy(space, out.data + first, (size_t)(out.length - first));
+        proto_ring_commit(&ring, out.length - first);
+
+        ProtoFrame f;
+        int r;
+        while ((r = proto_next_frame(&ring, &f)) == 1) {
+            frames++;
+            WireTurn w;
+            Turn t;
+            GameState s;
+            uint16_t seq;
+            uint32_t hash;
+            char text[PROTO_CHAT_MAX + 1];
+            if (f.opcode == OP_TURN && proto_read_turn(&f, &w) && proto_turn_unpack(&w, &g, &t)) {
+                // Whatever gets through must be a legal turn from g
+                bool legal = false;
+                for (int i = 0; i < n && !legal; i++) legal = game_turn_equal(&turns[i], &t);
+                if (!legal) {
+                    printf("[FAIL] fuzz  round %d decoded a turn that is not legal\n", round);
+                    return 1;
+                }
+                turns_taken++;
+            }
+            if (f.opcode == OP_SYNC) proto_read_sync(&f, &seq, &s);
+            if (f.opcode == OP_CHAT) proto_read_chat(&f, text, sizeof(text));
+            if (f.opcode == OP_RESUME) proto_read_resume(&f, &seq, &hash);
+        }
+        bad_streams += r < 0;
+        if ((int32_t)(ring.head - ring.tail) < 0) {
+            printf("[FAIL] fuzz  round %d read past the data\n", round);
+            return 1;
+        }
+        if (n > 0) game_apply_turn(&g, &turns[rng_next(rng) % (uint64_t)n]);
+        else game_state_init(&g);
+    }
+    printf("[ OK ] fuzz        %d streams, %ld frames, %ld rejected streams, %ld turns accepted\n",
+           FUZZ_ROUNDS, frames, bad_streams, turns_taken);
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Host against stray clients
+// ---------------------------------------------------------------------------
+
+static int dial(unsigned short port) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd >= 0 && connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        fd = -1;
+    }
+    return fd;
+}
+
+static void pump(int ms) {
+    double end = clock_now() + ms / 1000.0;
+    while (clock_now() < end) {
+        p2p_update();
+        sleep_ms(1);
+    }
+}
+
+static void send_all(int fd, const void *data, int length) {
+    if (fd >= 0) send(fd, data, (size_t)length, 0);
+}
+
+// A client that says HELLO and RESUME from the opening, as a joiner does
+static int dial_joiner(unsigned short port) {
+    static ProtoOutbox out;
+    GameState g;
+    game_state_init(&g);
+    out.length = 0;
+    proto_put_hello(&out);
+    proto_put_resume(&out, OP_RESUME, 0, (uint32_t)g.hash);
+    int fd = dial(port);
+    send_all(fd, out.data, out.length);
+    return fd;
+}
+
+// Runs the host until fd receives a frame with this opcode
+static bool expect(int fd, int opcode) {
+    static ProtoRing ring;
+    proto_ring_reset(&ring);
+    double end = clock_now() + 1.0;
+    while (fd >= 0 && clock_now() < end) {
+        p2p_update();
+        int room;
+        uint8_t *space = proto_ring_space(&ring, &room);
+        ssize_t n = recv(fd, space, (size_t)room, MSG_DONTWAIT);
+        if (n > 0) proto_ring_commit(&ring, (int)n);
+        ProtoFrame f;
+        while (proto_next_frame(&ring, &f) == 1) {
+            if (f.opcode == opcode) return true;
+        }
+        sleep_ms(1);
+    }
+    return false;
+}
+
+static int stray(uint64_t *rng) {
+    static const char junk[] = "GET / HTTP/1.0\r\n\r\n";
+    unsigned short port = 0;
+    for (int i = 0; i < 8 && !port; i++) {
+        unsigned short p = (unsigned short)(40000 + rng_next(rng) % 20000);
+        if (p2p_host(p, NULL, NULL)) port = p;
+    }
+    if (!port) {
+        printf("[FAIL] stray       no free port\n");
+        return 1;
+    }
+    const char *failed = NULL;
+
+    // Before the peer: junk and silence leave the host waiting
+    int a = dial(port);
+    send_all(a, junk, (int)sizeof(junk) - 1);
+    pump(20);
+    if (p2p_get_status() != P2P_CONNECTING) failed = "junk before the peer";
+
+    int b = dial_joiner(port);
+    if (!failed && (!expect(b, OP_RESUMED) || p2p_get_status() != P2P_CONNECTED)) failed = "peer not taken";
+
+    // With the peer: neither junk nor a HELLO without RESUME replaces it
+    int c = dial(port);
+    send_all(c, junk, (int)sizeof(junk) - 1);
+    pump(20);
+    static ProtoOutbox out;
+    out.length = 0;
+    proto_put_hello(&out);
+    proto_put_chat(&out, "not a resume");
+    int d = dial(port);
+    send_all(d, out.data, out.length);
+    pump(20);
+    out.length = 0;
+    proto_put_ping(&out, OP_PING, 42);
+    send_all(b, out.data, out.length);
+    if (!failed && (!expect(b, OP_PONG) || p2p_get_status() != P2P_CONNECTED)) failed = "peer replaced";
+
+    // The peer itself sending junk loses its link, not the game
+    send_all(b, junk, (int)sizeof(junk) - 1);
+    pump(20);
+    if (!failed && p2p_get_status() != P2P_CONNECTING) failed = "bad frame ended the game";
+    int e = dial_joiner(port);
+    if (!failed && (!expect(e, OP_RESUMED) || p2p_get_status() != P2P_CONNECTED)) failed = "peer cannot come back";
+
+    int fds[] = { a, b, c, d, e };
+    for (int i = 0; i < 5; i++) if (fds[i] >= 0) close(fds[i]);
+    p2p_disconnect();
+    if (failed) printf("[FAIL] stray       %s\n", failed);
+    else printf("[ OK ] stray       junk, silent and half-open clients leave the game alone\n");
+    return failed ? 1 : 0;
+}
+
+static int run_suite(uint64_t seed) {
+    uint64_t rng = seed * 0x9E3779B97F4A7C15ULL | 1;
+    int failures = round_trip(&rng);
+    failures += fuzz(&rng);
+    failures += stray(&rng);
+    return failures ? 1 : 0;
+}
+
+static void usage(const char *prog) {
+    printf("Usage: %s --host PORT | --join HOST PORT | --suite [OPTIONS]\n", prog);
+    printf("Options:\n");
+    printf("  -p, --plies N     Turns to play (default 200)\n");
+    printf("  -d, --drop N      Joiner: reconnect after every N of its turns (default 0, never)\n");
+    printf("  -S, --seed N      Seed for this side's moves (default 1)\n");
+    printf("  -t, --timeout S   Give up after this many seconds (default 30)\n");
+    printf("  -s, --suite       Check the wire format over a socketpair and exit\n");
+    printf("  -h, --help        Show this help message\n");
+}
+
+int main(int argc, char *argv[]) {
+    const char *host = NULL;
+    int port = 0, plies = 200, drop = 0;
+    bool hosting = false, suite = false;
+    uint64_t seed = 1;
+    double timeout = 30.0;
+
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        if (!strcmp(a, "--host") && i + 1 < argc) {
+            hosting = true;
+            port = atoi(argv[++i]);
+        } else if (!strcmp(a, "--join") && i + 2 < argc) {
+            host = argv[++i];
+            port = atoi(argv[++i]);
+        } else if ((!strcmp(a, "-p") || !strcmp(a, "--plies")) && i + 1 < argc) {
+            plies = atoi(argv[++i]);
+        } else if ((!strcmp(a, "-d") || !strcmp(a, "--drop")) && i + 1 < argc) {
+            drop = atoi(argv[++i]);
+        } else if ((!strcmp(a, "-S") || !strcmp(a, "--seed")) && i + 1 < argc) {
+            seed = strtoull(argv[++i], NULL, 10);
+        } else if ((!strcmp(a, "-t") || !strcmp(a, "--timeout")) && i + 1 < argc) {
+            timeout = atof(argv[++i]);
+        } else if (!strcmp(a, "-s") || !strcmp(a, "--suite")) {
+            suite = true;
+        } else if (!strcmp(a, "-h") || !strcmp(a, "--help")) {
+            usage(argv[0]);
+            return 0;
+        } else {
+            printf("Unknown option: %s\n", a);
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (suite) return run_suite(seed);
+    if ((!hosting && !host) || port <= 0 || port > 65535 || seed == 0 || drop < 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    check.gm = game_manager_create();
+    if (!check.gm) return 1;
+    int side = hosting ? 1 : 2;
+    uint64_t rng = seed * 0x9E3779B97F4A7C15ULL | 1;
+    bool ok = hosting ? p2p_host((unsigned short)port, on_turn, on_status)
+                      : p2p_join(host, (unsigned short)port, on_turn, on_status);
+    p2p_set_chat_callback(on_chat);
+    p2p_set_sync_callback(on_sync);
+
+    bool sent_hash = false;
+    int mine = 0, drops = 0;
+    double t0 = clock_now(), slowest = 0.0;
+    while (ok && clock_now() - t0 < timeout) {
+        double u0 = clock_now();
+        p2p_update();
+        double u = clock_now() - u0;
+        if (u > slowest) slowest = u;
+
+        GameManager *gm = check.gm;
+        if (check.status == P2P_ERROR || check.desync) break;
+        if (check.status == P2P_DISCONNECTED && !check.peer_done) break;
+        if (check.status != P2P_CONNECTED && !sent_hash) {
+            sleep_ms(1);
+            continue;
+        }
+
+        bool over = gm->game_over || (gm->pending.length == 0 && check.turns >= plies);
+        if (!over && gm->state.current_player == side) {
+            play_turn(gm, &rng);
+            if (!hosting && drop > 0 && ++mine % drop == 0 && !gm->game_over && check.turns < plies) {
+                p2p_reconnect(); // whatever was still queued is lost with the link
+                drops++;
+            }
+        } else if (over && !sent_hash) {
+            char line[40];
+            snprintf(line, sizeof(line), "hash %016llx", (unsigned long long)gm->state.hash);
+            p2p_send_chat(line);
+            sent_hash = true;
+        } else if (sent_hash && check.peer_done) {
+            p2p_update(); // flush our hash
+            break;
+        } else {
+            sleep_ms(1);
+        }
+    }
+
+    GameManager *gm = check.gm;
+    bool same = check.peer_done && sent_hash && check.peer_hash == gm->state.hash && !check.desync;
+    printf("%d turns, hash %016llx, peer %016llx: %s (%d drops, %d syncs, slowest update %.3f ms, rtt %.3f ms)\n",
+           check.turns, (unsigned long long)gm->state.hash,
+           (unsigned long long)check.peer_hash,
+           same ? "in sync" : (check.desync ? "desync" : "no match"), drops, check.syncs, slowest * 1000.0,
+           p2p_get_rtt() * 1000.0);
+    // Give the last line a moment to leave before closing
+    for (int i = 0; i < 50 && p2p_get_status() == P2P_CONNECTED; i++) {
+        p2p_update();
+        sleep_ms(2);
+    }
+    p2p_disconnect();
+    game_manager_destroy(gm);
+    return same ? 0 : 1;
+}
@@ -0,0 +1,271 @@
+// fanorona-perft: move generator throughput and correctness harness.
+// Links only src/engine/ so it builds and runs without SDL.
+#define _POSIX_C_SOURCE 199309L
+#include "../engine/chain.h"
+#include "../engine/game_state.h"
+#include "../engine/notation.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define PERFT_MAX_DEPTH 16
+
+typedef struct {
+    const char *name;
+    const char *fen;
+    int depth;
+    unsigned long long nodes; // expected leaf count at `depth`
+} PerftCase;
+
+// White's centre stone stepping east can take the stone ahead of it by
+// approach or the one behind it by withdrawal, but not both
+#define CHOICE_FEN "B7B/2W3W2/3BW1B2/1W5B1/B3W3B w"
+
+// Reference counts: any change here means the rules engine changed
+static const PerftCase SUITE[] = {
+    { "opening",      FEN_OPENING,                                      5, 431852ULL },
+    { "open centre",  "BBBBBBBBB/BBBB1BBBB/BW2W2WB/WWWW1WWWW/WWWWWWWWW b", 4, 1939366ULL },
+    { "long chains",  "B1B1B1B1B/1W1W1W1W1/B1B1B1B1B/1W1W1W1W1/B1B1B1B1B w", 4, 52924ULL },
+    { "middlegame",   "BB2B1BB1/1B1BB2B1/B1W1W1B1W/2WW1W1W1/W1W2WW1W b", 4, 96631ULL },
+    { "endgame",      "4B4/9/2W3W2/9/1B5B1 w",                          6, 18676ULL },
+    { "either side",  CHOICE_FEN,                                       5, 13482ULL },
+};
+
+static Turn turn_buf[PERFT_MAX_DEPTH + 1][MAX_TURNS];
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Leaves are counted, not listed, so only inner nodes past MAX_TURNS turns
+// need the heap
+static unsigned long long perft(GameState *g, int depth) {
+    int n = chain_generate(g, turn_buf[depth], MAX_TURNS);
+    if (depth == 1) return (unsigned long long)n;
+
+    Turn *turns = n > MAX_TURNS ? chain_generate_all(g, turn_buf[depth], MAX_TURNS, &n) : turn_buf[depth];
+    if (!turns) return 0;
+    unsigned long long nodes = 0;
+    for (int i = 0; i < n; i++) {
+        Undo u;
+        game_make(g, &turns[i], &u);
+        nodes += perft(g, depth - 1);
+        game_unmake(g, &u);
+    }
+    if (turns != turn_buf[depth]) free(turns);
+    return nodes;
+}
+
+static unsigned long long run_divide(GameState *g, int depth) {
+    Turn buf[MAX_TURNS];
+    char name[TURN_STR_MAX];
+    unsigned long long total = 0;
+    int n;
+    Turn *turns = chain_generate_all(g, buf, MAX_TURNS, &n);
+    for (int i = 0; turns && i < n; i++) {
+        Undo u;
+        game_make(g, &turns[i], &u);
+        unsigned long long nodes = depth > 1 ? perft(g, depth - 1) : 1;
+        game_unmake(g, &u);
+        turn_to_string(&turns[i], name, sizeof(name));
+        printf("  %-24s %llu\n", name, nodes);
+        total += nodes;
+    }
+    printf("  %d turns, %llu nodes\n", n, total);
+    if (turns != buf) free(turns);
+    return total;
+}
+
+static void run_depths(GameState *g, int max_depth) {
+    for (int d = 1; d <= max_depth; d++) {
+        double t0 = now_seconds();
+        unsigned long long nodes = perft(g, d);
+        double dt = now_seconds() - t0;
+        printf("  depth %2d  %14llu nodes  %8.3f s  %12.0f nodes/s\n",
+               d, nodes, dt, dt > 0 ? nodes / dt : 0.0);
+    }
+}
+
+// A step that captures either way must be played with the choice made
+static int check_capture_choice(void) {
+    GameManager *gm = game_manager_create();
+    if (!gm) return 1;
+    Pos from = { 4, 2 }, to = { 5, 2 };
+    Bitboard ahead = BIT(POS_INDEX(6, 2)), behind = BIT(POS_INDEX(3, 2));
+    bool ok = game_from_fen(&gm->state, CHOICE_FEN) && game_move_valid(&gm->state, from, to) &&
+              !game_manager_make_move(gm, from, to, CAPTURE_NONE);
+
+    GameState start = gm->state;
+    ok = ok && game_manager_make_move(gm, from, to, CAPTURE_APPROACH) &&
+         gm->state.pieces[1] == (start.pieces[1] & ~ahead);
+    game_manager_undo_move(gm);
+    ok = ok && gm->state.hash == start.hash && game_manager_make_move(gm, from, to, CAPTURE_WITHDRAWAL) &&
+         gm->state.pieces[1] == (start.pieces[1] & ~behind);
+
+    int count = 0, both = 0;
+    gm->state = start;
+    gm->history.count = 0;
+    gm->game_over = false;
+    Move *moves = game_manager_get_valid_moves(gm, &count);
+    for (int i = 0; i < count; i++) {
+        both += moves[i].from.x == from.x && moves[i].from.y == from.y && moves[i].to.x == to.x && moves[i].to.y == to.y;
+    }
+    ok = ok && both == 2;
+    printf("[%s] %-12s approach and withdrawal from one step\n", ok ? " OK " : "FAIL", "capture choice");
+    game_manager_destroy(gm);
+    return ok ? 0 : 1;
+}
+
+static bool listed(const Turn *turns, int n, const Turn *t) {
+    for (int i = 0; i < n; i++) {
+        if (game_turn_equal(&turns[i], t)) return true;
+    }
+    return false;
+}
+
+// One position: a 4-turn buffer still gets the full count and the full
+// list, and the step-by-step check agrees with the list on every turn and
+// on turns one detail away from it
+static bool check_position(const GameState *g) {
+    static Turn full[MAX_TURNS];
+    Turn tiny[4];
+    int n = chain_generate(g, full, MAX_TURNS), m;
+    if (n > MAX_TURNS || chain_generate(g, tiny, 4) != n) return false;
+    Turn *all = chain_generate_all(g, tiny, 4, &m);
+    bool ok = all && m == n && (n > 4) == (all != tiny);
+    for (int i = 0; ok && i < n; i++) ok = game_turn_equal(&all[i], &full[i]);
+    if (all != tiny) free(all);
+
+    for (int i = 0; ok && i < n; i++) {
+        Turn t = full[i];
+        ok = chain_turn_legal(g, &t);
+        for (int k = 0; ok && k <= t.length; k++) {
+            Turn v = t;
+            if (k < t.length) v.withdrawals ^= 1u << k; // the other side of step k
+            else v.captured ^= v.captured & -v.captured; // one stone fewer
+            ok = chain_turn_legal(g, &v) == listed(full, n, &v);
+        }
+        if (ok && t.length > 1) {
+            Turn v = t; // cut short but keeping every capture
+            v.length--;
+            ok = chain_turn_legal(g, &v) == listed(full, n, &v);
+        }
+    }
+    return ok;
+}
+
+static int check_turn_lists(void) {
+    uint64_t rng = 0x2545F4914F6CDD1DULL;
+    int positions = 0, bad = 0;
+    for (int game = 0; game < 300 && !bad; game++) {
+        GameState g;
+        int winner;
+        game_state_init(&g);
+        for (int ply = 0; ply < 120 && !game_is_terminal(&g, &winner) && !bad; ply++) {
+            static Turn turns[MAX_TURNS];
+            bad += !check_position(&g);
+            positions++;
+            int n = chain_generate(&g, turns, MAX_TURNS);
+            rng ^= rng << 13;
+            rng ^= rng >> 7;
+            rng ^= rng << 17;
+            game_apply_turn(&g, &turns[rng % (uint64_t)n]);
+        }
+    }
+    printf("[%s] %-12s %d positions, counted past the buffer and checked turn by turn\n",
+           bad ? "FAIL" : " OK ", "turn lists", positions);
+    return bad ? 1 : 0;
+}
+
+static int run_suite(void) {
+    int failures = 0;
+    unsigned long long total = 0;
+    double t0 = now_seconds();
+
+    for (size_t i = 0; i < sizeof(SUITE) / sizeof(SUITE[0]); i++) {
+        const PerftCase *c = &SUITE[i];
+        GameState g;
+        if (!game_from_fen(&g, c->fen)) {
+            printf("[FAIL] %-12s bad position string\n", c->name);
+            failures++;
+            continue;
+        }
+        unsigned long long nodes = perft(&g, c->depth);
+        bool ok = nodes == c->nodes;
+        printf("[%s] %-12s depth %d  %llu nodes (expected %llu)\n",
+               ok ? " OK " : "FAIL", c->name, c->depth, nodes, c->nodes);
+        failures += !ok;
+        total += nodes;
+    }
+
+    failures += check_capture_choice();
+    failures += check_turn_lists();
+
+    double dt = now_seconds() - t0;
+    printf("%llu nodes in %.3f s, %.0f nodes/s, %d failure(s)\n",
+           total, dt, dt > 0 ? total / dt : 0.0, failures);
+    return failures ? 1 : 0;
+}
+
+static void usage(const char *prog) {
+    printf("Usage: %s [OPTIONS]\n", prog);
+    printf("Options:\n");
+    printf("  -d, --depth N     Search depth (default 5)\n");
+    printf("  -p, --pos FEN     Start from this position instead of the opening\n");
+    printf("  -D, --divide      Print node counts below each root turn\n");
+    printf("  -s, --suite       Check the reference positions and exit\n");
+    printf("  -h, --help        Show this help message\n");
+}
+
+int main(int argc, char *argv[]) {
+    int depth = 5;
+    bool divide = false;
+    const char *fen = FEN_OPENING;
+
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        if ((!strcmp(a, "-d") || !strcmp(a, "--depth")) && i + 1 < argc) {
+            depth = atoi(argv[++i]);
+        } else if ((!strcmp(a, "-p") || !strcmp(a, "--pos")) && i + 1 < argc) {
+            fen = argv[++i];
+        } else if (!strcmp(a, "-D") || !strcmp(a, "--divide")) {
+            divide = true;
+        } else if (!strcmp(a, "-s") || !strcmp(a, "--suite")) {
+            return run_suite();
+        } else if (!strcmp(a, "-h") || !strcmp(a, "--help")) {
+            usage(argv[0]);
+            return 0;
+        } else {
+            printf("Unknown option: %s\n", a);
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (depth < 1 || depth > PERFT_MAX_DEPTH) {
+        printf("Depth must be between 1 and %d\n", PERFT_MAX_DEPTH);
+        return 1;
+    }
+
+    GameState g;
+    if (!game_from_fen(&g, fen)) {
+        printf("Invalid position: %s\n", fen);
+        return 1;
+    }
+
+    char buf[FEN_MAX];
+    game_to_fen(&g, buf, sizeof(buf));
+    printf("Position: %s\n", buf);
+
+    if (divide) {
+        double t0 = now_seconds();
+        unsigned long long nodes = run_divide(&g, depth);
+        double dt = now_seconds() - t0;
+        printf("  %.3f s, %.0f nodes/s\n", dt, dt > 0 ? nodes / dt : 0.0);
+    } else {
+        run_depths(&g, depth);
+    }
+    return 0;
+}
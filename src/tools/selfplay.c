@@ -0,0 +1,474 @@
+// fanorona-selfplay: matches between two engine configurations.
+// Plays game pairs from the same random opening with colours swapped,
+// several games at once, logs every game and reports the Elo difference
+// of A over B with a 95% interval, and each engine's nodes per second.
+// With --smp N it instead times engine A to a fixed depth on N threads and
+// on one, position by position, and reports the speedup.
+#include "../ai/gnn_inference.h"
+#include "../ai/mcts.h"
+#include "../ai/minimax.h"
+#include "../ai/tablebase.h"
+#include "../core/clock.h"
+#include "../core/config.h"
+#include "../engine/chain.h"
+#include "../engine/notation.h"
+#include "../engine/record.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAX_GAMES   10000
+#define MAX_WORKERS 64
+
+typedef struct {
+    char     text[96];   // as given on the command line
+    AIEngine engine;
+    int      depth;      // alpha-beta only, 0 = no limit
+    double   time;       // seconds per move
+    MctsEval eval;
+    int      hash_mb;    // table or arena
+} EngineSpec;
+
+typedef struct {
+    const EngineSpec *spec;
+    TransTable       *tt;
+    Mcts             *mcts;
+} Player;
+
+typedef struct {
+    int      result;       // 1 = A won, 0 = draw, -1 = B won
+    int      plies;
+    uint64_t nodes[2];     // [0] = A, [1] = B
+    double   time[2];
+} GameRecord;
+
+typedef struct {
+    EngineSpec   specs[2];
+    int          games, max_plies, random_plies;
+    uint64_t     seed;
+    FILE        *log;
+    RecordWriter *record;    // binary copy of every game, optional
+    GameRecord   records[MAX_GAMES];
+    int          next_game;  // taken atomically
+    int          finished;
+    pthread_mutex_t lock;    // log, console and finished
+} Match;
+
+static bool parse_spec(const char *text, EngineSpec *s) {
+    memset(s, 0, sizeof(EngineSpec));
+    snprintf(s->text, sizeof(s->text), "%s", text);
+    s->time = 0.1;
+    s->hash_mb = 16;
+
+    char buf[96];
+    snprintf(buf, sizeof(buf), "%s", text);
+    char *opts = strchr(buf, ':');
+    if (opts) *opts++ = '\0';
+    if (!strcmp(buf, "mcts")) s->engine = AI_ENGINE_MCTS;
+    else if (strcmp(buf, "minimax")) return false;
+
+    for (char *kv = opts ? strtok(opts, ",") : NULL; kv; kv = strtok(NULL, ",")) {
+        if (!strncmp(kv, "depth=", 6)) s->depth = atoi(kv + 6);
+        else if (!strncmp(kv, "time=", 5)) s->time = atof(kv + 5);
+        else if (!strncmp(kv, "hash=", 5)) s->hash_mb = atoi(kv + 5);
+        else if (!strcmp(kv, "eval=nn")) s->eval = MCTS_EVAL_NETWORK;
+        else if (!strcmp(kv, "eval=playout")) s->eval = MCTS_EVAL_PLAYOUT;
+        else return false;
+    }
+    return s->time > 0 || (s->engine == AI_ENGINE_MINIMAX && s->depth > 0);
+}
+
+static bool player_init(Player *p, const EngineSpec *spec) {
+    memset(p, 0, sizeof(Player));
+    p->spec = spec;
+    if (spec->engine == AI_ENGINE_MCTS) p->mcts = mcts_create((size_t)spec->hash_mb);
+    else p->tt = tt_create((size_t)spec->hash_mb);
+    return p->mcts || p->tt;
+}
+
+static void player_free(Player *p) {
+    tt_destroy(p->tt);
+    mcts_destroy(p->mcts);
+}
+
+static bool player_think(Player *p, const GameState *g, SearchResult *r) {
+    SearchLimits lim;
+    memset(&lim, 0, sizeof(lim));
+    lim.max_depth = p->spec->depth;
+    lim.time_limit = p->spec->time;
+    lim.threads = 1; // games run in parallel instead
+    lim.tt = p->tt;
+    if (p->mcts) return mcts_search(p->mcts, g, &lim, p->spec->eval, r);
+    return minimax_search(g, &lim, r);
+}
+
+static uint64_t rng_next(uint64_t *s) {
+    *s ^= *s << 13;
+    *s ^= *s >> 7;
+    *s ^= *s << 17;
+    return *s;
+}
+
+// Game 2k and 2k + 1 share an opening; A has white in the even game
+static void play_game(Match *m, int index, Player players[2], char *moves, size_t moves_size,
+                      Turn *played) {
+    static const char *names[2] = { "A", "B" };
+    GameRecord *rec = &m->records[index];
+    GameState g;
+    Turn turns[MAX_TURNS];
+    uint64_t rng = m->seed + 0x9E3779B97F4A7C15ULL * (uint64_t)(index / 2 + 1);
+    int white = index % 2; // engine playing white
+    size_t used = 0;
+
+    game_state_init(&g);
+    tt_clear(players[0].tt);
+    tt_clear(players[1].tt);
+    mcts_clear(players[0].mcts);
+    mcts_clear(players[1].mcts);
+    memset(rec, 0, sizeof(GameRecord));
+    moves[0] = '\0';
+
+    const char *reason = "max plies";
+    for (rec->plies = 0; rec->plies < m->max_plies; rec->plies++) {
+        int n = chain_generate(&g, turns, MAX_TURNS);
+        if (n > MAX_TURNS) n = MAX_TURNS;
+        int mover = (g.current_player == 1) ? white : white ^ 1;
+        if (n == 0) {
+            rec->result = mover == 0 ? -1 : 1;
+            reason = "no moves";
+            break;
+        }
+        int winner;
+        if (tb_game_result(&g, &winner)) {
+            int winning = winner == 1 ? white : white ^ 1; // engine
+            rec->result = winner == 0 ? 0 : (winning == 0 ? 1 : -1);
+            reason = "tablebase";
+            break;
+        }
+
+        Turn t;
+        double ms = 0;
+        uint64_t nodes = 0;
+        if (rec->plies < m->random_plies) {
+            t = turns[rng_next(&rng) % (uint64_t)n];
+        } else {
+            SearchResult r;
+            if (!player_think(&players[mover], &g, &r) || !r.has_move) {
+                rec->result = mover == 0 ? -1 : 1;
+                reason = "no result";
+                break;
+            }
+            t = r.best;
+            ms = r.elapsed * 1000.0;
+            nodes = r.nodes;
+            rec->nodes[mover] += r.nodes;
+            rec->time[mover] += r.elapsed;
+        }
+
+        // turn:ms:nodes, space separated
+        char name[TURN_STR_MAX];
+        turn_to_string(&t, name, sizeof(name));
+        int w = snprintf(moves + used, moves_size - used, "%s%s:%.0f:%llu",
+                         used ? " " : "", name, ms, (unsigned long long)nodes);
+        if (w > 0 && (size_t)w < moves_size - used) used += (size_t)w;
+        played[rec->plies] = t;
+        game_apply_turn(&g, &t);
+    }
+
+    const char *score = rec->result == 0 ? "1/2-1/2" : ((rec->result == 1) == (white == 0) ? "1-0" : "0-1");
+    pthread_mutex_lock(&m->lock);
+    m->finished++;
+    if (m->log) {
+        fprintf(m->log, "game %d white=%s result=%s plies=%d end=\"%s\"\n%s\n",
+                index + 1, names[white], score, rec->plies, reason, moves);
+        fflush(m->log);
+    }
+    if (m->record) {
+        GameState start;
+        game_state_init(&start);
+        record_begin(m->record, &start);
+        for (int i = 0; i < rec->plies; i++) record_turn(m->record, &played[i]);
+        record_end(m->record, rec->result == 0 ? RECORD_DRAW :
+                   (score[0] == '1' ? RECORD_WHITE_WINS : RECORD_BLACK_WINS));
+    }
+    printf("[%d/%d] game %d: %s (white %s) %s after %d plies\n", m->finished, m->games,
+           index + 1, score, names[white], rec->result == 0 ? "draw" : (rec->result > 0 ? "A wins" : "B wins"),
+           rec->plies);
+    fflush(stdout);
+    pthread_mutex_unlock(&m->lock);
+}
+
+static void *worker_main(void *arg) {
+    Match *m = arg;
+    Player players[2];
+    size_t moves_size = (size_t)m->max_plies * (TURN_STR_MAX + 24);
+    char *moves = malloc(moves_size);
+    Turn *played = malloc((size_t)m->max_plies * sizeof(Turn));
+    bool ok = moves && played && player_init(&players[0], &m->specs[0]);
+    if (ok && !player_init(&players[1], &m->specs[1])) {
+        player_free(&players[0]);
+        ok = false;
+    }
+    if (!ok) {
+        free(moves);
+        free(played);
+        return NULL;
+    }
+
+    for (;;) {
+        int index = __atomic_fetch_add(&m->next_game, 1, __ATOMIC_RELAXED);
+        if (index >= m->games) break;
+        play_game(m, index, players, moves, moves_size, played);
+    }
+    player_free(&players[0]);
+    player_free(&players[1]);
+    free(moves);
+    free(played);
+    return NULL;
+}
+
+// Unbounded at a score of 0 or 1: printed as -inf or +inf
+static double elo_from_score(double p) {
+    if (p <= 0.0) return -INFINITY;
+    if (p >= 1.0) return INFINITY;
+    return -400.0 * log10(1.0 / p - 1.0);
+}
+
+static double game_score(const GameRecord *r) {
+    return r->result > 0 ? 1.0 : r->result < 0 ? 0.0 : 0.5;
+}
+
+static void report(const Match *m, double wall) {
+    int wins = 0, draws = 0, losses = 0;
+    uint64_t nodes[2] = { 0, 0 };
+    double time[2] = { 0, 0 };
+    for (int i = 0; i < m->games; i++) {
+        const GameRecord *r = &m->records[i];
+        if (r->result > 0) wins++;
+        else if (r->result < 0) losses++;
+        else draws++;
+        for (int k = 0; k < 2; k++) {
+            nodes[k] += r->nodes[k];
+            time[k] += r->time[k];
+        }
+    }
+
+    // The two games of a pair share their opening, so the pair is the
+    // independent sample; an unpaired last game only counts in the score
+    int n = m->games, pairs = n / 2;
+    double p = (wins + 0.5 * draws) / n, pair_p = 0.0, var = 0.0;
+    for (int k = 0; k < pairs; k++) {
+        pair_p += (game_score(&m->records[2 * k]) + game_score(&m->records[2 * k + 1])) / 2.0;
+    }
+    if (pairs > 0) pair_p /= pairs;
+    for (int k = 0; k < pairs; k++) {
+        double d = (game_score(&m->records[2 * k]) + game_score(&m->records[2 * k + 1])) / 2.0 - pair_p;
+        var += d * d;
+    }
+    if (pairs > 1) var /= pairs - 1;
+    double margin = pairs > 1 ? 1.96 * sqrt(var / pairs) : 0.0;
+    printf("\nA: %s\nB: %s\n", m->specs[0].text, m->specs[1].text);
+    printf("%d games: +%d =%d -%d for A, score %.1f%%\n", n, wins, draws, losses, 100.0 * p);
+    if (margin > 0.0) {
+        printf("Elo A - B: %+.0f  (95%%: %+.0f .. %+.0f over %d pairs)\n", elo_from_score(p),
+               elo_from_score(pair_p - margin), elo_from_score(pair_p + margin), pairs);
+    } else {
+        printf("Elo A - B: %+.0f  (no interval: too few pairs, or all alike)\n", elo_from_score(p));
+    }
+    for (int k = 0; k < 2; k++) {
+        printf("%s: %llu nodes in %.1f s, %.0f nodes/s\n", k ? "B" : "A",
+               (unsigned long long)nodes[k], time[k], time[k] > 0 ? nodes[k] / time[k] : 0.0);
+    }
+    printf("Wall time %.1f s\n", wall);
+}
+
+// Time to the deepest iteration both runs completed, each from an empty table
+static double time_to_depth(const EngineSpec *spec, TransTable *tt, const GameState *g, int threads,
+                            SearchResult *r) {
+    SearchLimits lim;
+    memset(&lim, 0, sizeof(lim));
+    lim.max_depth = spec->depth > 0 ? spec->depth : 8;
+    lim.threads = threads;
+    lim.tt = tt;
+    tt_clear(tt);
+    if (!minimax_search(g, &lim, r)) return -1.0;
+    return r->elapsed;
+}
+
+// Lazy SMP speedup: time to depth on `threads` threads over one thread,
+// geometric mean over m->games random positions
+static int smp_bench(const Match *m, int threads) {
+    const EngineSpec *spec = &m->specs[0];
+    if (spec->engine != AI_ENGINE_MINIMAX) {
+        printf("--smp times engine A, which must be minimax\n");
+        return 1;
+    }
+    TransTable *tt = tt_create((size_t)spec->hash_mb);
+    if (!tt) {
+        printf("Out of memory\n");
+        return 1;
+    }
+    printf("%s to depth %d, 1 thread against %d:\n", spec->text, spec->depth > 0 ? spec->depth : 8, threads);
+
+    Turn turns[MAX_TURNS];
+    uint64_t thread_nodes[SEARCH_MAX_THREADS] = { 0 };
+    double log_sum = 0.0;
+    int measured = 0, used = 1;
+    for (int k = 0; k < m->games; k++) {
+        uint64_t rng = m->seed + 0x9E3779B97F4A7C15ULL * (uint64_t)(k + 1);
+        GameState g;
+        game_state_init(&g);
+        int plies = m->random_plies + 4 + k % 8, winner;
+        for (int i = 0; i < plies && !game_is_terminal(&g, &winner); i++) {
+            int n = chain_generate(&g, turns, MAX_TURNS);
+            if (n > MAX_TURNS) n = MAX_TURNS;
+            game_apply_turn(&g, &turns[rng_next(&rng) % (uint64_t)n]);
+        }
+        if (game_is_terminal(&g, &winner)) continue;
+
+        SearchResult one, many;
+        if (time_to_depth(spec, tt, &g, 1, &one) < 0 || time_to_depth(spec, tt, &g, threads, &many) < 0) continue;
+        // A won position can end one run early
+        int depth = one.depth < many.depth ? one.depth : many.depth;
+        if (depth < 1 || many.depth_time[depth] <= 0.0) continue;
+        double t1 = one.depth_time[depth], tn = many.depth_time[depth];
+        printf("  position %2d  depth %2d  %8.3f s  %8.3f s  x%.2f\n", k, depth, t1, tn, t1 / tn);
+        log_sum += log(t1 / tn);
+        measured++;
+        used = many.threads;
+        for (int i = 0; i < many.threads; i++) thread_nodes[i] += many.thread_nodes[i];
+    }
+    tt_destroy(tt);
+    if (measured == 0) {
+        printf("No position could be timed\n");
+        return 1;
+    }
+    printf("Speedup on %d thread(s): x%.2f (geometric mean of %d positions)\n", used, exp(log_sum / measured),
+           measured);
+    for (int i = 0; i < used; i++) {
+        printf("  thread %2d: %llu nodes\n", i, (unsigned long long)thread_nodes[i]);
+    }
+    return 0;
+}
+
+static void usage(const char *prog) {
+    printf("Usage: %s [OPTIONS]\n", prog);
+    printf("Options:\n");
+    printf("  -a, --engine-a SPEC   First engine (default minimax:time=0.1)\n");
+    printf("  -b, --engine-b SPEC   Second engine (default mcts:time=0.1)\n");
+    printf("  -g, --games N         Number of games, best even (default 20)\n");
+    printf("  -j, --jobs N          Games played at once, 0 = one per core (default 0)\n");
+    printf("  -m, --max-plies N     Draw after this many plies (default 200)\n");
+    printf("  -r, --random N        Random opening plies (default 2)\n");
+    printf("  -w, --weights FILE    Network for eval=nn\n");
+    printf("  -T, --tablebases DIR  Endgame tables for both engines; games end once covered\n");
+    printf("  -o, --log FILE        Game log (default selfplay.log)\n");
+    printf("  -R, --record FILE     Also append the games to a binary record\n");
+    printf("  -S, --seed N          Seed for openings (default 1)\n");
+    printf("  -P, --smp N           Time engine A to depth on N threads and on 1 over -g positions, then exit\n");
+    printf("  -h, --help            Show this help message\n");
+    printf("SPEC: minimax|mcts[:depth=N,time=S,hash=MB,eval=playout|nn]\n");
+}
+
+int main(int argc, char *argv[]) {
+    static Match m;
+    const char *spec_a = "minimax:time=0.1", *spec_b = "mcts:time=0.1";
+    const char *weights = NULL, *tables = NULL, *log_path = "selfplay.log";
+    const char *record_path = NULL;
+    int jobs = 0, smp = 0;
+
+    m.games = 20;
+    m.max_plies = 200;
+    m.random_plies = 2;
+    m.seed = 1;
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        bool has_arg = i + 1 < argc;
+        if ((!strcmp(a, "-a") || !strcmp(a, "--engine-a")) && has_arg) spec_a = argv[++i];
+        else if ((!strcmp(a, "-b") || !strcmp(a, "--engine-b")) && has_arg) spec_b = argv[++i];
+        else if ((!strcmp(a, "-g") || !strcmp(a, "--games")) && has_arg) m.games = atoi(argv[++i]);
+        else if ((!strcmp(a, "-j") || !strcmp(a, "--jobs")) && has_arg) jobs = atoi(argv[++i]);
+        else if ((!strcmp(a, "-m") || !strcmp(a, "--max-plies")) && has_arg) m.max_plies = atoi(argv[++i]);
+        else if ((!strcmp(a, "-r") || !strcmp(a, "--random")) && has_arg) m.random_plies = atoi(argv[++i]);
+        else if ((!strcmp(a, "-w") || !strcmp(a, "--weights")) && has_arg) weights = argv[++i];
+        else if ((!strcmp(a, "-T") || !strcmp(a, "--tablebases")) && has_arg) tables = argv[++i];
+        else if ((!strcmp(a, "-R") || !strcmp(a, "--record")) && has_arg) record_path = argv[++i];
+        else if ((!strcmp(a, "-o") || !strcmp(a, "--log")) && has_arg) log_path = argv[++i];
+        else if ((!strcmp(a, "-S") || !strcmp(a, "--seed")) && has_arg) m.seed = strtoull(argv[++i], NULL, 10);
+        else if ((!strcmp(a, "-P") || !strcmp(a, "--smp")) && has_arg) smp = atoi(argv[++i]);
+        else if (!strcmp(a, "-h") || !strcmp(a, "--help")) {
+            usage(argv[0]);
+            return 0;
+        } else {
+            printf("Unknown option: %s\n", a);
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!parse_spec(spec_a, &m.specs[0]) || !parse_spec(spec_b, &m.specs[1])) {
+        printf("Invalid engine specification\n");
+        usage(argv[0]);
+        return 1;
+    }
+    if (m.games < 1 || m.games > MAX_GAMES || m.max_plies < 1 || m.random_plies < 0 || m.seed == 0) {
+        printf("Games must be between 1 and %d, plies positive and the seed non-zero\n", MAX_GAMES);
+        return 1;
+    }
+    if (weights && !gnn_load(weights)) {
+        printf("Cannot load weights: %s\n", weights);
+        return 1;
+    }
+    if (tables && !tb_init(tables)) {
+        printf("No endgame tables in %s\n", tables);
+        return 1;
+    }
+    if (smp > 0) {
+        int status = smp_bench(&m, smp);
+        tb_free();
+        return status;
+    }
+
+    m.log = fopen(log_path, "w");
+    if (!m.log) {
+        printf("Cannot write log: %s\n", log_path);
+        return 1;
+    }
+    if (record_path && !(m.record = record_writer_open(record_path))) {
+        printf("Cannot write record: %s\n", record_path);
+        fclose(m.log);
+        return 1;
+    }
+    fprintf(m.log, "# fanorona-selfplay A=%s B=%s games=%d max_plies=%d random=%d seed=%llu\n",
+            m.specs[0].text, m.specs[1].text, m.games, m.max_plies, m.random_plies,
+            (unsigned long long)m.seed);
+    fprintf(m.log, "# each game: header line, then turn:ms:nodes for every ply\n");
+    pthread_mutex_init(&m.lock, NULL);
+
+    if (jobs <= 0) jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (jobs > m.games) jobs = m.games;
+    if (jobs > MAX_WORKERS) jobs = MAX_WORKERS;
+    if (jobs < 1) jobs = 1;
+
+    double t0 = clock_now();
+    pthread_t threads[MAX_WORKERS];
+    int started = 0;
+    while (started < jobs && pthread_create(&threads[started], NULL, worker_main, &m) == 0) started++;
+    if (started == 0) worker_main(&m);
+    for (int i = 0; i < started; i++) pthread_join(threads[i], NULL);
+
+    if (m.finished < m.games) {
+        printf("Only %d of %d games were played (out of memory?)\n", m.finished, m.games);
+        m.games = m.finished;
+    }
+    if (m.games > 0) report(&m, clock_now() - t0);
+    fclose(m.log);
+    record_writer_close(m.record);
+    pthread_mutex_destroy(&m.lock);
+    gnn_unload();
+    tb_free();
+    printf("Log written to %s\n", log_path);
+    return 0;
+}
@@ -0,0 +1,127 @@
+// fanorona-server: headless match server for online play.
+//   fanorona-server -p 7777 -c 300 -l games.log
+// Prints a summary line every few seconds; with -l, appends one line per
+// finished game with its counters. Stops cleanly on Ctrl-C.
+#define _POSIX_C_SOURCE 200112L
+#include "../core/clock.h"
+#include "../net/server.h"
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+static volatile sig_atomic_t stop;
+
+static void on_signal(int sig) {
+    (void)sig;
+    stop = 1;
+}
+
+static const char *END_NAMES[] = { "rules", "time", "abandon", "turn-limit" };
+
+static void on_finished(const MatchStats *st, int winner, ProtoEnd reason, void *user) {
+    FILE *log = user;
+    if (!log) return;
+    double length = st->ended - st->started;
+    fprintf(log, "game %llu winner %d %s turns %d rejected %d time %.2f s turns/s %.1f "
+            "latency avg %.3f ms max %.3f ms bytes in %llu out %llu\n",
+            (unsigned long long)st->id, winner, END_NAMES[reason], st->turns, st->rejected, length,
+            length > 0 ? st->turns / length : 0.0,
+            st->turns ? st->latency_sum / st->turns * 1000.0 : 0.0, st->latency_max * 1000.0,
+            (unsigned long long)st->bytes_in, (unsigned long long)st->bytes_out);
+}
+
+// Thousands of sockets need more than the usual 1024 descriptors
+static void raise_fd_limit(void) {
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+}
+
+static void usage(const char *prog) {
+    printf("Usage: %s [OPTIONS]\n", prog);
+    printf("Options:\n");
+    printf("  -p, --port N       Port to listen on (default 7777)\n");
+    printf("  -c, --clock S      Seconds per player per game (default 600)\n");
+    printf("  -m, --max-turns N  Draw after this many turns, 0 = no limit (default 1000)\n");
+    printf("  -i, --interval S   Seconds between summary lines, 0 = none (default 5)\n");
+    printf("  -l, --log FILE     Append one line per finished game\n");
+    printf("  -h, --help         Show this help message\n");
+}
+
+int main(int argc, char *argv[]) {
+    int port = 7777, max_turns = 1000;
+    double clock_seconds = 600.0, interval = 5.0;
+    const char *log_path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        bool has_arg = i + 1 < argc;
+        if ((!strcmp(a, "-p") || !strcmp(a, "--port")) && has_arg) port = atoi(argv[++i]);
+        else if ((!strcmp(a, "-c") || !strcmp(a, "--clock")) && has_arg) clock_seconds = atof(argv[++i]);
+        else if ((!strcmp(a, "-m") || !strcmp(a, "--max-turns")) && has_arg) max_turns = atoi(argv[++i]);
+        else if ((!strcmp(a, "-i") || !strcmp(a, "--interval")) && has_arg) interval = atof(argv[++i]);
+        else if ((!strcmp(a, "-l") || !strcmp(a, "--log")) && has_arg) log_path = argv[++i];
+        else if (!strcmp(a, "-h") || !strcmp(a, "--help")) {
+            usage(argv[0]);
+            return 0;
+        } else {
+            printf("Unknown option: %s\n", a);
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (port <= 0 || port > 65535 || clock_seconds <= 0 || max_turns < 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    FILE *log = NULL;
+    if (log_path && !(log = fopen(log_path, "a"))) {
+        printf("Cannot open %s\n", log_path);
+        return 1;
+    }
+    raise_fd_limit();
+    Server *server = server_create((unsigned short)port, clock_seconds, max_turns);
+    if (!server) {
+        printf("Cannot listen on port %d\n", port);
+        if (log) fclose(log);
+        return 1;
+    }
+    server_set_finish_callback(server, on_finished, log);
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    printf("Listening on port %d, %.0f s per player\n", port, clock_seconds);
+
+    ServerStats last;
+    server_get_stats(server, &last);
+    double t_last = clock_now();
+    bool ok = true;
+    while (ok && !stop) {
+        ok = server_poll(server, 10); // also the resolution of the clocks
+        double now = clock_now();
+        if (interval <= 0 || now - t_last < interval) continue;
+
+        ServerStats st;
+        server_get_stats(server, &st);
+        double dt = now - t_last;
+        uint64_t turns = st.turns - last.turns;
+        printf("%d clients, %d games, %llu finished | %.0f turns/s, %.1f KB/s in, %.1f KB/s out | "
+               "latency avg %.3f ms max %.3f ms | %llu rejected\n",
+               st.clients, st.matches, (unsigned long long)st.matches_finished, turns / dt,
+               (st.bytes_in - last.bytes_in) / dt / 1024.0, (st.bytes_out - last.bytes_out) / dt / 1024.0,
+               turns ? (st.latency_sum - last.latency_sum) / turns * 1000.0 : 0.0, st.latency_max * 1000.0,
+               (unsigned long long)st.rejected);
+        fflush(stdout);
+        if (log) fflush(log);
+        last = st;
+        t_last = now;
+    }
+
+    server_destroy(server);
+    if (log) fclose(log);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,219 @@
+// fanorona-tbgen: builds the endgame tables up to N stones.
+// Splits are solved in order of total stones so every capture leads to a
+// table that is already complete. Within a split, pass k settles the
+// positions whose result is decided in exactly k plies: a win when some
+// turn reaches a loss in k - 1, a loss when every turn reaches a win in
+// at most k - 1. Captures take whole lines and chains fork at every
+// step, so turns are generated forward rather than unmade. A pass only
+// reads values of distance below k and only writes distance k, so the
+// threads share one array and the output does not depend on their number.
+#define _POSIX_C_SOURCE 200112L
+#include "../ai/tablebase.h"
+#include "../core/clock.h"
+#include "../engine/chain.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAX_THREADS 64
+
+static uint8_t *values[TB_MAX_PIECES][TB_MAX_PIECES]; // [white][black], both sides to move
+static uint64_t half[TB_MAX_PIECES][TB_MAX_PIECES];   // positions per side to move
+static int      longest[TB_MAX_PIECES][TB_MAX_PIECES]; // largest distance, in plies
+
+typedef struct {
+    pthread_t thread;
+    int       white, black, level;
+    uint64_t  begin, end;
+    uint64_t  changed;
+} Slice;
+
+// Value of a position for its side to move, as far as it is known
+static uint8_t child_value(Bitboard white, Bitboard black, int mover) {
+    if (!(mover ? black : white)) return TB_LOSS(0);
+    int nw = bb_count(white), nb = bb_count(black);
+    uint64_t i = tb_index(white, black) + (mover ? half[nw][nb] : 0);
+    return __atomic_load_n(&values[nw][nb][i], __ATOMIC_RELAXED);
+}
+
+static void *run_slice(void *arg) {
+    Slice *s = arg;
+    uint8_t *v = values[s->white][s->black];
+    uint64_t n = half[s->white][s->black];
+    Turn buf[MAX_TURNS];
+
+    for (uint64_t i = s->begin; i < s->end; i++) {
+        if (__atomic_load_n(&v[i], __ATOMIC_RELAXED) != TB_DRAW) continue;
+
+        GameState g;
+        memset(&g, 0, sizeof(g));
+        tb_position(i % n, s->white, s->black, &g.pieces[0], &g.pieces[1]);
+        g.current_player = i < n ? 1 : 2;
+        int side = g.current_player - 1;
+
+        // Every turn counts here, however many there are
+        int count;
+        Turn *turns = chain_generate_all(&g, buf, MAX_TURNS, &count);
+        if (!turns) {
+            printf("Out of memory\n");
+            exit(1);
+        }
+        bool all_won = true;
+        uint8_t result = TB_DRAW;
+        for (int k = 0; k < count; k++) {
+            const Turn *t = &turns[k];
+            Bitboard next[2];
+            next[side] = g.pieces[side] ^ BIT(t->path[0]) ^ BIT(t->path[t->length]);
+            next[side ^ 1] = g.pieces[side ^ 1] & ~t->captured;
+            uint8_t c = child_value(next[0], next[1], side ^ 1);
+            if (TB_IS_LOSS(c) && TB_DISTANCE(c) < s->level) {
+                result = TB_WIN(s->level);
+                break;
+            }
+            if (c == TB_DRAW || TB_IS_LOSS(c) || TB_DISTANCE(c) >= s->level) all_won = false;
+        }
+        if (turns != buf) free(turns);
+        if (result == TB_DRAW && all_won) result = TB_LOSS(s->level);
+        if (result != TB_DRAW) {
+            __atomic_store_n(&v[i], result, __ATOMIC_RELAXED);
+            s->changed++;
+        }
+    }
+    return NULL;
+}
+
+// One pass over both sides to move; returns how many positions it settled
+static uint64_t run_pass(int white, int black, int level, int threads) {
+    Slice slices[MAX_THREADS];
+    uint64_t total = 2 * half[white][black];
+    for (int t = 0; t < threads; t++) {
+        slices[t].white = white;
+        slices[t].black = black;
+        slices[t].level = level;
+        slices[t].begin = total * (uint64_t)t / (uint64_t)threads;
+        slices[t].end = total * (uint64_t)(t + 1) / (uint64_t)threads;
+        slices[t].changed = 0;
+    }
+
+    // Slices whose thread did not start run on the caller
+    int started = 1;
+    while (started < threads && pthread_create(&slices[started].thread, NULL, run_slice, &slices[started]) == 0) {
+        started++;
+    }
+    for (int t = started; t < threads; t++) run_slice(&slices[t]);
+    run_slice(&slices[0]);
+
+    uint64_t changed = 0;
+    for (int t = 0; t < threads; t++) {
+        if (t > 0 && t < started) pthread_join(slices[t].thread, NULL);
+        changed += slices[t].changed;
+    }
+    return changed;
+}
+
+static bool solve(int white, int black, int threads, const char *dir) {
+    double t0 = clock_now();
+    half[white][black] = tb_positions(white, black);
+    uint64_t total = 2 * half[white][black];
+    values[white][black] = calloc((size_t)total, 1);
+    if (!values[white][black]) {
+        printf("w%db%d: out of memory\n", white, black);
+        return false;
+    }
+
+    // Captures reach smaller tables, whose longest results can still
+    // settle positions here one ply later
+    int level = 0, lower = 0;
+    for (int w = 1; w <= white; w++) {
+        for (int b = 1; b <= black; b++) {
+            if ((w != white || b != black) && longest[w][b] > lower) lower = longest[w][b];
+        }
+    }
+    for (;; level++) {
+        if (level > TB_MAX_DISTANCE) {
+            printf("w%db%d: distance above %d\n", white, black, TB_MAX_DISTANCE);
+            return false;
+        }
+        uint64_t changed = run_pass(white, black, level, threads);
+        if (changed == 0 && level > lower + 1) break;
+    }
+
+    uint64_t wins = 0, losses = 0, draws = 0;
+    int max_distance = 0;
+    const uint8_t *v = values[white][black];
+    for (uint64_t i = 0; i < total; i++) {
+        if (v[i] == TB_DRAW) draws++;
+        else if (TB_IS_LOSS(v[i])) losses++;
+        else wins++;
+        if (TB_DISTANCE(v[i]) > max_distance) max_distance = TB_DISTANCE(v[i]);
+    }
+    longest[white][black] = max_distance;
+
+    char path[512];
+    snprintf(path, sizeof(path), "%s/w%db%d.fntb", dir, white, black);
+    if (!tb_write(path, white, black, v)) {
+        printf("Cannot write %s\n", path);
+        return false;
+    }
+    printf("w%db%d: %llu positions, %llu wins, %llu losses, %llu draws, longest %d plies, "
+           "%d passes, %.1f s\n",
+           white, black, (unsigned long long)total, (unsigned long long)wins,
+           (unsigned long long)losses, (unsigned long long)draws, max_distance, level + 1,
+           clock_now() - t0);
+    fflush(stdout);
+    return true;
+}
+
+static void usage(const char *prog) {
+    printf("Usage: %s [OPTIONS]\n", prog);
+    printf("Options:\n");
+    printf("  -n, --pieces N      Largest number of stones, 2 to %d (default 4)\n", TB_MAX_PIECES);
+    printf("  -d, --dir DIR       Output directory, must exist (default tb)\n");
+    printf("  -j, --jobs N        Threads, 0 = one per core (default 0)\n");
+    printf("  -h, --help          Show this help message\n");
+}
+
+int main(int argc, char *argv[]) {
+    const char *dir = "tb";
+    int pieces = 4, threads = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        bool has_arg = i + 1 < argc;
+        if ((!strcmp(a, "-n") || !strcmp(a, "--pieces")) && has_arg) pieces = atoi(argv[++i]);
+        else if ((!strcmp(a, "-d") || !strcmp(a, "--dir")) && has_arg) dir = argv[++i];
+        else if ((!strcmp(a, "-j") || !strcmp(a, "--jobs")) && has_arg) threads = atoi(argv[++i]);
+        else if (!strcmp(a, "-h") || !strcmp(a, "--help")) {
+            usage(argv[0]);
+            return 0;
+        } else {
+            printf("Unknown option: %s\n", a);
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (pieces < 2 || pieces > TB_MAX_PIECES) {
+        printf("Stones must be between 2 and %d\n", TB_MAX_PIECES);
+        return 1;
+    }
+    if (threads <= 0) threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads > MAX_THREADS) threads = MAX_THREADS;
+    if (threads < 1) threads = 1;
+
+    double t0 = clock_now();
+    bool ok = true;
+    for (int n = 2; ok && n <= pieces; n++) {
+        for (int white = n - 1; ok && white >= 1; white--) {
+            ok = solve(white, n - white, threads, dir);
+        }
+    }
+    for (int w = 0; w < TB_MAX_PIECES; w++) {
+        for (int b = 0; b < TB_MAX_PIECES; b++) free(values[w][b]);
+    }
+    if (!ok) return 1;
+    printf("Tables up to %d stones written to %s/ in %.1f s, %d threads\n",
+           pieces, dir, clock_now() - t0, threads);
+    return 0;
+}
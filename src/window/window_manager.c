@@ -236,6 +236,7 @@ GameWindow *wm_create_window(WindowManager *wm, WindowType type, const char *tit
     win->width = w;
     win->height = h;
     win->visible = true;
+    win->damaged = true;
     win->has_rounded_corners = use_rounded_corners;  // Toujours true
     win->corner_radius = use_corner_radius;          // Utilise le rayon par défaut ou fourni
     strncpy(win->title, title, sizeof(win->title) - 1);
@@ -287,6 +288,7 @@ void wm_show_window(WindowManager *wm, WindowType type) {
     if (win && win->window) {
         SDL_ShowWindow(win->window);
         win->visible = true;
+        win->damaged = true;
     }
 }
 
@@ -375,9 +377,46 @@ void wm_render_window(GameWindow *win, void (*render_callback)(SDL_Renderer *))
     SDL_RenderPresent(win->renderer);
 }
 
+void wm_render_layers(GameWindow *win, LayerManager *lm) {
+    if (!win || !win->renderer || !lm) return;
+    
+    // Rien de sale et rien de perdu : l'image à l'écran est encore la bonne
+    if (!lm_update(lm, win->renderer) && !win->damaged) return;
+    
+    // Masque perdu avec les textures du renderer : reconstruit à la demande
+    if (!win->corner_mask && win->has_rounded_corners) {
+        win->corner_mask = create_corner_mask(win->renderer, win->corner_radius, win->width, win->height);
+    }
+    
+    SDL_SetRenderDrawColor(win->renderer, 0, 0, 0, 0);
+    SDL_RenderClear(win->renderer);
+    if (win->corner_mask) {
+        SDL_SetTextureBlendMode(win->corner_mask, SDL_BLENDMODE_MOD);
+        SDL_RenderCopy(win->renderer, win->corner_mask, NULL, NULL);
+    }
+    
+    // L'image est déjà composée : une seule copie
+    lm_render(lm, win->renderer);
+    SDL_RenderPresent(win->renderer);
+    win->damaged = false;
+}
+
 bool wm_handle_window_events(WindowManager *wm, SDL_Event *e) {
     if (!wm || !e) return false;
     
+    // Les textures cibles ont perdu leur contenu : masques refaits au prochain rendu,
+    // l'événement reste à transmettre aux scènes
+    if (e->type == SDL_RENDER_TARGETS_RESET || e->type == SDL_RENDER_DEVICE_RESET) {
+        for (int i = 0; i < WINDOW_COUNT; i++) {
+            GameWindow *win = &wm->windows[i];
+            if (!win->window) continue;
+            if (win->corner_mask) SDL_DestroyTexture(win->corner_mask);
+            win->corner_mask = NULL;
+            win->damaged = true;
+        }
+        return false;
+    }
+    
     if (e->type == SDL_WINDOWEVENT) {
         Uint32 windowID = e->window.windowID;
         
@@ -391,6 +430,11 @@ bool wm_handle_window_events(WindowManager *wm, SDL_Event *e) {
                     case SDL_WINDOWEVENT_FOCUS_GAINED:
                         wm->active_window = win;
                         return true;
+                    case SDL_WINDOWEVENT_EXPOSED:
+                    case SDL_WINDOWEVENT_SHOWN:
+                    case SDL_WINDOWEVENT_RESTORED:
+                        win->damaged = true;
+                        return true;
                 }
                 break;
             }
@@ -2,6 +2,7 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 #include <stdbool.h>
+#include "../layer/layer_manager.h"
 
 typedef enum {
     WINDOW_MENU,
@@ -17,6 +18,7 @@ typedef struct {
     WindowType type;
     int width, height;
     bool visible;
+    bool damaged;  // contenu à l'écran perdu (exposée, réaffichée) : à présenter de nouveau
     bool has_rounded_corners;
     int corner_radius;
     char title[64];
@@ -41,4 +43,5 @@ void wm_hide_window(WindowManager *wm, WindowType type);
 void wm_set_active_window(WindowManager *wm, WindowType type);
 GameWindow *wm_get_window(WindowManager *wm, WindowType type);
 void wm_render_window(GameWindow *win, void (*render_callback)(SDL_Renderer *));
+void wm_render_layers(GameWindow *win, LayerManager *lm); // ne recompose et ne présente que si l'image a changé
 bool wm_handle_window_events(WindowManager *wm, SDL_Event *e);